@@ -74,3 +74,27 @@ private:
     MYSQL  *conRAII;
     connection_pool *poolRAII;
 };
+
+
+// 按需取出的数据库连接，第一次调用get时才从连接池取出，析构时归还
+// 工作线程处理不访问数据库的请求(静态文件等)时不占用数据库连接，也不会因为连接池耗尽而阻塞
+class lazy_connection
+{
+public:
+    explicit lazy_connection(connection_pool *connectionPool) : poolLazy(connectionPool), conLazy(NULL) {}
+    ~lazy_connection()
+    {
+        if (conLazy)
+            poolLazy->ReleaseConnection(conLazy);
+    }
+    // 取得数据库连接，连接池中没有空闲连接时阻塞
+    MYSQL *get()
+    {
+        if (!conLazy)
+            conLazy = poolLazy->GetConnection();
+        return conLazy;
+    }
+private:
+    connection_pool *poolLazy;
+    MYSQL *conLazy;
+};
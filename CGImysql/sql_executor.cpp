@@ -0,0 +1,68 @@
+#include "sql_executor.h"
+#include <exception>
+
+
+sql_executor *sql_executor::get_instance()
+{
+    static sql_executor instance;
+    return &instance;
+}
+
+
+/*
+ * @func: 创建执行器的线程与任务队列
+ * @param: connPool 数据库连接池
+ * @param: thread_num 线程数，与数据库连接数相同
+ * @param: max_tasks 任务队列的容量
+ */
+void sql_executor::init(connection_pool *connPool, int thread_num, int max_tasks)
+{
+    if (thread_num <= 0 || max_tasks <= 0)
+        throw std::exception();
+
+    m_connPool = connPool;
+    m_queue = new mpmc_queue<sql_task>(max_tasks);
+    for (int i = 0; i < thread_num; ++i)
+    {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker, this) != 0)
+            throw std::exception();
+        pthread_detach(tid);
+    }
+}
+
+
+/*
+ * @func: 提交任务，不阻塞
+ * @note: 任务队列满说明数据库处理不过来，排队只会让客户端等得更久，调用者应立即回复错误
+ */
+bool sql_executor::submit(sql_task *task)
+{
+    return m_queue && m_queue->push(task);
+}
+
+
+void *sql_executor::worker(void *arg)
+{
+    sql_executor *executor = (sql_executor *)arg;
+    executor->run();
+    return executor;
+}
+
+
+/*
+ * @func: 执行器的线程：取出任务，从连接池取出数据库连接执行，完成后归还连接并释放任务
+ */
+void sql_executor::run()
+{
+    while (true)
+    {
+        sql_task *task = m_queue->pop();
+        {
+            MYSQL *mysql = NULL;
+            connectionRAII mysqlcon(&mysql, m_connPool);
+            task->run(mysql);
+        }
+        delete task;
+    }
+}
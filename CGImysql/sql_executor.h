@@ -0,0 +1,49 @@
+#pragma once
+#include <pthread.h>
+#include <mysql/mysql.h>
+#include "sql_connection_pool.h"
+#include "../threadpool/mpmc_queue.h"
+
+
+// 交给数据库任务执行器的任务，执行完后由执行器delete
+class sql_task
+{
+public:
+    virtual ~sql_task() {}
+    // 在执行器的线程中运行，mysql为从连接池取出的数据库连接(取出失败时为NULL)，返回后归还
+    virtual void run(MYSQL *mysql) = 0;
+};
+
+
+/*
+ * 数据库任务执行器(进程内单例)
+ * 异步路由处理函数(例如注册)把数据库操作交给它，工作线程不等待数据库
+ * 线程数等于数据库连接数，每个线程同时最多占用一个连接，突发的请求不会创建更多阻塞在连接池上的线程
+ * 任务队列有界，队列满时提交失败，由调用者立即回复错误
+ */
+class sql_executor
+{
+public:
+    // 局部静态变量实现单例模式
+    static sql_executor *get_instance();
+
+    // 创建thread_num个线程，任务队列最多容纳max_tasks个任务，创建线程失败时抛出异常
+    void init(connection_pool *connPool, int thread_num, int max_tasks = 1024);
+    // 提交任务，执行器未初始化或任务队列已满时返回false，任务仍由调用者持有
+    bool submit(sql_task *task);
+
+private:
+    sql_executor() : m_connPool(NULL), m_queue(NULL) {}
+    ~sql_executor() {}
+    sql_executor(const sql_executor &) = delete;
+    sql_executor &operator=(const sql_executor &) = delete;
+
+    static void *worker(void *arg);
+    void run();
+
+private:
+    // 数据库连接池
+    connection_pool *m_connPool;
+    // 任务队列，空闲时执行器的线程在此休眠
+    mpmc_queue<sql_task> *m_queue;
+};
@@ -0,0 +1,111 @@
+#include "cpu_affinity.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+
+cpu_affinity *cpu_affinity::get_instance()
+{
+    static cpu_affinity instance;
+    return &instance;
+}
+
+
+/*
+ * @func: 解析CPU列表
+ * @param: cpu_list 逗号分隔的CPU编号或闭区间，例如"0-3,8,10-11"，按给出的顺序绑定
+ */
+bool cpu_affinity::init(const std::string &cpu_list)
+{
+    m_cpus.clear();
+    if (!parse(cpu_list.c_str(), m_cpus))
+    {
+        m_cpus.clear();
+        return false;
+    }
+    return true;
+}
+
+
+/*
+ * @func: 将CPU列表展开为CPU编号，格式错误或CPU不存在时返回false
+ */
+bool cpu_affinity::parse(const char *p, std::vector<int> &cpus)
+{
+    long cpu_num = sysconf(_SC_NPROCESSORS_CONF);
+    while (*p)
+    {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p)
+            return false;
+        long last = first;
+        p = end;
+        if (*p == '-')
+        {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1)
+                return false;
+            p = end;
+        }
+        if (first < 0 || last < first || last >= cpu_num || last >= CPU_SETSIZE)
+            return false;
+        for (long cpu = first; cpu <= last; ++cpu)
+            cpus.push_back((int)cpu);
+        if (*p == ',')
+            ++p;
+        else if (*p)
+            return false;
+    }
+    return true;
+}
+
+
+int cpu_affinity::get_cpu(int index) const
+{
+    if (m_cpus.empty() || index < 0)
+        return -1;
+    return m_cpus[index % m_cpus.size()];
+}
+
+
+void cpu_affinity::set_attr(pthread_attr_t *attr, int cpu)
+{
+    if (cpu < 0)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+}
+
+
+bool cpu_affinity::bind(int cpu)
+{
+    if (cpu < 0)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+
+/*
+ * @func: 调用线程所在的NUMA节点
+ * @note: getcpu系统调用同时返回CPU与NUMA节点，不依赖libnuma；未绑定CPU的线程可能之后迁移到其他节点，
+ *        缓存的结果只作为分配内存时的提示
+ */
+int cpu_affinity::current_node()
+{
+    static thread_local int node = -1;
+    if (node < 0)
+    {
+        unsigned cpu = 0, n = 0;
+        if (syscall(SYS_getcpu, &cpu, &n, NULL) != 0)
+            n = 0;
+        node = (int)n;
+    }
+    return node;
+}
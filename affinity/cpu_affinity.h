@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+
+/*
+ * CPU绑定(进程内单例)
+ * 通过-x传入CPU列表(例如"0-3,8-11")，线程按固定顺序依次绑定到列表中的CPU，列表不够时循环使用：
+ * 主线程事件循环、各个从Reactor、各个工作线程、异步日志线程
+ * 绑定后的线程不再被调度器在核之间(以及NUMA节点之间)迁移，它分配并首先写入的内存也落在本地节点上
+ */
+class cpu_affinity
+{
+public:
+    // 局部静态变量实现单例模式
+    static cpu_affinity *get_instance();
+
+    // 解析CPU列表，空字符串表示不绑定，格式错误或包含不存在的CPU时返回false(不绑定)
+    bool init(const std::string &cpu_list);
+    // 是否配置了CPU列表
+    bool enabled() const
+    {
+        return !m_cpus.empty();
+    }
+    // 第index个线程绑定的CPU，未配置时返回-1
+    int get_cpu(int index) const;
+
+    // 设置线程属性，用它创建的线程绑定到cpu，cpu小于0时不修改
+    static void set_attr(pthread_attr_t *attr, int cpu);
+    // 将调用线程绑定到cpu，cpu小于0时不绑定
+    static bool bind(int cpu);
+    // 调用线程所在的NUMA节点，第一次调用时查询并缓存在线程局部变量中(绑定CPU的线程不会改变)
+    static int current_node();
+
+private:
+    cpu_affinity() {}
+    ~cpu_affinity() {}
+    cpu_affinity(const cpu_affinity &) = delete;
+    cpu_affinity &operator=(const cpu_affinity &) = delete;
+
+    // 将CPU列表展开为CPU编号，格式错误或CPU不存在时返回false
+    static bool parse(const char *p, std::vector<int> &cpus);
+
+private:
+    // 线程依次绑定的CPU
+    std::vector<int> m_cpus;
+};
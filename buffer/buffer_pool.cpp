@@ -0,0 +1,146 @@
+#include "buffer_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include "../affinity/cpu_affinity.h"
+
+
+buffer_pool::buffer_pool() : m_max_size(64 * 1024)
+{
+}
+
+
+buffer_pool::~buffer_pool()
+{
+    for (int n = 0; n < BUFFER_NODE_NUM; ++n)
+    {
+        for (int i = 0; i < BUFFER_CLASS_NUM; ++i)
+        {
+            for (size_t j = 0; j < m_free[n][i].size(); ++j)
+                free(m_free[n][i][j]);
+        }
+    }
+}
+
+
+buffer_pool *buffer_pool::get_instance()
+{
+    static buffer_pool instance;
+    return &instance;
+}
+
+
+/*
+ * @func: 初始化单个缓冲区的大小上限
+ * @param: max_size 大小上限(字节)，向上取整到大小等级，不小于最小等级
+ */
+void buffer_pool::init(int max_size)
+{
+    int cls = size_class(max_size);
+    if (cls < 0)
+        cls = BUFFER_CLASS_NUM - 1;
+    m_max_size = BUFFER_MIN_SIZE << cls;
+}
+
+
+/*
+ * @func: 不小于size的最小大小等级，超过最大等级返回-1
+ */
+int buffer_pool::size_class(int size)
+{
+    int cls = 0;
+    while (cls < BUFFER_CLASS_NUM && (BUFFER_MIN_SIZE << cls) < size)
+        ++cls;
+    return cls < BUFFER_CLASS_NUM ? cls : -1;
+}
+
+
+/*
+ * @func: 分配不小于size的缓冲区，优先复用调用线程所在NUMA节点上对应等级的空闲缓冲区
+ * @note: 新分配的缓冲区由调用线程首先写入，按内核的首次访问策略落在该线程所在的节点上
+ * @param: size 需要的大小，返回实际分配的大小
+ * @param: node 返回缓冲区所属的节点
+ */
+char *buffer_pool::alloc(int &size, int &node)
+{
+    if (size > m_max_size)
+        return NULL;
+    int cls = size_class(size);
+    size = BUFFER_MIN_SIZE << cls;
+    node = cpu_affinity::current_node() % BUFFER_NODE_NUM;
+
+    char *buf = NULL;
+    m_lock[node][cls].lock();
+    if (!m_free[node][cls].empty())
+    {
+        buf = m_free[node][cls].back();
+        m_free[node][cls].pop_back();
+    }
+    m_lock[node][cls].unlock();
+
+    if (!buf)
+        buf = (char *)malloc(size);
+    return buf;
+}
+
+
+/*
+ * @func: 归还缓冲区到分配它的节点，该节点对应等级缓存的空闲缓冲区超过BUFFER_POOL_CLASS_BYTES时直接释放
+ */
+void buffer_pool::release(char *buf, int size, int node)
+{
+    int cls = size_class(size);
+    m_lock[node][cls].lock();
+    if (m_free[node][cls].size() * size < (size_t)BUFFER_POOL_CLASS_BYTES)
+    {
+        m_free[node][cls].push_back(buf);
+        buf = NULL;
+    }
+    m_lock[node][cls].unlock();
+
+    if (buf)
+        free(buf);
+}
+
+
+/*
+ * @func: 保证容量不小于need，容量不足时至少翻倍扩容
+ * @param: need 需要的容量
+ * @param: len 扩容时需要保留的数据长度
+ */
+bool buffer::reserve(int need, int len)
+{
+    if (need <= m_size)
+        return true;
+
+    int size = need < m_size * 2 ? m_size * 2 : need;
+    if (size > buffer_pool::get_instance()->get_max_size())
+        size = need;
+    int node;
+    char *data = buffer_pool::get_instance()->alloc(size, node);
+    if (!data)
+        return false;
+
+    if (m_data)
+    {
+        memcpy(data, m_data, len);
+        buffer_pool::get_instance()->release(m_data, m_size, m_node);
+    }
+    m_data = data;
+    m_size = size;
+    m_node = node;
+    return true;
+}
+
+
+/*
+ * @func: 将缓冲区归还给缓冲区池
+ */
+void buffer::release()
+{
+    if (m_data)
+    {
+        buffer_pool::get_instance()->release(m_data, m_size, m_node);
+        m_data = NULL;
+        m_size = 0;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include "../lock/locker.h"
+
+
+// 最小的缓冲区大小(第0个大小等级)，之后每个等级翻倍
+const int BUFFER_MIN_SIZE = 1024;
+// 大小等级数量上限(1KB ~ 1GB)
+const int BUFFER_CLASS_NUM = 21;
+// 每个大小等级最多缓存的空闲缓冲区总字节数，超出部分直接归还给系统
+const int BUFFER_POOL_CLASS_BYTES = 4 * 1024 * 1024;
+// 分别维护空闲链表的NUMA节点数量，节点编号超出时取模
+const int BUFFER_NODE_NUM = 4;
+
+
+/*
+ * 分级缓冲区池(进程内单例)
+ * 缓冲区大小按1KB、2KB、4KB...的等级分配，每个等级一个空闲链表，各自加锁
+ * 连接的读写缓冲区从这里分配，连接空闲时归还，空闲的长连接不再占用缓冲区内存
+ * 每个NUMA节点有自己的一组空闲链表：线程优先复用本节点上的缓冲区，缓冲区归还到分配它的节点
+ */
+class buffer_pool
+{
+public:
+    // 局部静态变量实现单例模式
+    static buffer_pool *get_instance();
+
+    // 初始化单个缓冲区的大小上限(字节)，向上取整到大小等级
+    void init(int max_size);
+    // 单个缓冲区的大小上限
+    int get_max_size()
+    {
+        return m_max_size;
+    }
+    // 在调用线程所在的NUMA节点上分配不小于size的缓冲区，实际大小与节点通过size与node返回，超过上限返回NULL
+    char *alloc(int &size, int &node);
+    // 归还alloc分配的缓冲区，size与node为alloc返回的实际大小与节点
+    void release(char *buf, int size, int node);
+
+private:
+    buffer_pool();
+    ~buffer_pool();
+    buffer_pool(const buffer_pool &) = delete;
+    buffer_pool &operator=(const buffer_pool &) = delete;
+
+    // 不小于size的最小大小等级
+    static int size_class(int size);
+
+private:
+    // 单个缓冲区的大小上限
+    int m_max_size;
+    // 每个NUMA节点、每个大小等级的空闲缓冲区
+    std::vector<char *> m_free[BUFFER_NODE_NUM][BUFFER_CLASS_NUM];
+    // 保护每个空闲链表的互斥锁
+    locker m_lock[BUFFER_NODE_NUM][BUFFER_CLASS_NUM];
+};
+
+
+/*
+ * 可增长的缓冲区，内存从buffer_pool分配
+ * 初始不占用内存，第一次使用时分配最小等级，空间不足时按等级翻倍扩容，直到缓冲区池的大小上限
+ */
+class buffer
+{
+public:
+    buffer() : m_data(NULL), m_size(0), m_node(0) {}
+    ~buffer()
+    {
+        release();
+    }
+    buffer(const buffer &) = delete;
+    buffer &operator=(const buffer &) = delete;
+
+    // 缓冲区首地址，尚未分配时为NULL
+    char *data()
+    {
+        return m_data;
+    }
+    // 缓冲区容量
+    int size()
+    {
+        return m_size;
+    }
+    // 保证容量不小于need，扩容时保留前len字节的数据，超过上限返回false
+    // 扩容后缓冲区首地址会改变，调用者需要更新指向缓冲区内部的指针
+    bool reserve(int need, int len);
+    // 将缓冲区归还给缓冲区池
+    void release();
+
+private:
+    char *m_data;
+    int m_size;
+    // 分配缓冲区时所在的NUMA节点，归还到该节点的空闲链表
+    int m_node;
+};
@@ -0,0 +1,564 @@
+#include "file_cache.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+
+
+// 最多缓存的文件数量(每个缓存文件占用一个文件描述符)，平均分给各个分片
+static const size_t FILE_CACHE_MAX_ENTRIES = 1024;
+static const size_t FILE_CACHE_SHARD_ENTRIES = FILE_CACHE_MAX_ENTRIES / FILE_CACHE_SHARDS;
+// 超过该大小的文件不做内存映射，只缓存文件描述符，由sendfile发送
+static const off_t FILE_CACHE_MAP_MAX = 512 * 1024;
+// 不超过该大小的文件缓存预先生成的完整响应报文
+static const off_t FILE_CACHE_RESPONSE_MAX = 16 * 1024;
+// inotify不可用时，两次检查文件是否被修改的最小间隔(秒)
+static const time_t FILE_CACHE_CHECK_INTERVAL = 1;
+// 各内容编码的预压缩文件后缀与Content-Encoding名称，下标为FILE_ENCODING
+static const char *encoding_suffix[ENCODING_NUM] = {"", ".gz", ".br"};
+static const char *encoding_names[ENCODING_NUM] = {"identity", "gzip", "br"};
+
+
+file_cache::file_cache() : m_budget(0), m_shard_budget(0), m_inotify_fd(-1),
+        m_response_hits(0), m_response_misses(0), m_close_log(0)
+{
+}
+
+
+file_cache::~file_cache()
+{
+    for (int i = 0; i < FILE_CACHE_SHARDS; ++i)
+    {
+        std::unordered_map<std::string, file_entry *> &entries = m_shards[i].entries;
+        for (std::unordered_map<std::string, file_entry *>::iterator it = entries.begin();
+             it != entries.end(); ++it)
+        {
+            destroy(it->second);
+        }
+    }
+    if (m_inotify_fd != -1)
+        close(m_inotify_fd);
+}
+
+
+file_cache *file_cache::get_instance()
+{
+    static file_cache instance;
+    return &instance;
+}
+
+
+/*
+ * @func: 初始化缓存
+ * @param: budget 内存映射总大小上限(字节)，为0表示不缓存
+ * @param: close_log 是否关闭日志
+ */
+void file_cache::init(size_t budget, int close_log)
+{
+    m_budget = budget;
+    m_shard_budget = budget / FILE_CACHE_SHARDS;
+    m_close_log = close_log;
+    if (0 == m_budget)
+        return;
+
+    m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify_fd == -1)
+    {
+        LOG_WARN("inotify_init1 failure, errno is:%d, check file mtime instead", errno);
+    }
+}
+
+
+/*
+ * @func: 路径所在的缓存分片
+ */
+file_cache_shard *file_cache::shard_of(const std::string &path)
+{
+    return &m_shards[std::hash<std::string>()(path) % FILE_CACHE_SHARDS];
+}
+
+
+/*
+ * @func: 在分片中查找资源文件，命中时移到LRU表头并增加引用
+ * @note: 调用者持有分片的锁，查找与增加引用在同一次加锁内完成，文件不会在两者之间被移出缓存并释放
+ */
+file_entry *file_cache::lookup(file_cache_shard *shard, const std::string &path)
+{
+    std::unordered_map<std::string, file_entry *>::iterator it = shard->entries.find(path);
+    if (it == shard->entries.end())
+        return NULL;
+    file_entry *entry = it->second;
+    // inotify不可用时，定期检查文件是否被修改
+    if (m_inotify_fd == -1 && changed(entry))
+    {
+        remove(shard, entry);
+        return NULL;
+    }
+    shard->lru.splice(shard->lru.begin(), shard->lru, entry->lru);
+    ++entry->ref;
+    return entry;
+}
+
+
+/*
+ * @func: 获取资源文件
+ * @note: 命中时只需要对所在分片加锁一次，做一次哈希查找，不涉及文件系统调用
+ *        未命中时在锁外打开文件，避免阻塞其他线程的查找
+ */
+file_entry *file_cache::acquire(const char *path)
+{
+    // 未开启缓存，每次请求单独打开文件，发送完即关闭
+    if (0 == m_budget)
+        return open_entry(path, false);
+
+    std::string key(path);
+    file_cache_shard *shard = shard_of(key);
+    shard->lock.lock();
+    file_entry *entry = lookup(shard, key);
+    shard->lock.unlock();
+    if (entry)
+        return entry;
+
+    // 先监视文件所在目录，再打开文件，避免漏掉两者之间发生的修改
+    watch_dir(key);
+    entry = open_entry(path, true);
+    if (!entry)
+        return NULL;
+
+    shard->lock.lock();
+    // 其他线程已经缓存了该文件
+    file_entry *cached = lookup(shard, key);
+    if (cached)
+    {
+        shard->lock.unlock();
+        destroy(entry);
+        return cached;
+    }
+
+    // 放入缓存，缓存本身持有一个引用
+    ++entry->ref;
+    entry->shard = shard;
+    for (int i = ENCODING_GZIP; i < ENCODING_NUM; ++i)
+    {
+        if (entry->encoded[i])
+            entry->encoded[i]->shard = shard;
+    }
+    shard->entries[entry->path] = entry;
+    shard->lru.push_front(entry);
+    entry->lru = shard->lru.begin();
+    shard->size += total_charge(entry);
+
+    evict(shard, entry);
+    shard->lock.unlock();
+    return entry;
+}
+
+
+/*
+ * @func: 释放acquire获取的资源文件，引用计数归零(已移出缓存且没有连接使用)时关闭文件
+ * @note: 不加锁：引用计数归零说明缓存已经移出该文件，其他线程不会再找到它
+ */
+void file_cache::release(file_entry *entry)
+{
+    if (--entry->ref == 0)
+        destroy(entry);
+}
+
+
+/*
+ * @func: 根据客户端接受的编码选择预压缩版本，优先br，其次gzip
+ * @param: accept 客户端接受的编码，(1 << ENCODING_GZIP) | (1 << ENCODING_BR) 的组合
+ * @return: 选中的文件，调用者之后release返回的文件，不再release entry
+ */
+file_entry *file_cache::select_encoding(file_entry *entry, int accept)
+{
+    if (!entry->vary)
+        return entry;
+
+    static const int prefer[] = {ENCODING_BR, ENCODING_GZIP};
+    for (int i = 0; i < 2; ++i)
+    {
+        file_entry *encoded = entry->encoded[prefer[i]];
+        if (encoded && (accept & (1 << prefer[i])))
+        {
+            // 先增加预压缩版本的引用，原文件的引用归零时会释放其持有的预压缩版本
+            ++encoded->ref;
+            release(entry);
+            return encoded;
+        }
+    }
+    return entry;
+}
+
+
+/*
+ * @func: 内容编码在Content-Encoding中的名称
+ */
+const char *file_cache::encoding_name(int encoding)
+{
+    return encoding_names[encoding];
+}
+
+
+/*
+ * @func: 获取预先生成的完整响应报文
+ * @param: linger 是否为长连接
+ * @return: true 命中，buf/len为完整响应报文，在release之前一直有效且不会被修改
+ */
+bool file_cache::get_response(file_entry *entry, bool linger, const char *&buf, int &len)
+{
+    if (!entry->addr || entry->st.st_size > FILE_CACHE_RESPONSE_MAX)
+        return false;
+
+    // 与set_response的release配对，读到指针时响应报文的内容已经写好
+    file_response *response = entry->response[linger].load(std::memory_order_acquire);
+    if (!response)
+    {
+        m_response_misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    buf = response->buf;
+    len = response->len;
+    m_response_hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+
+/*
+ * @func: 由响应报文头部与文件内容生成完整响应报文并保存
+ * @param: linger 是否为长连接
+ * @param: header 响应报文头部(状态行、消息报头、空行)
+ * @note: 写好内容后以release发布，只有第一个发布的线程计入内存预算
+ */
+void file_cache::set_response(file_entry *entry, bool linger, const char *header, int header_len)
+{
+    if (!entry->addr || entry->st.st_size > FILE_CACHE_RESPONSE_MAX)
+        return;
+
+    int len = header_len + entry->st.st_size;
+    file_response *response = new file_response;
+    response->buf = new char[len];
+    response->len = len;
+    memcpy(response->buf, header, header_len);
+    memcpy(response->buf + header_len, entry->addr, entry->st.st_size);
+
+    file_response *expected = NULL;
+    if (!entry->response[linger].compare_exchange_strong(expected, response, std::memory_order_release,
+                                                         std::memory_order_relaxed))
+    {
+        // 其他线程已经生成
+        delete[] response->buf;
+        delete response;
+        return;
+    }
+
+    file_cache_shard *shard = entry->shard;
+    shard->lock.lock();
+    entry->charge += len;
+    // 已移出缓存的文件不再计入内存预算
+    if (!entry->stale)
+    {
+        shard->size += len;
+        evict(shard, entry);
+    }
+    shard->lock.unlock();
+}
+
+
+/*
+ * @func: 获取完整响应报文缓存的命中/未命中次数
+ */
+void file_cache::get_response_stat(long &hits, long &misses)
+{
+    hits = m_response_hits.load(std::memory_order_relaxed);
+    misses = m_response_misses.load(std::memory_order_relaxed);
+}
+
+
+/*
+ * @func: 读取inotify事件，将被修改、删除或替换的文件移出缓存
+ */
+void file_cache::dealwithinotify()
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    m_watch_lock.lock();
+    while (true)
+    {
+        ssize_t len = read(m_inotify_fd, buf, sizeof buf);
+        if (len <= 0)
+            break;
+
+        for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len)
+        {
+            struct inotify_event *event = (struct inotify_event *)p;
+            // 事件队列溢出，无法确定哪些文件被修改，清空整个缓存
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                for (int i = 0; i < FILE_CACHE_SHARDS; ++i)
+                {
+                    file_cache_shard *shard = &m_shards[i];
+                    shard->lock.lock();
+                    while (!shard->lru.empty())
+                        remove(shard, shard->lru.back());
+                    shard->lock.unlock();
+                }
+                continue;
+            }
+            std::map<int, std::string>::iterator wit = m_watches.find(event->wd);
+            if (wit == m_watches.end())
+                continue;
+            // 目录被删除，监视自动移除
+            if (event->mask & IN_IGNORED)
+            {
+                m_dirs.erase(wit->second);
+                m_watches.erase(wit);
+                continue;
+            }
+            if (event->len == 0)
+                continue;
+
+            std::string path = wit->second + "/" + event->name;
+            // 预压缩文件被修改，使原文件失效
+            for (int i = ENCODING_GZIP; i < ENCODING_NUM; ++i)
+            {
+                size_t len = strlen(encoding_suffix[i]);
+                if (path.size() > len && path.compare(path.size() - len, len, encoding_suffix[i]) == 0)
+                {
+                    path.erase(path.size() - len);
+                    break;
+                }
+            }
+            file_cache_shard *shard = shard_of(path);
+            shard->lock.lock();
+            std::unordered_map<std::string, file_entry *>::iterator it = shard->entries.find(path);
+            if (it != shard->entries.end())
+            {
+                LOG_INFO("file cache invalidate %s", path.c_str());
+                remove(shard, it->second);
+            }
+            shard->lock.unlock();
+        }
+    }
+    m_watch_lock.unlock();
+}
+
+
+/*
+ * @func: 打开资源文件及其预压缩版本，创建缓存对象，引用计数为1(调用者持有)
+ * @param: cached 是否放入缓存，放入缓存的小文件做内存映射
+ */
+file_entry *file_cache::open_entry(const char *path, bool cached)
+{
+    file_entry *entry = open_file(path, cached);
+    if (entry)
+        open_encoded(entry, cached);
+    return entry;
+}
+
+
+/*
+ * @func: 查找原文件同目录下的.gz/.br预压缩文件，比原文件小时一起缓存
+ * @note: 预压缩版本不单独放入缓存，由原文件持有引用，随原文件一起失效
+ */
+void file_cache::open_encoded(file_entry *entry, bool cached)
+{
+    for (int i = ENCODING_GZIP; i < ENCODING_NUM; ++i)
+    {
+        std::string path = entry->path + encoding_suffix[i];
+        file_entry *encoded = open_file(path.c_str(), cached);
+        if (!encoded)
+            continue;
+        // 预压缩文件比原文件还大(或是原文件修改后没有重新生成)，不使用
+        if (encoded->st.st_size >= entry->st.st_size || encoded->st.st_mtime < entry->st.st_mtime)
+        {
+            destroy(encoded);
+            continue;
+        }
+        encoded->encoding = i;
+        encoded->vary = true;
+        entry->encoded[i] = encoded;
+        entry->vary = true;
+    }
+}
+
+
+/*
+ * @func: 原文件与其预压缩版本计入内存预算的总字节数
+ */
+size_t file_cache::total_charge(file_entry *entry)
+{
+    size_t charge = entry->charge;
+    for (int i = ENCODING_GZIP; i < ENCODING_NUM; ++i)
+    {
+        if (entry->encoded[i] && !entry->encoded[i]->stale)
+            charge += entry->encoded[i]->charge;
+    }
+    return charge;
+}
+
+
+/*
+ * @func: 打开单个文件，创建缓存对象，引用计数为1(调用者持有)
+ * @param: cached 是否放入缓存，放入缓存的小文件做内存映射
+ */
+file_entry *file_cache::open_file(const char *path, bool cached)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    file_entry *entry = new file_entry;
+    // 只缓存对所有用户可读的普通文件
+    if (fstat(fd, &entry->st) < 0 || !S_ISREG(entry->st.st_mode) || !(entry->st.st_mode & S_IROTH))
+    {
+        close(fd);
+        delete entry;
+        return NULL;
+    }
+
+    entry->path = path;
+    entry->fd = fd;
+    // 与nginx相同的实体标签格式："修改时间-文件大小"(十六进制)
+    snprintf(entry->etag, sizeof entry->etag, "\"%lx-%lx\"",
+             (unsigned long)entry->st.st_mtime, (unsigned long)entry->st.st_size);
+    struct tm tm;
+    gmtime_r(&entry->st.st_mtime, &tm);
+    strftime(entry->last_modified, sizeof entry->last_modified, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    entry->addr = NULL;
+    entry->response[0] = NULL;
+    entry->response[1] = NULL;
+    entry->charge = 0;
+    entry->encoding = ENCODING_IDENTITY;
+    for (int i = 0; i < ENCODING_NUM; ++i)
+        entry->encoded[i] = NULL;
+    entry->vary = false;
+    entry->ref = 1;
+    entry->stale = !cached;
+    entry->shard = NULL;
+    entry->checked = time(NULL);
+
+    // 小文件做一次内存映射，所有连接共享，响应时与响应报文头部一起writev
+    if (cached && entry->st.st_size > 0 && entry->st.st_size <= FILE_CACHE_MAP_MAX &&
+        (size_t)entry->st.st_size <= m_shard_budget)
+    {
+        void *addr = mmap(0, entry->st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            entry->addr = (char *)addr;
+            entry->charge = entry->st.st_size;
+        }
+    }
+    return entry;
+}
+
+
+/*
+ * @func: 将资源文件移出缓存，释放缓存持有的引用
+ * @note: 调用者持有分片的锁
+ */
+void file_cache::remove(file_cache_shard *shard, file_entry *entry)
+{
+    shard->entries.erase(entry->path);
+    shard->lru.erase(entry->lru);
+    shard->size -= total_charge(entry);
+    entry->stale = true;
+    // 预压缩版本随原文件一起移出缓存，之后生成的响应报文不再计入内存预算
+    for (int i = ENCODING_GZIP; i < ENCODING_NUM; ++i)
+    {
+        if (entry->encoded[i])
+            entry->encoded[i]->stale = true;
+    }
+    if (--entry->ref == 0)
+        destroy(entry);
+}
+
+
+/*
+ * @func: 分片超出内存预算或文件数量上限时，从LRU链表尾部淘汰
+ * @param: keep 刚刚使用的文件，不淘汰
+ * @note: 调用者持有分片的锁
+ */
+void file_cache::evict(file_cache_shard *shard, file_entry *keep)
+{
+    while ((shard->size > m_shard_budget || shard->entries.size() > FILE_CACHE_SHARD_ENTRIES) &&
+           !shard->lru.empty() && shard->lru.back() != keep)
+    {
+        remove(shard, shard->lru.back());
+    }
+}
+
+
+/*
+ * @func: 释放资源文件对象：释放预先生成的响应报文，取消内存映射，关闭文件
+ */
+void file_cache::destroy(file_entry *entry)
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        file_response *response = entry->response[i].load(std::memory_order_relaxed);
+        if (response)
+        {
+            delete[] response->buf;
+            delete response;
+        }
+    }
+    // 释放原文件持有的预压缩版本的引用，仍有连接在发送时由连接最后释放
+    for (int i = ENCODING_GZIP; i < ENCODING_NUM; ++i)
+    {
+        if (entry->encoded[i] && --entry->encoded[i]->ref == 0)
+            destroy(entry->encoded[i]);
+    }
+    if (entry->addr)
+        munmap(entry->addr, entry->st.st_size);
+    close(entry->fd);
+    delete entry;
+}
+
+
+/*
+ * @func: 为文件所在目录添加inotify监视，每个目录只添加一次
+ */
+void file_cache::watch_dir(const std::string &path)
+{
+    if (m_inotify_fd == -1)
+        return;
+
+    std::string dir = path.substr(0, path.rfind('/'));
+    m_watch_lock.lock();
+    if (m_dirs.count(dir))
+    {
+        m_watch_lock.unlock();
+        return;
+    }
+    int wd = inotify_add_watch(m_inotify_fd, dir.c_str(),
+                               IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE |
+                               IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE);
+    if (wd >= 0)
+    {
+        m_watches[wd] = dir;
+        m_dirs[dir] = wd;
+    }
+    m_watch_lock.unlock();
+}
+
+
+/*
+ * @func: 检查文件是否已经被修改，同一文件每FILE_CACHE_CHECK_INTERVAL秒最多stat一次
+ * @note: 调用者持有分片的锁
+ */
+bool file_cache::changed(file_entry *entry)
+{
+    time_t now = time(NULL);
+    if (now - entry->checked < FILE_CACHE_CHECK_INTERVAL)
+        return false;
+    entry->checked = now;
+
+    struct stat st;
+    if (stat(entry->path.c_str(), &st) < 0)
+        return true;
+    return st.st_ino != entry->st.st_ino || st.st_size != entry->st.st_size ||
+           st.st_mtim.tv_sec != entry->st.st_mtim.tv_sec || st.st_mtim.tv_nsec != entry->st.st_mtim.tv_nsec;
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include <string>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <atomic>
+#include <time.h>
+#include <sys/stat.h>
+#include "../lock/locker.h"
+#include "../log/log.h"
+
+
+// 资源文件的内容编码，预压缩文件与原文件同名，加上.gz/.br后缀
+enum FILE_ENCODING
+{
+    ENCODING_IDENTITY = 0,
+    ENCODING_GZIP,
+    ENCODING_BR,
+    ENCODING_NUM
+};
+
+
+struct file_cache_shard;
+
+
+// 预先生成的完整响应报文(响应报文头部 + 文件内容)
+struct file_response
+{
+    char *buf;
+    int len;
+};
+
+
+// 缓存的资源文件
+struct file_entry
+{
+    // 资源文件的完整路径
+    std::string path;
+    // 只读打开的文件描述符，所有连接共享，sendfile时使用各自的偏移
+    int fd;
+    // 文件状态
+    struct stat st;
+    // 实体标签(由修改时间与文件大小生成)与HTTP日期格式的最后修改时间，用于If-Range等条件请求
+    char etag[48];
+    char last_modified[32];
+    // 整个文件的只读内存映射，文件超过映射上限或未开启缓存时为NULL
+    char *addr;
+    // 预先生成的完整响应报文，下标0为短连接，1为长连接，尚未生成时为NULL
+    // 只生成一次，生成后不再修改，读取时不加锁(release/acquire发布)
+    std::atomic<file_response *> response[2];
+    // 计入内存预算的字节数(内存映射与预先生成的响应报文)，由所在分片的锁保护
+    size_t charge;
+    // 内容编码，预压缩文件为ENCODING_GZIP/ENCODING_BR
+    int encoding;
+    // 原文件的预压缩版本，原文件持有它们的引用，不存在时为NULL
+    file_entry *encoded[ENCODING_NUM];
+    // 原文件存在预压缩版本，响应需要带上Vary:Accept-Encoding
+    bool vary;
+    // 引用计数：缓存本身持有1个，每个正在发送该文件的连接各持有1个
+    // 只在持有所在分片的锁、且文件仍在缓存中时增加，减少时不需要加锁
+    std::atomic<int> ref;
+    // 已从缓存中移除(文件被修改或被淘汰)，引用计数归零时释放
+    bool stale;
+    // 所在的缓存分片(预压缩版本与原文件相同)，未放入缓存时为NULL
+    file_cache_shard *shard;
+    // 上一次检查文件是否被修改的时间(inotify不可用时使用)
+    time_t checked;
+    // 在LRU链表中的位置
+    std::list<file_entry *>::iterator lru;
+};
+
+
+// 缓存分片的数量，按路径的哈希值选择分片
+static const int FILE_CACHE_SHARDS = 16;
+
+
+/*
+ * 缓存分片：各自的路径映射、LRU链表与内存预算(总预算的1/FILE_CACHE_SHARDS)，由各自的锁保护
+ * 不同路径的查找通常落在不同分片，工作线程之间不争用同一把锁
+ */
+struct file_cache_shard
+{
+    // 路径到缓存对象的映射
+    std::unordered_map<std::string, file_entry *> entries;
+    // LRU链表，表头为最近使用的文件
+    std::list<file_entry *> lru;
+    // 当前计入内存预算的总大小
+    size_t size;
+    locker lock;
+
+    file_cache_shard() : size(0) {}
+};
+
+
+/*
+ * 静态资源文件缓存(进程内单例)
+ * 以资源文件完整路径为键，缓存文件描述符、文件状态以及共享的只读内存映射，
+ * 命中时不需要stat/open/mmap等文件系统调用
+ * 文件被修改由inotify通知(inotify不可用时退化为每秒最多一次的stat检查)，
+ * 内存映射的总大小受内存预算限制，超出时按LRU淘汰
+ * 按路径的哈希值分为FILE_CACHE_SHARDS个分片，查找与增加引用在所在分片的一次加锁内完成，
+ * 释放引用与读取完整响应报文不加锁
+ * 小文件还会缓存预先生成的完整响应报文(长连接/短连接各一份)，命中时只需要一次写操作
+ * 原文件存在.gz/.br预压缩版本时一起缓存，客户端接受对应编码时发送预压缩版本
+ */
+class file_cache
+{
+public:
+    // 局部静态变量实现单例模式
+    static file_cache *get_instance();
+
+    // 初始化缓存：内存预算(字节)，为0表示不缓存，每次请求都打开文件
+    void init(size_t budget, int close_log);
+    // 获取资源文件，返回的对象在release之前一直有效
+    // 文件不存在、不可读、不是普通文件时返回NULL，由调用者通过stat区分原因
+    file_entry *acquire(const char *path);
+    // 释放acquire获取的资源文件
+    void release(file_entry *entry);
+    // 根据客户端接受的编码(1 << FILE_ENCODING 组成的位掩码)选择预压缩版本，
+    // 返回选中的文件，entry的引用转移给它
+    file_entry *select_encoding(file_entry *entry, int accept);
+    // 内容编码在Content-Encoding中的名称
+    static const char *encoding_name(int encoding);
+    // 获取预先生成的完整响应报文，不是小文件或尚未生成时返回false
+    bool get_response(file_entry *entry, bool linger, const char *&buf, int &len);
+    // 由响应报文头部与文件内容生成完整响应报文并保存，之后的请求直接发送
+    void set_response(file_entry *entry, bool linger, const char *header, int header_len);
+    // 完整响应报文缓存的命中/未命中次数
+    void get_response_stat(long &hits, long &misses);
+
+    // inotify文件描述符，挂到主线程事件循环的epoll实例上，不可用时为-1
+    int get_inotify_fd()
+    {
+        return m_inotify_fd;
+    }
+    // 处理inotify事件，将被修改的文件移出缓存
+    void dealwithinotify();
+
+private:
+    file_cache();
+    ~file_cache();
+    file_cache(const file_cache &) = delete;
+    file_cache &operator=(const file_cache &) = delete;
+
+    // 路径所在的缓存分片
+    file_cache_shard *shard_of(const std::string &path);
+    // 在分片中查找并增加引用，未命中(或文件已被修改)时返回NULL，调用者持有分片的锁
+    file_entry *lookup(file_cache_shard *shard, const std::string &path);
+    // 打开文件及其预压缩版本，创建缓存对象，失败返回NULL
+    file_entry *open_entry(const char *path, bool cached);
+    // 打开单个文件并创建缓存对象，失败返回NULL
+    file_entry *open_file(const char *path, bool cached);
+    // 查找并打开原文件的预压缩版本
+    void open_encoded(file_entry *entry, bool cached);
+    // 原文件与其预压缩版本计入内存预算的总字节数
+    size_t total_charge(file_entry *entry);
+    // 将资源文件移出缓存
+    void remove(file_cache_shard *shard, file_entry *entry);
+    // 分片超出内存预算时按LRU淘汰
+    void evict(file_cache_shard *shard, file_entry *keep);
+    // 释放资源文件对象
+    void destroy(file_entry *entry);
+    // 为文件所在目录添加inotify监视
+    void watch_dir(const std::string &path);
+    // 文件是否已经被修改(比较stat信息)
+    bool changed(file_entry *entry);
+
+private:
+    // 缓存的内存映射总大小上限
+    size_t m_budget;
+    // 每个分片的内存预算
+    size_t m_shard_budget;
+    // 缓存分片
+    file_cache_shard m_shards[FILE_CACHE_SHARDS];
+    // inotify文件描述符
+    int m_inotify_fd;
+    // inotify监视描述符到目录路径的映射
+    std::map<int, std::string> m_watches;
+    // 已经添加监视的目录
+    std::map<std::string, int> m_dirs;
+    // 保护inotify监视表的互斥锁，需要同时持有分片的锁时先加该锁
+    locker m_watch_lock;
+    // 完整响应报文缓存的命中次数
+    std::atomic<long> m_response_hits;
+    // 完整响应报文缓存的未命中次数(可以预先生成但尚未生成)
+    std::atomic<long> m_response_misses;
+    // 是否关闭日志
+    int m_close_log;
+};
@@ -0,0 +1,30 @@
+#!/bin/bash
+# 为资源目录中的文本类静态文件生成.gz/.br预压缩版本，服务器在客户端接受对应编码时直接发送
+# 预压缩文件比原文件大时不生成；原文件修改后需要重新运行(服务器不会使用比原文件旧的预压缩文件)
+#
+# 用法(在项目目录TinyWebServerBymyself下运行):
+#   ./cache/precompress.sh [资源目录]
+# 例如:
+#   ./cache/precompress.sh ./root
+
+ROOT=${1:-./root}
+
+for file in $(find "$ROOT" -type f \( -name "*.html" -o -name "*.css" -o -name "*.js" -o -name "*.svg" -o -name "*.ico" \)); do
+    size=$(stat -c %s "$file")
+
+    gzip -9 -n -c "$file" > "$file.gz"
+    if [ $(stat -c %s "$file.gz") -ge $size ]; then
+        rm -f "$file.gz"
+    else
+        echo "$file.gz"
+    fi
+
+    if command -v brotli > /dev/null 2>&1; then
+        brotli -q 11 -f -o "$file.br" "$file"
+        if [ $(stat -c %s "$file.br") -ge $size ]; then
+            rm -f "$file.br"
+        else
+            echo "$file.br"
+        fi
+    fi
+done
@@ -28,12 +28,39 @@ Config::Config()
     // 线程池内的线程数量,默认8
     thread_num = 8;
 
+    // 线程池内的线程数量上限,默认0,即线程数固定为thread_num
+    thread_max = 0;
+
     // 关闭日志,默认不关闭
     close_log = 0;
 
     // 并发模型(事件处理模式),默认是proactor
     actor_model = 0;
 
+    // 从Reactor数量,默认0,即所有事件由主线程的单个事件循环处理
+    reactor_num = 0;
+
+    // 监听套接字的全连接队列长度,默认5
+    backlog = 5;
+
+    // SO_REUSEPORT监听套接字分片,默认不使用
+    reuseport = 0;
+
+    // I/O引擎,默认为recv/writev
+    io_engine = 0;
+
+    // 静态文件缓存的内存预算,默认64MB
+    file_cache = 64;
+
+    // 单个连接读/写缓冲区的大小上限,默认64KB
+    buffer_max = 64;
+
+    // 线程池任务调度方式,默认所有工作线程共享一个任务队列
+    schedule = 0;
+
+    // 上传文件的大小上限,默认0,即不开启上传接口
+    upload_max = 0;
+
     // 数据库的服务器端口,默认为3306
     db_Port = 3306;
 }
@@ -68,7 +95,7 @@ bool Config::parseJsonFile()
  */
 void Config::parse_arg(int argc, char*argv[]){
     int opt;
-    const char *str = "p:l:m:o:s:t:c:a:";
+    const char *str = "p:l:m:o:s:t:e:c:a:r:b:u:i:f:k:w:x:d:";
     // getopt函数用于解析命令行选项（短选项）
     while ((opt = getopt(argc, argv, str)) != -1)
     {
@@ -110,6 +137,12 @@ void Config::parse_arg(int argc, char*argv[]){
                 thread_num = atoi(optarg);
                 break;
             }
+            case 'e':
+            {
+                // 线程池中工作线程数量上限
+                thread_max = atoi(optarg);
+                break;
+            }
             case 'c':
             {
                 // 是否关闭日志
@@ -122,6 +155,60 @@ void Config::parse_arg(int argc, char*argv[]){
                 actor_model = atoi(optarg);
                 break;
             }
+            case 'r':
+            {
+                // 从Reactor数量
+                reactor_num = atoi(optarg);
+                break;
+            }
+            case 'b':
+            {
+                // 监听套接字的全连接队列长度
+                backlog = atoi(optarg);
+                break;
+            }
+            case 'u':
+            {
+                // SO_REUSEPORT监听套接字分片
+                reuseport = atoi(optarg);
+                break;
+            }
+            case 'i':
+            {
+                // I/O引擎(recv/writev 或 io_uring)
+                io_engine = atoi(optarg);
+                break;
+            }
+            case 'f':
+            {
+                // 静态文件缓存的内存预算(MB)
+                file_cache = atoi(optarg);
+                break;
+            }
+            case 'k':
+            {
+                // 单个连接读/写缓冲区的大小上限(KB)
+                buffer_max = atoi(optarg);
+                break;
+            }
+            case 'w':
+            {
+                // 线程池任务调度方式(共享任务队列 或 工作窃取)
+                schedule = atoi(optarg);
+                break;
+            }
+            case 'x':
+            {
+                // 线程绑定的CPU列表
+                cpu_list = optarg;
+                break;
+            }
+            case 'd':
+            {
+                // 上传文件的大小上限(MB)
+                upload_max = atoi(optarg);
+                break;
+            }
             default:
                 break;
         }
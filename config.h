@@ -38,12 +38,42 @@ public:
     // 线程池内的线程数量
     int thread_num;
 
+    // 线程池内的线程数量上限，大于thread_num时线程池随负载伸缩
+    int thread_max;
+
     // 是否关闭日志
     int close_log;
 
     // 并发模型选择（事件处理模式）
     int actor_model;
 
+    // 从Reactor数量（主Reactor + N个从Reactor），0表示单Reactor
+    int reactor_num;
+
+    // 监听套接字的全连接队列长度（listen的backlog）
+    int backlog;
+
+    // 是否为每个从Reactor创建SO_REUSEPORT监听套接字
+    int reuseport;
+
+    // I/O引擎：0 recv/writev，1 io_uring（仅Proactor模式）
+    int io_engine;
+
+    // 静态文件缓存的内存预算(MB)，0表示不缓存
+    int file_cache;
+
+    // 单个连接读/写缓冲区的大小上限(KB)
+    int buffer_max;
+
+    // 线程池任务调度方式：0共享任务队列，1工作窃取+轮询分派，2工作窃取+按连接分派，3按连接固定分派
+    int schedule;
+
+    // 线程绑定的CPU列表，例如"0-3,8-11"，空字符串表示不绑定
+    std::string cpu_list;
+
+    // 上传文件的大小上限(MB)，0表示不开启上传接口
+    int upload_max;
+
     // 数据库登陆用户名
     std::string user;
     // 数据库登陆密码
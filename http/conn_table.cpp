@@ -0,0 +1,108 @@
+#include "conn_table.h"
+#include <stdlib.h>
+#include <new>
+
+
+conn_table::conn_table() : m_slots(NULL), m_max_fd(0), m_free(NULL)
+{
+}
+
+
+conn_table::~conn_table()
+{
+    for (size_t i = 0; i < m_slabs.size(); ++i)
+        delete[] m_slabs[i];
+    free(m_slots);
+}
+
+
+conn_table *conn_table::get_instance()
+{
+    static conn_table instance;
+    return &instance;
+}
+
+
+/*
+ * @func: 初始化文件描述符到连接对象的索引数组
+ * @note: calloc分配的大块内存直接来自mmap的零页，只有被访问到的页才会占用物理内存
+ */
+void conn_table::init(int max_fd)
+{
+    m_slots = (conn_slot **)calloc(max_fd, sizeof(conn_slot *));
+    if (!m_slots)
+    {
+        throw std::exception();
+    }
+    m_max_fd = max_fd;
+}
+
+
+/*
+ * @func: 为新连接分配连接对象，空闲链表为空时成批分配SLAB_SIZE个
+ * @note: 空闲链表中的连接对象已经在回收时释放了上一个连接的资源，由http_conn::init重新初始化
+ */
+conn_slot *conn_table::acquire(int fd)
+{
+    if (fd < 0 || fd >= m_max_fd)
+        return NULL;
+
+    m_lock.lock();
+    if (!m_free)
+    {
+        conn_slot *slab = new (std::nothrow) conn_slot[SLAB_SIZE];
+        if (!slab)
+        {
+            m_lock.unlock();
+            return NULL;
+        }
+        m_slabs.push_back(slab);
+        for (int i = 0; i < SLAB_SIZE; ++i)
+        {
+            slab[i].conn.m_slot = &slab[i];
+            slab[i].next = m_free;
+            m_free = &slab[i];
+        }
+    }
+    conn_slot *slot = m_free;
+    m_free = slot->next;
+    slot->next = NULL;
+    m_slots[fd] = slot;
+    m_lock.unlock();
+    return slot;
+}
+
+
+/*
+ * @func: 连接关闭，从索引数组中移除
+ * @note: 工作线程可能还在处理该连接(例如正在写入上传的文件、读写缓冲区)，此时只标记关闭，
+ *        连接对象与文件描述符保留到工作线程交回(http_conn::unhold)，文件描述符不会在此期间被新连接复用
+ *        没有工作线程持有时，在调用者(连接所属的事件循环)中立即回收，上传途中关闭的连接立即删除不完整的文件
+ */
+void conn_table::release(int fd)
+{
+    if (fd < 0 || fd >= m_max_fd)
+        return;
+
+    m_lock.lock();
+    conn_slot *slot = m_slots[fd];
+    m_slots[fd] = NULL;
+    m_lock.unlock();
+    if (slot && slot->conn.try_close())
+        recycle(slot);
+}
+
+
+/*
+ * @func: 回收连接：释放连接持有的资源并关闭文件描述符，之后放回空闲链表
+ * @note: 文件描述符关闭后可能立刻被其他事件循环accept并登记，此时连接对象已经不在索引数组中
+ */
+void conn_table::recycle(conn_slot *slot)
+{
+    slot->conn.release();
+
+    m_lock.lock();
+    slot->next = m_free;
+    m_free = slot;
+    m_lock.unlock();
+}
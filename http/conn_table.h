@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include "http_conn.h"
+#include "../lock/locker.h"
+#include "../timer/lst_timer.h"
+
+
+// 连接表中的一个连接：http连接对象与定时器使用的连接资源
+struct conn_slot
+{
+    // http连接对象
+    http_conn conn;
+    // 定时器回调使用的连接资源
+    client_data timer_data;
+    // 空闲链表中的下一个连接对象
+    conn_slot *next;
+};
+
+
+/*
+ * 连接表(进程内单例)：按文件描述符索引当前存活的连接
+ * 连接对象按块(slab)成批分配，连接关闭且工作线程交回后放回空闲链表，新连接优先复用空闲链表中的对象，
+ * 只有存活连接的峰值数量决定占用的内存，不再在启动时分配MAX_FD个连接对象
+ * 文件描述符到连接对象的索引数组只保存指针，由calloc分配，未使用的部分不占用物理内存
+ */
+class conn_table
+{
+public:
+    // 局部静态变量实现单例模式
+    static conn_table *get_instance();
+
+    // 初始化索引数组，max_fd为文件描述符上限
+    void init(int max_fd);
+    // 为新连接分配连接对象并登记到文件描述符对应的位置，文件描述符超出上限或分配失败返回NULL
+    conn_slot *acquire(int fd);
+    // 连接关闭时从索引数组中移除，没有工作线程持有该连接时立即回收(关闭文件描述符、放回空闲链表)，
+    // 否则由最后交回连接的工作线程回收，由连接所属的事件循环调用
+    void release(int fd);
+    // 回收已关闭且没有工作线程持有的连接：释放连接持有的资源、关闭文件描述符，放回空闲链表
+    void recycle(conn_slot *slot);
+    // 文件描述符对应的连接，没有存活连接时返回NULL
+    conn_slot *get(int fd)
+    {
+        return (fd >= 0 && fd < m_max_fd) ? m_slots[fd] : NULL;
+    }
+    // 已分配的连接对象数量(存活连接 + 空闲链表)
+    int get_capacity()
+    {
+        return (int)m_slabs.size() * SLAB_SIZE;
+    }
+
+private:
+    conn_table();
+    ~conn_table();
+    conn_table(const conn_table &) = delete;
+    conn_table &operator=(const conn_table &) = delete;
+
+private:
+    // 每次成批分配的连接对象数量
+    static const int SLAB_SIZE = 64;
+
+    // 文件描述符到连接对象的索引数组
+    conn_slot **m_slots;
+    // 文件描述符上限
+    int m_max_fd;
+    // 空闲链表
+    conn_slot *m_free;
+    // 已分配的连接对象块，析构时释放
+    std::vector<conn_slot *> m_slabs;
+    // 保护空闲链表与索引数组的互斥锁(多个事件循环线程会同时accept/关闭连接)
+    locker m_lock;
+};
@@ -0,0 +1,114 @@
+#include "http_chunked.h"
+#include <string.h>
+
+
+void chunked_decoder::reset()
+{
+    m_state = CHUNK_SIZE;
+    m_size = 0;
+    m_digits = 0;
+}
+
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+
+/*
+ * @func: 解码一段分块传输编码的输入
+ * @note: 块数据整段memmove，其余部分逐字节推进状态机
+ *        块大小超过15个十六进制位(off_t溢出)时按格式错误处理
+ */
+int chunked_decoder::decode(const char *in, int len, char *out, int &out_len)
+{
+    int i = 0;
+    out_len = 0;
+    while (i < len && m_state != CHUNK_DONE)
+    {
+        char c = in[i];
+        switch (m_state)
+        {
+        case CHUNK_SIZE:
+        {
+            int v = hex_value(c);
+            if (v >= 0)
+            {
+                if (++m_digits > 15)
+                    return -1;
+                m_size = m_size * 16 + v;
+                ++i;
+                break;
+            }
+            // 块大小至少一位
+            if (m_digits == 0)
+                return -1;
+            m_state = CHUNK_EXT;
+            break;
+        }
+        case CHUNK_EXT:
+            ++i;
+            if (c == '\n')
+            {
+                m_state = m_size > 0 ? CHUNK_DATA : CHUNK_TRAILER;
+                m_digits = 0;
+            }
+            break;
+        case CHUNK_DATA:
+        {
+            int n = len - i;
+            if (n > m_size)
+                n = m_size;
+            memmove(out + out_len, in + i, n);
+            out_len += n;
+            i += n;
+            m_size -= n;
+            if (m_size == 0)
+                m_state = CHUNK_DATA_CR;
+            break;
+        }
+        case CHUNK_DATA_CR:
+            if (c != '\r')
+                return -1;
+            ++i;
+            m_state = CHUNK_DATA_LF;
+            break;
+        case CHUNK_DATA_LF:
+            if (c != '\n')
+                return -1;
+            ++i;
+            m_state = CHUNK_SIZE;
+            break;
+        case CHUNK_TRAILER:
+            ++i;
+            if (c == '\r')
+                m_state = CHUNK_END_LF;
+            else if (c == '\n')
+                m_state = CHUNK_DONE;
+            else
+                m_state = CHUNK_TRAILER_LINE;
+            break;
+        case CHUNK_TRAILER_LINE:
+            ++i;
+            if (c == '\n')
+                m_state = CHUNK_TRAILER;
+            break;
+        case CHUNK_END_LF:
+            if (c != '\n')
+                return -1;
+            ++i;
+            m_state = CHUNK_DONE;
+            break;
+        default:
+            return -1;
+        }
+    }
+    return i;
+}
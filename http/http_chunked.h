@@ -0,0 +1,53 @@
+#pragma once
+#include <sys/types.h>
+
+
+/*
+ * 分块传输编码(Transfer-Encoding: chunked)请求体的增量解码器
+ * 请求体可能分多次到达，解码状态逐字节保存在对象中，任意位置截断的输入都可以在下次继续解码
+ * 解码出的数据就地写回输入所在的缓冲区(解码后的数据总是不长于输入)，不需要额外的缓冲区
+ * chunk-extension与trailer字段被跳过
+ */
+class chunked_decoder
+{
+public:
+    chunked_decoder() { reset(); }
+
+    // 开始解码一个新的请求体
+    void reset();
+    // 解码[in, in + len)，解码出的数据写到out(out <= in，可以重叠)，out_len为写入的字节数
+    // 返回消耗的输入字节数，请求体结束时可能小于len(之后是流水线中的下一个请求)，格式错误返回-1
+    int decode(const char *in, int len, char *out, int &out_len);
+    // 请求体是否已经结束(最后一块与trailer之后的空行已经解码)
+    bool done() const
+    {
+        return m_state == CHUNK_DONE;
+    }
+
+private:
+    enum CHUNK_STATE
+    {
+        // 块大小(十六进制)
+        CHUNK_SIZE = 0,
+        // 块大小之后到行尾的部分(chunk-extension、\r)
+        CHUNK_EXT,
+        // 块数据
+        CHUNK_DATA,
+        // 块数据之后的\r\n
+        CHUNK_DATA_CR,
+        CHUNK_DATA_LF,
+        // 最后一块之后，trailer字段或结尾空行的行首
+        CHUNK_TRAILER,
+        // trailer字段的剩余部分
+        CHUNK_TRAILER_LINE,
+        // 结尾空行的\n
+        CHUNK_END_LF,
+        CHUNK_DONE
+    };
+
+    CHUNK_STATE m_state;
+    // 当前块的大小与剩余未解码的数据长度
+    off_t m_size;
+    // 当前块大小已经读到的十六进制位数
+    int m_digits;
+};
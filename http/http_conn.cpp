@@ -1,5 +1,8 @@
 #include "http_conn.h"
 #include <iostream>
+#include <ctype.h>
+#include "../threadpool/pool_monitor.h"
+#include "conn_table.h"
 
 
 // 定义http响应的一些状态信息
@@ -12,6 +15,10 @@ const char *error_404_title = "Not Found";
 const char *error_404_form = "The requested file was not found on this server.\n";
 const char *error_500_title = "Internal Error";
 const char *error_500_form = "There was an unusual problem serving the request file.\n";
+const char *partial_206_title = "Partial Content";
+const char *error_416_title = "Range Not Satisfiable";
+const char *error_416_form = "The requested range is not satisfiable.\n";
+const char *not_modified_304_title = "Not Modified";
 
 // 线程同步互斥锁
 locker m_lock;
@@ -19,17 +26,18 @@ locker m_lock;
 std::map<std::string, std::string> users;
 
 // 客户端数量计数
-int http_conn::m_user_count = 0;
-// epoll_create创建的实例对象
-int http_conn::m_epollfd = -1;
+std::atomic<int> http_conn::m_user_count(0);
+std::atomic<unsigned> http_conn::m_next_generation(0);
 
 /*******************数据库:函数需要补充*****************/
 /*
  * @func: 初始化数据库读取数据库服务器中的user表
  *        将user表中已经存在的username以及passwd存入服务器本地的map中
  */
-void http_conn::initmysql_result(connection_pool *connPool)
+void http_conn::initmysql_result(connection_pool *connPool, int close_log)
 {
+    // 日志宏使用m_close_log判断是否记录日志
+    int m_close_log = close_log;
     // 先从数据库连接池中获取一个连接
     // 1. 创建一个MYSQL指针对象
     MYSQL *mysql = NULL;
@@ -68,6 +76,290 @@ void http_conn::initmysql_result(connection_pool *connPool)
 /*******************数据库:函数需要补充*****************/
 
 
+/*
+ * @func: 从请求体中提取用户名和密码
+ *        eg:user=123&password=123
+ */
+static void parse_user(const char *body, int len, char *name, char *password, int size)
+{
+    int i = 5, j = 0;
+    for (; i < len && body[i] != '&' && j < size - 1; ++i, ++j)
+        name[j] = body[i];
+    name[j] = '\0';
+
+    j = 0;
+    for (i = i + 10; i < len && j < size - 1; ++i, ++j)
+        password[j] = body[i];
+    password[j] = '\0';
+}
+
+
+/*
+ * @func: 登录校验
+ *        若浏览器端输入的用户名和密码在表中可以查找到，跳转欢迎界面，否则跳转登陆失败的页面
+ */
+static void cgi_login(const handler_request &req, http_response &resp)
+{
+    int len = 0;
+    const char *body = req.body(len);
+    char name[100], password[100];
+    parse_user(body, len, name, password, sizeof(name));
+
+    m_lock.lock();
+    bool ok = users.find(name) != users.end() && users[name] == password;
+    m_lock.unlock();
+    resp.send_file(ok ? "/welcome.html" : "/logError.html");
+}
+
+
+/*
+ * 异步注册任务：数据库插入交给数据库任务执行器，在执行器的线程中执行
+ * 插入失败时把预先登记的用户名从本地的map中删除，完成后填写响应并交给连接所属的事件循环
+ */
+class register_task : public sql_task
+{
+public:
+    register_task(const char *name, const char *sql, http_async *async)
+        : m_name(name), m_sql(sql), m_async(async) {}
+
+    void run(MYSQL *mysql)
+    {
+        int res = mysql ? mysql_query(mysql, m_sql.c_str()) : 1;
+        finish(res == 0);
+    }
+
+    // 插入完成或提交失败(ok为false)时调用
+    void finish(bool ok)
+    {
+        if (!ok)
+        {
+            m_lock.lock();
+            users.erase(m_name);
+            m_lock.unlock();
+        }
+        m_async->response().send_file(ok ? "/log.html" : "/registerError.html");
+        m_async->complete();
+    }
+
+private:
+    std::string m_name;
+    std::string m_sql;
+    http_async *m_async;
+};
+
+
+/*
+ * @func: 注册
+ *        先检测数据库中是否有重名的，没有重名的，进行增加数据
+ * @note: 用户名先登记到本地的map中，同名的并发注册直接失败；数据库插入通过defer交给数据库任务执行器，
+ *        工作线程不等待数据库，也不在持有m_lock时访问数据库
+ *        执行器的线程数等于数据库连接数，任务队列满时立即回复注册失败，突发的注册不会创建更多线程
+ */
+static void cgi_register(const handler_request &req, http_response &resp)
+{
+    int len = 0;
+    const char *body = req.body(len);
+    char name[100], password[100];
+    parse_user(body, len, name, password, sizeof(name));
+
+    m_lock.lock();
+    // find函数会返回一个迭代器，在map中找name键
+    // 如果没有找到，迭代器将等于 users.end()，即注册的为新用户
+    if (users.find(name) != users.end())
+    {
+        m_lock.unlock();
+        // 注册失败，用户存在
+        resp.send_file("/registerError.html");
+        return;
+    }
+    // 将注册的新用户，账号密码也添加进本地的map中
+    users.insert(std::pair<std::string, std::string>(name, password));
+    m_lock.unlock();
+
+    //构建一个用于插入数据到数据库的user表中的 SQL 语句
+    char sql_insert[256];
+    snprintf(sql_insert, sizeof(sql_insert), "INSERT INTO user(username, passwd) VALUES('%s', '%s')",
+             name, password);
+
+    // 提交之前取得完成句柄，执行器可能在提交后立即执行任务
+    register_task *task = new register_task(name, sql_insert, resp.defer());
+    if (!sql_executor::get_instance()->submit(task))
+    {
+        // 任务队列已满，立即回复注册失败
+        task->finish(false);
+        delete task;
+    }
+}
+
+
+// 上传的文件保存在网站根目录下的该目录中，之后可以通过GET /upload/文件名 下载
+static const char UPLOAD_DIR[] = "/upload/";
+// 上传文件名的长度上限
+static const int UPLOAD_NAME_MAX = 64;
+// 上传文件的大小上限(字节)，由init_routes设置，0表示不开启上传接口
+static off_t s_upload_max = 0;
+
+
+/*
+ * @func: 检查上传的文件名：只能由字母、数字、.、-、_组成，不能以.开头
+ *        文件名中不能出现/，上传的文件只能保存在上传目录中
+ */
+static bool valid_upload_name(const char *name, int len)
+{
+    if (len <= 0 || len > UPLOAD_NAME_MAX || name[0] == '.')
+        return false;
+    for (int i = 0; i < len; ++i)
+    {
+        char c = name[i];
+        if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != '_')
+            return false;
+    }
+    return true;
+}
+
+
+/*
+ * @func: 上传文件
+ *        eg:PUT /upload/a.txt，请求体以流的形式写入上传目录中的a.txt，完成后回复201
+ * @note: 路由设置了stream_body，请求头部解析完即调用，请求体由file_body_sink分段写入文件，
+ *        上传的大小不受读缓冲区大小上限限制，而是受s_upload_max限制：Content-Length超出时回复413，
+ *        分块传输编码的请求体在写入超出时放弃上传(回复500并关闭连接，删除不完整的文件)
+ *        同名文件已经存在时回复409，不覆盖
+ */
+static void upload_file(const handler_request &req, http_response &resp)
+{
+    int len = 0;
+    const char *path = req.path(len);
+    const int prefix = sizeof(UPLOAD_DIR) - 1;
+    if (len <= prefix || !valid_upload_name(path + prefix, len - prefix))
+    {
+        resp.send(400, error_400_title, "text/plain", error_400_form, strlen(error_400_form));
+        return;
+    }
+    int value_len = 0;
+    const char *value = req.header(HEADER_CONTENT_LENGTH, value_len);
+    if (value)
+    {
+        // 字段值是读缓冲区的视图，不以\0结尾，逐位累加，超出上限即停止
+        off_t length = 0;
+        for (int i = 0; i < value_len && isdigit((unsigned char)value[i]) && length <= s_upload_max; ++i)
+            length = length * 10 + (value[i] - '0');
+        if (length > s_upload_max)
+        {
+            resp.send(413, "Payload Too Large", "text/plain", "", 0);
+            return;
+        }
+    }
+
+    char file[http_conn::FILENAME_LEN];
+    // 上传目录在第一次上传时创建
+    snprintf(file, sizeof(file), "%s%s", req.root(), UPLOAD_DIR);
+    mkdir(file, 0755);
+    snprintf(file, sizeof(file), "%s%s%.*s", req.root(), UPLOAD_DIR, len - prefix, path + prefix);
+
+    int fd = open(file, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd == -1)
+    {
+        if (errno == EEXIST)
+            resp.send(409, "Conflict", "text/plain", "", 0);
+        // 其他错误不填写响应，回复500
+        return;
+    }
+    resp.receive_body(new file_body_sink(fd, file, s_upload_max));
+}
+
+
+/*
+ * @func: 列出上传的文件
+ *        eg:GET /upload/，每个文件名一行
+ * @note: 事先不知道文件数量，以分块传输编码逐段发送，上一段发送完后才读取下一段的文件名
+ */
+static void list_uploads(const handler_request &req, http_response &resp)
+{
+    char dir[http_conn::FILENAME_LEN];
+    snprintf(dir, sizeof(dir), "%s%s", req.root(), UPLOAD_DIR);
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        // 还没有上传过文件
+        resp.send(200, ok_200_title, "text/plain", "", 0);
+        return;
+    }
+    resp.send_stream(200, ok_200_title, "text/plain", new dir_body_source(d));
+}
+
+
+/*
+ * @func: 服务器状态(JSON)
+ *        eg:{"connections":12,"threads":8,"min_threads":8,"max_threads":32,"queued":0,"tasks":1024,
+ *            "queue_wait_avg_us":15,"queue_wait_max_us":2300}
+ */
+static void api_status(const handler_request &, http_response &resp)
+{
+    pool_status pool = {0, 0, 0, 0, 0, 0, 0};
+    if (pool_monitor::get_instance())
+        pool_monitor::get_instance()->get_status(pool);
+    char body[256];
+    int len = snprintf(body, sizeof(body),
+                       "{\"connections\":%d,\"threads\":%d,\"min_threads\":%d,\"max_threads\":%d,"
+                       "\"queued\":%zu,\"tasks\":%lu,\"queue_wait_avg_us\":%lu,\"queue_wait_max_us\":%lu}",
+                       http_conn::m_user_count.load(), pool.threads, pool.min_threads, pool.max_threads,
+                       pool.queued, pool.tasks, pool.wait_avg_us, pool.wait_max_us);
+    resp.send(200, "OK", "application/json", body, len);
+}
+
+
+// 页面中的表单都以POST方式提交
+static const int GET_POST = (1 << http_conn::GET) | (1 << http_conn::POST);
+
+// 路由表，页面中表单的action为相对路径，提交到网站根目录下
+static const route s_routes[] = {
+    // 欢迎界面
+    {"/", ROUTE_EXACT, GET_POST, "/judge.html", NULL, false},
+    // 跳转注册界面
+    {"/0", ROUTE_PREFIX, GET_POST, "/register.html", NULL, false},
+    // 跳转登录界面
+    {"/1", ROUTE_PREFIX, GET_POST, "/log.html", NULL, false},
+    // 登录校验(2CGISQL.cgi)
+    {"/2", ROUTE_PREFIX, 1 << http_conn::POST, NULL, cgi_login, false},
+    // 注册(3CGISQL.cgi)
+    {"/3", ROUTE_PREFIX, 1 << http_conn::POST, NULL, cgi_register, false},
+    // 跳转pic
+    {"/5", ROUTE_PREFIX, GET_POST, "/picture.html", NULL, false},
+    // 跳转video
+    {"/6", ROUTE_PREFIX, GET_POST, "/video.html", NULL, false},
+    // 跳转weixin
+    {"/7", ROUTE_PREFIX, GET_POST, "/fans.html", NULL, false},
+    // 服务器状态
+    {"/api/status", ROUTE_EXACT, 1 << http_conn::GET, NULL, api_status, false},
+};
+
+// 上传接口，没有身份验证，写入网站根目录，只在配置了上传大小上限时登记
+static const route s_upload_routes[] = {
+    // 上传文件，请求体以流的形式写入文件
+    {UPLOAD_DIR, ROUTE_PREFIX, 1 << http_conn::PUT, NULL, upload_file, true},
+    // 列出上传的文件，以分块传输编码发送
+    {UPLOAD_DIR, ROUTE_EXACT, 1 << http_conn::GET, NULL, list_uploads, false},
+};
+
+
+/*
+ * @func: 将路由表登记到路由器中
+ * @param: upload_max_mb 上传文件的大小上限(MB)，大于0时才登记上传接口
+ */
+void http_conn::init_routes(int upload_max_mb)
+{
+    for (size_t i = 0; i < sizeof(s_routes) / sizeof(s_routes[0]); ++i)
+        http_router::get_instance()->add(s_routes[i]);
+
+    if (upload_max_mb <= 0)
+        return;
+    s_upload_max = (off_t)upload_max_mb * 1024 * 1024;
+    for (size_t i = 0; i < sizeof(s_upload_routes) / sizeof(s_upload_routes[0]); ++i)
+        http_router::get_instance()->add(s_upload_routes[i]);
+}
+
+
 /*
  * @func:对文件描述符设置为非阻塞
  */
@@ -138,31 +430,17 @@ void modfd(int epollfd, int fd, int ev, int TRIGMode)
 }
 
 
-/*
- * @func:关闭一个客户端http连接
- */
-void http_conn::close_conn(bool real_close)
-{
-    if (real_close && (m_sockfd != -1))
-    {
-        // printf("close %d\n", m_sockfd);
-        // 将该套接字文件描述符从epoll实例中移除
-        removefd(m_epollfd, m_sockfd);
-        m_sockfd = -1;
-        // 客户端连接数量 -1
-        m_user_count--;
-    }
-}
-
-
 /*
  * @func:初始化http连接,外部调用初始化套接字地址
  */
-void http_conn::init(int sockfd, const sockaddr_in &addr, char *root, int TRIGMode,
-                     int close_log, std::string user, std::string passwd, std::string sqlname)
+void http_conn::init(int sockfd, const sockaddr_in &addr, int epollfd, char *root, int TRIGMode,
+                     int close_log)
 {
     m_sockfd = sockfd;
     m_address = addr;
+    m_epollfd = epollfd;
+    // 连接对象来自空闲链表时，上一个连接的资源已经在回收时(release)归还，没有工作线程持有
+    m_hold = 0;
     // 将该http连接用于通信的套接字文件描述符，添加到epoll实例上
     addfd(m_epollfd, sockfd, true, m_TRIGMode);
     // 客户端连接数量+1
@@ -172,10 +450,10 @@ void http_conn::init(int sockfd, const sockaddr_in &addr, char *root, int TRIGMo
     doc_root = root;
     m_TRIGMode = TRIGMode;
     m_close_log = close_log;
-
-    strcpy(sql_user, user.c_str());
-    strcpy(sql_passwd, passwd.c_str());
-    strcpy(sql_name, sqlname.c_str());
+    // 文件描述符与连接对象都可能刚被上一个连接使用过，代数取自进程内唯一的计数器，
+    // 任意两个连接的代数都不同，过期的异步处理结果不会发给新连接
+    m_generation = ++m_next_generation;
+    m_response.bind(this);
 
     init();
 }
@@ -187,34 +465,196 @@ void http_conn::init(int sockfd, const sockaddr_in &addr, char *root, int TRIGMo
 void http_conn::init()
 {
     mysql = NULL;
-    bytes_to_send = 0;
-    bytes_have_send = 0;
+    m_read_idx = 0;
+    m_next_request = -1;
+    m_pipelined = false;
+    m_state = 0;
+    init_request();
+    init_response();
+    // 缓冲区在第一次读写时才从缓冲区池分配
+}
+
+
+/*
+ * @func:工作线程处理完任务，交回连接
+ * @note:事件循环在工作线程持有期间关闭连接时只标记关闭，连接对象与文件描述符都保留，
+ *       文件描述符不会被新连接复用；最后一个交回的工作线程负责回收
+ *       交回之前工作线程已经重新注册了事件(已关闭的连接已从epoll实例中删除，注册失败)或投递了完成队列
+ */
+void http_conn::unhold()
+{
+    if (m_hold.fetch_sub(HOLD_WORKER) == HOLD_WORKER + HOLD_CLOSED)
+        conn_table::get_instance()->recycle(m_slot);
+}
+
+
+/*
+ * @func:回收已关闭的连接：释放上传与分块响应、归还资源文件与缓冲区，关闭套接字
+ * @note:由关闭连接的事件循环(没有工作线程持有时)或最后交回连接的工作线程调用，此时只有调用者访问该连接
+ *       上传途中关闭的连接，不完整的文件在这里删除
+ */
+void http_conn::release()
+{
+    drop_streams();
+    close_files();
+    m_read_idx = 0;
+    release_buffers();
+    close(m_sockfd);
+    m_sockfd = -1;
+    // 减少连接数
+    m_user_count--;
+}
+
+
+/*
+ * @func:初始化一个请求的解析状态
+ *      读缓冲区中的数据(流水线中的后续请求)保持不变
+ */
+void http_conn::init_request()
+{
     m_check_state = CHECK_STATE_REQUESTLINE;
     m_linger = false;
+    m_accept_encoding = 0;
+    m_range = false;
+    m_range_start = -1;
+    m_range_end = -1;
     m_method = GET;
-    m_url = 0;
-    m_version = 0;
     m_content_length = 0;
-    m_host = 0;
+    m_body_left = 0;
+    m_chunked = false;
+    m_decoder.reset();
+    m_request.clear();
     m_start_line = 0;
     m_checked_idx = 0;
-    m_read_idx = 0;
+    // m_real_file由do_request通过set_real_file完整写入(包括结尾的\0)，这里不需要清零
+}
+
+
+/*
+ * @func:初始化一批响应的发送状态
+ */
+void http_conn::init_response()
+{
+    bytes_to_send = 0;
+    bytes_have_send = 0;
     m_write_idx = 0;
-    cgi = 0;
-    m_state = 0;
-    timer_flag = 0;
-    improv = 0;
+    m_iv_write_idx = 0;
+    m_iv_count = 0;
+    m_iv_idx = 0;
+    m_batch_count = 0;
+    m_batch_linger = false;
+}
+
+
+/*
+ * @func:丢弃已经处理完的请求，将读缓冲区中剩余的数据移动到缓冲区开头，准备解析下一个请求
+ * @note:HTTP/1.1流水线中客户端不等待响应就连续发送多个请求，
+ *       一次读取可能读到多个请求，当前请求之后的数据属于后续请求，不能丢弃
+ */
+void http_conn::next_request()
+{
+    int left = 0;
+    if (m_next_request >= 0)
+    {
+        left = m_read_idx - m_next_request;
+        if (left > 0)
+            memmove(m_read_buf.data(), m_read_buf.data() + m_next_request, left);
+    }
+    m_read_idx = left;
+    m_next_request = -1;
+    init_request();
+}
+
+
+/*
+ * @func:是否继续解析流水线中的下一个请求，将其响应追加到本批响应之后一起发送
+ * @note:当前请求已完整解析且读缓冲区中还有数据时才继续
+ *       短连接、需要sendfile发送的文件、本批响应数量或m_write_buf剩余空间达到上限时结束本批
+ */
+bool http_conn::pipeline_ready()
+{
+    return m_linger && !m_file && !m_source && m_sockfd != -1 &&
+           m_next_request >= 0 && m_next_request < m_read_idx &&
+           m_batch_count < PIPELINE_MAX &&
+           buffer_pool::get_instance()->get_max_size() - m_write_idx >= PIPELINE_WRITE_RESERVE;
+}
+
+
+/*
+ * @func:长连接的响应发送完毕，准备处理下一个请求
+ * @note:读缓冲区中还有后续请求时不重新注册读事件(数据已经读入，套接字上可能不会再有读事件)，
+ *       而是标记m_pipelined，由调用者通过take_pipelined得知后继续调用process
+ *       最后一个请求只解析了一部分时保留解析状态，收到剩余数据后继续解析
+ */
+void http_conn::keep_alive()
+{
+    init_response();
+    if (m_next_request >= 0)
+    {
+        next_request();
+        if (m_read_idx > 0)
+        {
+            m_pipelined = true;
+            return;
+        }
+    }
+    // 等待客户端的下一个请求，缓冲区先归还
+    release_buffers();
+    // 重新注册读事件
+    // 先初始化再注册，避免Reactor模式下其他工作线程在初始化之前就处理该连接的下一个请求
+    modfd(m_epollfd, m_sockfd, EPOLLIN, m_TRIGMode);
+}
 
-    // 初始化清空缓冲区
-    memset(m_read_buf, '\0', READ_BUFFER_SIZE);
-    memset(m_write_buf, '\0', WRITE_BUFFER_SIZE);
-    memset(m_real_file, '\0', FILENAME_LEN);
+
+/*
+ * @func:读缓冲区已满时扩容，首次读取时分配
+ * @note:已经解析出的字段(m_request)记录的是相对缓冲区起始位置的偏移，扩容后不需要调整
+ */
+bool http_conn::grow_read_buf()
+{
+    if (m_read_idx < m_read_buf.size())
+        return true;
+    return m_read_buf.reserve(m_read_idx + 1, m_read_idx);
+}
+
+
+/*
+ * @func:写缓冲区扩容
+ * @note:扩容后缓冲区首地址改变，已经指向写缓冲区的iovec(流水线中前面请求的响应)需要移动到新缓冲区的对应位置
+ */
+bool http_conn::grow_write_buf(int need)
+{
+    char *old = m_write_buf.data();
+    int old_size = m_write_buf.size();
+    if (!m_write_buf.reserve(need, m_write_idx))
+        return false;
+
+    char *base = m_write_buf.data();
+    for (int i = 0; i < m_iv_count; ++i)
+    {
+        char *p = (char *)m_iv[i].iov_base;
+        if (old && p >= old && p < old + old_size)
+            m_iv[i].iov_base = base + (p - old);
+    }
+    return true;
 }
 
 
 /*
- * @func:从状态机，用于(在请求报文中)分析出一行内容,并且将一行的末尾\r\n变为\0\0
+ * @func:连接空闲时将读写缓冲区归还给缓冲区池，空闲的长连接不再占用缓冲区内存
+ */
+void http_conn::release_buffers()
+{
+    m_write_buf.release();
+    if (m_read_idx == 0)
+        m_read_buf.release();
+}
+
+
+/*
+ * @func:从状态机，用于(在请求报文中)分析出一行内容
  *      解析一行，判断依据，每一行均以\r\n结束 空行则是仅仅是字符\r\n
+ *      行的内容为[m_start_line, m_checked_idx - 2)，不修改读缓冲区
  * @return:
  *      LINE_OK   读取到一个完整的行
  *      LINE_BAD  行出错
@@ -223,11 +663,14 @@ void http_conn::init()
 http_conn::LINE_STATUS http_conn::parse_line()
 {
     char temp;
+    const char *buf = m_read_buf.data();
     // m_read_idx 为读缓冲区m_read_buf的数据字节数量（指向缓冲区m_read_buf的数据末尾的下一个字节索引）
-    for(;m_checked_idx < m_read_idx; ++m_checked_idx)
+    // 直接跳到下一个\r或\n，中间的字节由scan_line_end成组比较
+    m_checked_idx = scan_line_end(buf, m_checked_idx, m_read_idx);
+    if (m_checked_idx < m_read_idx)
     {
         // m_checked_idx为当前分析的字符位置
-        temp = m_read_buf[m_checked_idx];
+        temp = buf[m_checked_idx];
 
         // 如果当前是\r字符，则有可能会读取到完整行
         if(temp == '\r')
@@ -237,12 +680,10 @@ http_conn::LINE_STATUS http_conn::parse_line()
                 // 下一个字符达到了buffer结尾，则接收不完整，需要继续接收
                 return LINE_OPEN;
             }
-            else if(m_read_buf[m_checked_idx+1] == '\n')
+            else if(buf[m_checked_idx+1] == '\n')
             {
-                // 下一个字符是\n，将\r\n改为\0\0
-                // m_checked_idx++ (后增)执行完这句代码之后，m_checked_idx才会自增
-                m_read_buf[m_checked_idx++] = '\0';
-                m_read_buf[m_checked_idx++] = '\0';
+                // 下一个字符是\n，跳过\r\n
+                m_checked_idx += 2;
                 // 此时的m_check指向的 下一行开始的索引位置
                 // 完整的接收一行
                 return LINE_OK;
@@ -256,10 +697,9 @@ http_conn::LINE_STATUS http_conn::parse_line()
         else if(temp == '\n')
         {
             // 判断前一个字符是否是\r,若是则接收到完整行
-            if (m_checked_idx > 1 && m_read_buf[m_checked_idx - 1] == '\r')
+            if (m_checked_idx > 1 && buf[m_checked_idx - 1] == '\r')
             {
-                m_read_buf[m_checked_idx - 1] = '\0';
-                m_read_buf[m_checked_idx++] = '\0';
+                m_checked_idx++;
                 return LINE_OK;
             }
             // 否则行出错
@@ -281,8 +721,8 @@ http_conn::LINE_STATUS http_conn::parse_line()
  */
 bool http_conn::read_once()
 {
-    // m_read_buf满
-    if (m_read_idx >= READ_BUFFER_SIZE)
+    // m_read_buf满，扩容到大小上限后仍然放不下，请求过大
+    if (!grow_read_buf())
     {
         return false;
     }
@@ -294,7 +734,7 @@ bool http_conn::read_once()
     {
         // recv函数
         // <0 出错 =0 关闭连接 >0 接收到的数据字节数量
-        bytes_read = recv(m_sockfd, m_read_buf + m_read_idx, READ_BUFFER_SIZE - m_read_idx, 0);
+        bytes_read = recv(m_sockfd, m_read_buf.data() + m_read_idx, m_read_buf.size() - m_read_idx, 0);
         // 记录m_read_buf读了多少数据了
         m_read_idx += bytes_read;
 
@@ -311,8 +751,15 @@ bool http_conn::read_once()
     {
         while (true)
         {
+            // m_read_buf满时扩容
+            // 流式接收请求体时不扩容，或者已经达到大小上限时，先处理已经读入的数据(例如交给m_sink)，
+            // 剩余数据留在套接字中，重新注册EPOLLIN后继续读取
+            if (m_read_idx == m_read_buf.size() && (m_sink || !grow_read_buf()))
+            {
+                break;
+            }
             // 从通信套接字的读缓冲区，读取数据到m_read_buf
-            bytes_read = recv(m_sockfd, m_read_buf + m_read_idx, READ_BUFFER_SIZE - m_read_idx, 0);
+            bytes_read = recv(m_sockfd, m_read_buf.data() + m_read_idx, m_read_buf.size() - m_read_idx, 0);
             if (bytes_read == -1)
             {
                 // 非阻塞ET模式下，需要一次性将数据读完，无错
@@ -338,51 +785,82 @@ bool http_conn::read_once()
 }
 
 
+/*
+ * @func:io_uring引擎模式下，处理事件循环批量提交的一次recv操作的结果
+ * @param:bytes recv的返回值，出错时为-errno
+ * @note:LT模式下与read_once一致，只读取一次
+ *       ET模式下需要读空套接字读缓冲区：没有填满m_read_buf说明已经读空，填满时继续同步读取
+ * @return:与read_once一致
+ */
+bool http_conn::read_complete(int bytes)
+{
+    if (0 == m_TRIGMode)
+    {
+        if (bytes <= 0)
+            return false;
+        m_read_idx += bytes;
+        return true;
+    }
+
+    // 套接字读缓冲区为空
+    if (bytes == -EAGAIN || bytes == -EWOULDBLOCK)
+        return true;
+    // 出错或客户端断开连接
+    if (bytes <= 0)
+        return false;
+
+    int space = m_read_buf.size() - m_read_idx;
+    m_read_idx += bytes;
+    if (bytes < space)
+        return true;
+    return read_once();
+}
+
+
 /*
  * @func:解析http请求行(主状态机的初始状态)，获得请求方法，目标url及http版本号
  *      解析成功，主状态机状态转移至 请求头
- *      text是指向m_read_buf中每一行数据的起始位置，此时的m_read_buf已经被处理了，\r\n均被处理为\0
- *      因此char *text就可以指向从该行起始位置至\0索引处截至的数据
+ *      text是指向m_read_buf中该行数据的起始位置，len为不包括\r\n的行长度
+ *      各部分只记录在读缓冲区中的位置(m_request)，不修改读缓冲区
  * @note:在HTTP报文中，请求行用来说明请求类型
  *      请求行组成: 请求方法 空格 URL(请求的资源) 空格 HTTP协议版本
  *      GET /index HTTP/1.1 ---> 此处的URL 若无 所以为 /
  *      要访问的资源以及所使用的HTTP版本，其中各个部分之间通过\t或空格分隔。
- *      请求行中最先含有空格和\t任一字符的位置并返回
  */
-http_conn::HTTP_CODE http_conn::parse_request_line(char *text)
+http_conn::HTTP_CODE http_conn::parse_request_line(const char *text, int len)
 {
-    // strpbrk 判断 空格 与 \t 哪一个在text最先出现,成功找到返回指向该字符的指针
+    const char *end = text + len;
+
+    // 请求方法：到第一个空格或\t为止
     // 此处考虑制表符号 \t 可能是考虑服务器的容错能力
-    m_url = strpbrk(text," \t");
+    const char *url = text;
+    while (url < end && *url != ' ' && *url != '\t')
+        ++url;
     // 如果没有空格或\t，则报文格式有误
-    if (!m_url)
+    if (url == end)
     {
         return BAD_REQUEST;
     }
+    m_request.method = make_view(text, url - text);
 
-    // 将该位置改为\0，用于将前面数据取出
-    // GET\0/index.html HTTP/1.1
-    // 置位空字符，字符串结束符---向将m_url索引处字符置\0,然后再后移
-    *m_url++ = '\0';
-
-    // 取出数据，并通过与GET和POST比较，以确定请求方式
-    char *method = text;
-    // strcasecmp函数比较两个字符是否相等，会忽略大小写的差异
-    if (strcasecmp(method, "GET") == 0)
+    // 通过与GET和POST比较(忽略大小写)，以确定请求方式
+    if (view_case_equal(text, url - text, "GET"))
     {
         // 此次请求为GET方法
         m_method = GET;
     }
-    else if (strcasecmp(method, "POST") == 0)
+    else if (view_case_equal(text, url - text, "POST"))
     {
         // 此次请求为POST方法
         m_method = POST;
-        // 当请求方法为POST方法，将cgi设置为1
-        // 这种情况，请求报文会将用户名与密码放到请求体中
-        // 而服务器初始化时，会读取数据库服务器中的user表，并且将user表中已经存在的username与passwd
+        // 登录与注册请求会将用户名与密码放到请求体中，由路由表中只接受POST的处理函数处理
+        // 服务器初始化时，会读取数据库服务器中的user表，并且将user表中已经存在的username与passwd
         // 存储到webServer服务器(相较于数据库服务器就是客户端)本地map结构中，方便查询
-        // 用于后续的用户注册与登陆
-        cgi = 1;
+    }
+    else if (view_case_equal(text, url - text, "PUT"))
+    {
+        // 上传，只由路由表中接受PUT的处理函数处理
+        m_method = PUT;
     }
     else
     {
@@ -390,60 +868,60 @@ http_conn::HTTP_CODE http_conn::parse_request_line(char *text)
         return BAD_REQUEST;
     }
 
-    // 最好的情况:
-    // /index.html HTTP/1.1
-    // 以上面的实例: 此时的m_url指向 /index.html 的 / 位置
-    // 其他情况: 如 GET\0    /index.html HTTP/1.1  请求方法与URL之间多了很多空格
-    // m_url此时跳过了第一个空格或\t字符，但不知道之后是否还有
-    // 将m_url向后偏移，通过查找
-    // 继续跳过空格和\t字符，指向请求资源的第一个字符
-    // strspn: 返回 str1 中连续包含 str2 中字符的最长前缀的长度
-    m_url += strspn(m_url, " \t");
+    // 请求方法与URL之间可能有多个空格或\t字符，跳过它们，指向请求资源的第一个字符
+    while (url < end && (*url == ' ' || *url == '\t'))
+        ++url;
     // 找到URL 与 HTTP协议版本之间的 空格或者制表符 \t
-    m_version = strpbrk(m_url, " \t");
-    if (!m_version)
+    const char *version = url;
+    while (version < end && *version != ' ' && *version != '\t')
+        ++version;
+    if (version == end)
     {
         // 如果没有空格或\t，则报文格式有误
         return BAD_REQUEST;
     }
-    // /index.html\0HTTP/1.1
-    // 置位空字符，字符串结束符
-    *m_version++ = '\0';
+    const char *url_end = version;
 
-    // 此时m_version指向 /index.html\0 后位置的字符，但是这个字符可能是空格或者\t,因此需要继续跳过
-    m_version += strspn(m_version, " \t");
-    //仅支持HTTP/1.1
-    if (strcasecmp(m_version, "HTTP/1.1") != 0)
+    // 继续跳过空格和\t字符
+    while (version < end && (*version == ' ' || *version == '\t'))
+        ++version;
+    //仅支持HTTP 1.1
+    if (!view_case_equal(version, end - version, "HTTP/1.1"))
     {
         return BAD_REQUEST;
     }
+    m_request.version = make_view(version, end - version);
 
-    // 对请求资源前7个字符进行判断
     // 可能的URL会出现如下情况: http://192.168.110.129:10000/index.html
-    // 这里主要是有些报文的请求资源中会带有http://
-    // 这里需要对这种情况进行单独处理
-    if (strncasecmp(m_url, "http://", 7) == 0)
+    // 这里主要是有些报文的请求资源中会带有http://或https://
+    // 跳过协议与主机部分，从第一个斜杠 / 开始才是URL路径
+    int scheme = 0;
+    if (url_end - url >= 7 && strncasecmp(url, "http://", 7) == 0)
+        scheme = 7;
+    else if (url_end - url >= 8 && strncasecmp(url, "https://", 8) == 0)
+        scheme = 8;
+    if (scheme)
     {
-        m_url += 7;
-        // 使用 strchr 查找第一个斜杠 /，这通常是URL路径的开始
-        m_url = strchr(m_url, '/');
-    }
-
-    //同样增加https情况
-    if (strncasecmp(m_url, "https://", 8) == 0)
-    {
-        m_url += 8;
-        // 使用 strchr 查找第一个斜杠 /，这通常是URL路径的开始
-        m_url = strchr(m_url, '/');
+        url = (const char *)memchr(url + scheme, '/', url_end - url - scheme);
+        if (!url)
+            return BAD_REQUEST;
     }
 
     // 一般的不会带有上述两种符号，直接是单独的/或/后面带访问资源
-    if (!m_url || m_url[0] != '/')
+    if (url == url_end || url[0] != '/')
         return BAD_REQUEST;
 
-    // 当url为/时，显示欢迎界面
-    if (strlen(m_url) == 1)
-        strcat(m_url, "judge.html");
+    // ?之后为查询字符串，资源路径不包括它
+    const char *query = (const char *)memchr(url, '?', url_end - url);
+    if (query)
+    {
+        m_request.path = make_view(url, query - url);
+        m_request.query = make_view(query + 1, url_end - query - 1);
+    }
+    else
+    {
+        m_request.path = make_view(url, url_end - url);
+    }
 
     //请求行处理完毕，将主状态机转移处理请求头
     m_check_state = CHECK_STATE_HEADER;
@@ -454,21 +932,25 @@ http_conn::HTTP_CODE http_conn::parse_request_line(char *text)
 /*
  * @func:解析http请求的一个头部信息
  *      在报文中，请求头和空行的处理使用的同一个函数
- *      通过判断当前的text首位是不是\0字符，若是，则表示当前处理的是空行，若不是，则表示当前处理的是请求头
- * @note:请求头可以有多行数据，而text每次只指向请求报文的一行数据
+ *      通过判断当前行的长度是否为0，若是，则表示当前处理的是空行，若不是，则表示当前处理的是请求头
+ * @note:请求头可以有多行数据，而text每次只指向请求报文的一行数据，len为不包括\r\n的行长度
+ *      每个字段都保存在m_request中，其中需要处理的字段在这里解析
  */
-http_conn::HTTP_CODE http_conn::parse_headers(char *text)
+http_conn::HTTP_CODE http_conn::parse_headers(const char *text, int len)
 {
     // 判断是空行还是请求头
     // 解析空行
-    if(text[0] == '\0')
+    if(len == 0)
     {
         // 判断是GET还是POST请求
         // GET请求，参数通过 URL 传递，无请求体数据
         // POST请求，参数放到请求体中
         // 判断是否有请求体数据，即m_content_length != 0
-        if(m_content_length != 0)
+        if(m_content_length != 0 || m_chunked)
         {
+            // 请求体从空行之后开始，分块传输编码的请求体边读入边解码到这里
+            m_request.body.off = m_checked_idx;
+            m_request.body.len = 0;
             // 主状态机状态转移到 请求体 CHECK_STATE_CONTENT
             m_check_state = CHECK_STATE_CONTENT;
             // 因为该请求报文，还有请求体数据，因此请求数据不完整，继续获取
@@ -479,71 +961,294 @@ http_conn::HTTP_CODE http_conn::parse_headers(char *text)
     }
 
     // 解析请求头
-    // 解析请求头部connection字段
-    else if(strncasecmp(text, "Connection:", 11) == 0)
+    // 字段名为冒号之前的部分，按长度分支查找
+    const char *colon = (const char *)memchr(text, ':', len);
+    if (!colon)
     {
-        // 比较text中的前11个字符是否是Connection，忽略大小写
-        text += 11;
-
-        // 跳过空格和\t字符
-        text += strspn(text, " \t");
-        if (strcasecmp(text, "keep-alive") == 0)
+        LOG_INFO("oop!unknow header: %.*s", len, text);
+        return NO_REQUEST;
+    }
+    int name_len = colon - text;
+    HTTP_HEADER id = lookup_header(text, name_len);
+
+    // 字段值去掉两端的空格和\t字符
+    const char *value = colon + 1;
+    const char *end = text + len;
+    while (value < end && (*value == ' ' || *value == '\t'))
+        ++value;
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t'))
+        --end;
+    int value_len = end - value;
+    m_request.add_field(id, make_view(text, name_len), make_view(value, value_len));
+
+    switch (id)
+    {
+    // 解析请求头部connection字段
+    case HEADER_CONNECTION:
+        if (view_case_equal(value, value_len, "keep-alive"))
         {
             // 如果是长连接，则将linger标志设置为true
             m_linger = true;
         }
+        break;
+    // 解析请求头部Content-length字段，获得请求体数据长度
+    // 数字之后是\r\n，atol在第一个非数字字符处停止
+    case HEADER_CONTENT_LENGTH:
+        m_content_length = strtoll(value, NULL, 10);
+        if (m_content_length < 0)
+            return BAD_REQUEST;
+        break;
+    // 解析请求头部Transfer-Encoding字段，只支持最后一层编码为chunked(请求体长度由分块决定)
+    case HEADER_TRANSFER_ENCODING:
+        if (value_len < 7 || strncasecmp(end - 7, "chunked", 7) != 0)
+            return BAD_REQUEST;
+        m_chunked = true;
+        break;
+    // 解析请求头部Accept-Encoding字段，用于选择预压缩文件
+    case HEADER_ACCEPT_ENCODING:
+        parse_accept_encoding(value, value_len);
+        break;
+    // 解析请求头部Range字段，视频拖动进度条时浏览器只请求文件的一部分
+    case HEADER_RANGE:
+        parse_range(value, value_len);
+        break;
+    // Host、If-Range、If-None-Match、If-Modified-Since等字段在do_request中从m_request获取
+    case HEADER_UNKNOWN:
+        LOG_INFO("oop!unknow header: %.*s", len, text);
+        break;
+    default:
+        break;
     }
-    // 解析请求头部Content-length字段
-    else if(strncasecmp(text, "Content-length:", 15) == 0)
+    // 请求不完整，继续获取请求数据
+    return NO_REQUEST;
+}
+
+
+/*
+ * @func:解析请求头部Accept-Encoding字段，记录客户端接受的gzip/br编码
+ *      例如 Accept-Encoding: gzip, deflate, br;q=1.0, *;q=0
+ * @note:q=0表示不接受该编码，*表示接受所有编码
+ */
+void http_conn::parse_accept_encoding(const char *text, int len)
+{
+    const char *end = text + len;
+    while (text < end)
     {
-        text += 15;
+        // 以,分隔的一项
+        const char *next = (const char *)memchr(text, ',', end - text);
+        const char *token_end = next ? next : end;
         // 跳过空格和\t字符
-        text += strspn(text, " \t");
-        // 获得请求体数据长度
-        m_content_length = atol(text);
+        while (text < token_end && (*text == ' ' || *text == '\t'))
+            ++text;
+        // 编码名称的长度，名称后面可能跟着;q=权重
+        int name_len = 0;
+        while (text + name_len < token_end && text[name_len] != ' ' && text[name_len] != '\t' &&
+               text[name_len] != ';')
+            ++name_len;
+        const char *q = text + name_len;
+        while (q + 1 < token_end && !(q[0] == 'q' && q[1] == '='))
+            ++q;
+        bool refused = q + 1 < token_end && atof(q + 2) <= 0;
+
+        if (refused)
+            ;
+        else if (view_case_equal(text, name_len, "gzip"))
+            m_accept_encoding |= 1 << ENCODING_GZIP;
+        else if (view_case_equal(text, name_len, "br"))
+            m_accept_encoding |= 1 << ENCODING_BR;
+        else if (name_len == 1 && text[0] == '*')
+            m_accept_encoding |= (1 << ENCODING_GZIP) | (1 << ENCODING_BR);
+
+        if (!next)
+            break;
+        text = next + 1;
     }
-    // 解析请求头部Host字段
-    else if(strncasecmp(text, "Host:", 5) == 0)
+}
+
+
+/*
+ * @func:解析请求头部Range字段，例如 Range: bytes=0-1023、bytes=1024-、bytes=-500
+ * @note:只支持单个范围，多个范围(multipart/byteranges)或格式错误时忽略Range，发送整个文件
+ *      字段值之后是\r\n，strtoll在第一个非数字字符处停止
+ */
+void http_conn::parse_range(const char *text, int len)
+{
+    if (len < 6 || strncasecmp(text, "bytes=", 6) != 0)
+        return;
+    const char *end = text + len;
+    text += 6;
+    if (memchr(text, ',', end - text))
+        return;
+
+    const char *dash = (const char *)memchr(text, '-', end - text);
+    if (!dash)
+        return;
+    char *num_end = NULL;
+    // 后缀范围：-suffix 表示文件的最后suffix个字节
+    if (dash == text)
     {
-        text += 5;
-        // 跳过空格和\t字符
-        text += strspn(text, " \t");
-        m_host = text;
+        m_range_end = strtoll(dash + 1, &num_end, 10);
+        if (num_end == dash + 1 || num_end != end)
+            return;
     }
     else
     {
-        LOG_INFO("oop!unknow header: %s", text);
+        m_range_start = strtoll(text, &num_end, 10);
+        if (num_end != dash || m_range_start < 0)
+            return;
+        // 省略结束位置表示到文件末尾
+        if (dash + 1 != end)
+        {
+            m_range_end = strtoll(dash + 1, &num_end, 10);
+            if (num_end != end || m_range_end < m_range_start)
+                return;
+        }
     }
-    // 请求不完整，继续获取请求数据
-    return NO_REQUEST;
+    m_range = true;
 }
 
 
 /*
- * @func:仅用于解析POST请求报文中的请求体
- *      用于保存post请求消息体，为后面的登录和注册做准备
- * @note:该项目将用于登陆与注册的用户名封装在POST请求报文的请求体中
+ * @func:根据文件大小确定最终发送的范围[m_range_start, m_range_end]
+ * @note:If-Range与文件的实体标签或最后修改时间不一致，说明文件已经改变，忽略Range发送整个文件
+ * @return:FILE_REQUEST 范围有效或忽略Range
+ *         RANGE_NOT_SATISFIABLE 范围超出文件大小
  */
-http_conn::HTTP_CODE http_conn::parse_content(char *text)
+http_conn::HTTP_CODE http_conn::resolve_range()
 {
-    if (m_read_idx >= (m_content_length + m_checked_idx))
+    http_view if_range;
+    if (m_request.get(HEADER_IF_RANGE, if_range) &&
+        !view_equal(view_data(if_range), if_range.len, m_file->etag) &&
+        !view_equal(view_data(if_range), if_range.len, m_file->last_modified))
     {
-        // 将请求体末尾字符的下一个位置标识为\0
-        // 方便通过text直接获取请求体内容
-        text[m_content_length] = '\0';
-        // 获取请求体内容
-        // POST请求中最后为输入的用户名和密码
-        m_string = text;
-        // 获得一个完整的客户请求，此时为POST请求
-        return GET_REQUEST;
+        m_range = false;
+        return FILE_REQUEST;
     }
-    // 客户端请求体内容还没有完全得到，需要继续获取请求数据
-    return NO_REQUEST;
+
+    off_t size = m_file->st.st_size;
+    // 后缀范围
+    if (m_range_start < 0)
+    {
+        if (m_range_end <= 0 || size == 0)
+            return RANGE_NOT_SATISFIABLE;
+        m_range_start = m_range_end >= size ? 0 : size - m_range_end;
+        m_range_end = size - 1;
+        return FILE_REQUEST;
+    }
+    if (m_range_start >= size)
+        return RANGE_NOT_SATISFIABLE;
+    if (m_range_end < 0 || m_range_end >= size)
+        m_range_end = size - 1;
+    return FILE_REQUEST;
 }
 
 
 /*
- * @func:（主状态机）有限状态机处理请求报文
+ * @func:判断客户端缓存的资源文件是否仍然有效
+ * @note:If-None-Match优先，其值为*或实体标签列表中有一个与文件一致(弱比较，忽略W/前缀)时有效
+ *       没有If-None-Match时，文件的修改时间不晚于If-Modified-Since时有效
+ */
+bool http_conn::not_modified()
+{
+    http_view field;
+    if (m_request.get(HEADER_IF_NONE_MATCH, field))
+    {
+        const char *text = view_data(field);
+        const char *end = text + field.len;
+        while (text < end)
+        {
+            // 以,分隔的一个实体标签
+            const char *next = (const char *)memchr(text, ',', end - text);
+            const char *token_end = next ? next : end;
+            // 跳过空格和\t字符
+            while (text < token_end && (*text == ' ' || *text == '\t'))
+                ++text;
+            if (text < token_end && text[0] == '*')
+                return true;
+            if (token_end - text >= 2 && strncmp(text, "W/", 2) == 0)
+                text += 2;
+            int len = 0;
+            while (text + len < token_end && text[len] != ' ' && text[len] != '\t')
+                ++len;
+            if (view_equal(text, len, m_file->etag))
+                return true;
+            if (!next)
+                break;
+            text = next + 1;
+        }
+        return false;
+    }
+
+    if (m_request.get(HEADER_IF_MODIFIED_SINCE, field))
+    {
+        const char *text = view_data(field);
+        if (view_equal(text, field.len, m_file->last_modified))
+            return true;
+        // 与Last-Modified格式不完全一致时按HTTP日期解析，strptime需要以\0结尾的字符串
+        char date[64];
+        if (field.len >= (int)sizeof(date))
+            return false;
+        memcpy(date, text, field.len);
+        date[field.len] = '\0';
+        struct tm tm;
+        memset(&tm, 0, sizeof tm);
+        if (strptime(date, "%a, %d %b %Y %H:%M:%S GMT", &tm) == NULL)
+            return false;
+        return m_file->st.st_mtime <= timegm(&tm);
+    }
+    return false;
+}
+
+
+/*
+ * @func:仅用于解析POST请求报文中的请求体
+ *      用于保存post请求消息体，为后面的登录和注册做准备
+ * @note:该项目将用于登陆与注册的用户名封装在POST请求报文的请求体中
+ */
+http_conn::HTTP_CODE http_conn::parse_content()
+{
+    // 分块传输编码：解码新到达的数据，追加到已解码的请求体之后
+    if (m_chunked)
+    {
+        int start = m_request.body.off + m_request.body.len;
+        char *data = m_read_buf.data() + start;
+        int len = 0;
+        int used = m_decoder.decode(data, m_read_idx - start, data, len);
+        if (used < 0)
+        {
+            m_next_request = m_read_idx;
+            return BAD_REQUEST;
+        }
+        m_request.body.len += len;
+        if (m_decoder.done())
+        {
+            // 最后一块之后就是流水线中的下一个请求
+            m_next_request = start + used;
+            return GET_REQUEST;
+        }
+        // 输入已经全部解码，丢弃解码后多出的部分，后续数据紧接着已解码的请求体读入
+        m_read_idx = m_request.body.off + m_request.body.len;
+        return NO_REQUEST;
+    }
+
+    if (m_read_idx >= (m_content_length + m_checked_idx))
+    {
+        // 记录请求体在读缓冲区中的位置
+        // POST请求中最后为输入的用户名和密码
+        m_request.body.off = m_checked_idx;
+        m_request.body.len = m_content_length;
+        // 请求体之后就是流水线中的下一个请求
+        m_next_request = m_checked_idx + m_content_length;
+        // 获得一个完整的客户请求，此时为POST请求
+        return GET_REQUEST;
+    }
+    // 客户端请求体内容还没有完全得到，需要继续获取请求数据
+    return NO_REQUEST;
+}
+
+
+/*
+ * @func:（主状态机）有限状态机处理请求报文
  *      根据当前主状态机的状态对报文进行处理
  * @note:GET和POST请求报文的区别之一是有无消息体部分
  */
@@ -552,7 +1257,8 @@ http_conn::HTTP_CODE http_conn::process_read()
     // 初始化从状态机状态、HTTP请求解析结果
     LINE_STATUS line_status = LINE_OK;
     HTTP_CODE ret = NO_REQUEST;
-    char *text = 0;
+    const char *text = 0;
+    int len = 0;
 
     // 两种情况均可以进入while
     // 1. 从状态机成功获取请求报文的一行 请求行/请求头部/空行/ 均以/r/n 结束
@@ -566,8 +1272,10 @@ http_conn::HTTP_CODE http_conn::process_read()
 
         // 移动到当前处理行的初始位置
         // m_start_line是行在buffer中的起始位置，将该位置后面的数据赋给text
-        // 此时从状态机已提前将一行的末尾字符\r\n变为\0\0，所以text可以直接取出完整的行进行解析
+        // 从状态机不修改读缓冲区，行的长度为m_checked_idx减去行首位置与末尾的\r\n
+        // (请求体不是按行解析的，长度无意义)
         text = get_line();
+        len = m_checked_idx - 2 - m_start_line;
 
         // m_start_line是每一个数据行在m_read_buf中的起始位置
         // 进入循环表示parse_line==LINE_OK
@@ -587,10 +1295,11 @@ http_conn::HTTP_CODE http_conn::process_read()
             case CHECK_STATE_REQUESTLINE:
             {
                 // 解析HTTP请求行
-                ret = parse_request_line(text);
+                ret = parse_request_line(text, len);
                 if(ret == BAD_REQUEST)
                 {
-                    // 客户端请求报文语法错误，返回
+                    // 客户端请求报文语法错误，无法确定请求的边界，丢弃已经读取的全部数据
+                    m_next_request = m_read_idx;
                     return BAD_REQUEST;
                 }
                 break;
@@ -599,10 +1308,11 @@ http_conn::HTTP_CODE http_conn::process_read()
             case CHECK_STATE_HEADER:
             {
                 // 解析HTTP请求头
-                ret = parse_headers(text);
+                ret = parse_headers(text, len);
                 if(ret == BAD_REQUEST)
                 {
-                    // 客户端请求报文语法错误，返回
+                    // 客户端请求报文语法错误，无法确定请求的边界，丢弃已经读取的全部数据
+                    m_next_request = m_read_idx;
                     return BAD_REQUEST;
                 }
                 // 完整解析GET请求后，跳转到报文响应函数
@@ -614,15 +1324,32 @@ http_conn::HTTP_CODE http_conn::process_read()
                     // 即 获得了一个完整的客户请求
                     // 解析具体的请求信息
                     // 调用do_request完成请求资源映射
+                    // 空行之后就是流水线中的下一个请求
+                    m_next_request = m_checked_idx;
                     return do_request();
                 }
+                else if(m_check_state == CHECK_STATE_CONTENT)
+                {
+                    // 有请求体，需要流式接收请求体的路由在这里调用处理函数
+                    // 处理函数没有接收请求体而是直接生成了响应时，不再读取请求体，响应后关闭连接
+                    ret = begin_body();
+                    if(ret != NO_REQUEST)
+                    {
+                        m_linger = false;
+                        m_next_request = m_read_idx;
+                        return ret;
+                    }
+                }
                 break;
             }
             // 请求体
             case CHECK_STATE_CONTENT:
             {
+                // 流式接收请求体，请求体到达多少交给m_sink多少
+                if(m_sink)
+                    return stream_body();
                 // 解析HTTP请求体
-                ret = parse_content(text);
+                ret = parse_content();
                 // 完整解析客户的POST请求，跳转到报文响应函数
                 if(ret == GET_REQUEST)
                 {
@@ -630,13 +1357,14 @@ http_conn::HTTP_CODE http_conn::process_read()
                     // 获取url 等请求资源
                     return do_request();
                 }
-                // 解析完消息体(请求体)即完成报文解析，避免再次进入循环，更新line_status
-                line_status = LINE_OPEN;
-                break;
+                // 请求体还没有完全到达，等待后续数据(或者分块格式错误)
+                // 不能再进入循环由从状态机按行扫描请求体，否则m_checked_idx会越过请求体的起始位置
+                return ret;
             }
             default:
             {
                 // 服务器内部错误
+                m_next_request = m_read_idx;
                 return INTERNAL_ERROR;
             }
         }
@@ -646,216 +1374,382 @@ http_conn::HTTP_CODE http_conn::process_read()
 }
 
 
+/*
+ * @func:将网站根目录与请求的资源路径拼接到m_real_file中
+ * @param:len 路径长度，为-1时url是以\0结尾的字符串
+ * @note:路径过长时截断，m_real_file总是以\0结尾
+ */
+void http_conn::set_real_file(const char *url, int len)
+{
+    if (len < 0)
+        len = strlen(url);
+    snprintf(m_real_file, FILENAME_LEN, "%s%.*s", doc_root, len, url);
+}
+
+
 /*
  * @func:功能逻辑单元
  *       当得到一个完整、正确的HTTP请求时，就需要分析目标文件的属性
- *       如果目标文件存在、对所有用户可读，且不是目录，则使用mmap将其
- *       映射到内存地址m_file_address处，并告诉调用者获取文件成功
- *       内存映射，将文件内容直接映射到进程地址空间
- *       这样服务端进程可以像访问普通内存一样访问数据文件
+ *       如果目标文件存在、对所有用户可读，且不是目录，则从文件缓存中获取，
+ *       保存在m_file中，并告诉调用者获取文件成功
+ *       文件缓存命中时不需要stat/open/mmap，小文件使用缓存中共享的内存映射，
+ *       大文件由sendfile直接在内核中从页缓存发送到套接字
  * @note:doc_root网站根目录，文件夹内存放请求的资源和跳转的html文件
  */
 http_conn::HTTP_CODE http_conn::do_request()
 {
-    // 网站目录（资源目录）
-    strcpy(m_real_file, doc_root);
-    int len = strlen(doc_root);
-
-    // strrchr 函数查询 m_url中最后一次出现 / 位置的指针
-    // 找到m_url中/的位置
-    const char *p = strrchr(m_url, '/');
-
-    // 处理cgi
-    // 实现登录和注册校验
-    if (cgi == 1 && (*(p + 1) == '2' || *(p + 1) == '3'))
-    {
-        // 根据标志判断是登录检测还是注册检测
-        char flag = m_url[1];  // 等价于*(p+1)
-
-        char *m_url_real = (char *)malloc(sizeof(char) * 200);
-        strcpy(m_url_real, "/");
-        strcat(m_url_real, m_url + 2);
-        strncpy(m_real_file + len, m_url_real, FILENAME_LEN - len - 1);
-        free(m_url_real);
-
-        //将用户名和密码提取出来
-        //eg:user=123&password=123
-        char name[100], password[100];
-        int i;
-        for (i = 5; m_string[i] != '&'; ++i)
-            name[i - 5] = m_string[i];
-        name[i - 5] = '\0';
-
-        int j = 0;
-        for (i = i + 10; m_string[i] != '\0'; ++i, ++j)
-            password[j] = m_string[i];
-        password[j] = '\0';
-
-        // 是初次注册情况
-        if(*(p+1) == '3')
+    // 请求的资源路径(以/开头，不以\0结尾)
+    const char *url = view_data(m_request.path);
+    int url_len = m_request.path.len;
+
+    // 查找路由：登录/注册校验由处理函数决定跳转的页面，页面跳转直接发送对应的文件
+    // 没有匹配的路由时，直接将url与网站目录拼接，请求服务器上的一个图片等资源文件
+    const route *r = http_router::get_instance()->match(m_method, url, url_len);
+    if (r && r->handler)
+    {
+        HTTP_CODE ret = call_handler(r);
+        // 处理函数要求以流的形式接收请求体，而请求体已经完整读入(或没有请求体)，一次交给m_sink
+        if (m_sink)
         {
-            //如果是注册，先检测数据库中是否有重名的
-            //没有重名的，进行增加数据
-            //构建一个用于插入数据到数据库的user表中的 SQL 语句
-            char *sql_insert = (char *)malloc(sizeof(char) * 200);
-            strcpy(sql_insert, "INSERT INTO user(username, passwd) VALUES(");
-            strcat(sql_insert, "'");
-            strcat(sql_insert, name);
-            strcat(sql_insert, "', '");
-            strcat(sql_insert, password);
-            strcat(sql_insert, "')");
-
-            // find函数会返回一个迭代器，在map中找name键
-            // 若找到了，迭代器会指向该键对应的键值对
-            // 如果没有找到，迭代器将等于 users.end()，即指向 map 结尾的迭代器
-            if (users.find(name) == users.end())
+            if (m_request.body.len > 0 && !m_sink->write(view_data(m_request.body), m_request.body.len))
             {
-                // 没有找到，则注册的为新用户
-                m_lock.lock();
-                // mysql_query 向数据库执行指令 sql_insert，成功return 0
-                int res = mysql_query(mysql, sql_insert);
-                // 将注册的新用户，账号密码也添加进本地的map中
-                users.insert(std::pair<std::string, std::string>(name, password));
-                m_lock.unlock();
-
-                if (!res)
-                    // 成功
-                    strcpy(m_url, "/log.html");
-                else
-                    strcpy(m_url, "/registerError.html");
+                drop_sink();
+                return INTERNAL_ERROR;
             }
-            else
-                // 注册失败，用户存在
-                strcpy(m_url, "/registerError.html");
-        }
-        //如果是登录，直接判断
-        //若浏览器端输入的用户名和密码在表中可以查找到，返回1，否则返回0
-        else if (*(p + 1) == '2')
-        {
-            if (users.find(name) != users.end() && users[name] == password)
-                strcpy(m_url, "/welcome.html");
-            else
-                // m_url指向登陆失败的页面
-                strcpy(m_url, "/logError.html");
+            return finish_body();
         }
+        return ret;
     }
+    // PUT只能由路由处理函数处理
+    else if (m_method == PUT)
+        return BAD_REQUEST;
+    else if (r)
+        set_real_file(r->file);
+    else
+        set_real_file(url, url_len);
+    return do_file();
+}
 
-    //如果请求资源为/0，表示跳转注册界面
-    if (*(p + 1) == '0')
-    {
-        char *m_url_real = (char *)malloc(sizeof(char) * 200);
 
-        // 将网站目录和/register.html进行拼接，更新到m_real_file中
-        strcpy(m_url_real, "/register.html");
-        // m_url_real字符串复制到m_real_file字符串的len索引位置，进行拼接
-        strncpy(m_real_file + len, m_url_real, strlen(m_url_real));
+/*
+ * @func:调用路由处理函数
+ * @return:处理函数调用了defer时为DEFERRED_REQUEST，调用了receive_body时为NO_REQUEST(请求体交给m_sink)，
+ *         否则为处理函数生成的响应类型
+ */
+http_conn::HTTP_CODE http_conn::call_handler(const route *r)
+{
+    m_response.clear();
+    handler_request req(m_request, m_read_buf.data(), m_method, doc_root, mysql);
+    r->handler(req, m_response);
+    // 处理函数调用了defer，响应由完成句柄稍后生成
+    if (m_async)
+        return DEFERRED_REQUEST;
+    m_sink = m_response.get_sink();
+    if (m_sink)
+        return NO_REQUEST;
+    return do_response();
+}
+
 
-        free(m_url_real);
+/*
+ * @func:请求头部解析完且有请求体时调用，路由设置了stream_body时立即调用处理函数
+ * @return:NO_REQUEST表示继续接收请求体(流式或者读入读缓冲区)，其余为处理函数直接生成的响应
+ * @note:流式接收时读缓冲区在请求头部之后预留BODY_CHUNK，之后不再扩容，
+ *       请求体交给m_sink后即丢弃，每个上传占用的内存与Content-Length无关
+ */
+http_conn::HTTP_CODE http_conn::begin_body()
+{
+    const route *r = http_router::get_instance()->match(m_method, view_data(m_request.path), m_request.path.len);
+    if (!r || !r->handler || !r->stream_body)
+        return NO_REQUEST;
+
+    HTTP_CODE ret = call_handler(r);
+    if (!m_sink)
+        return ret;
+    m_body_left = m_content_length;
+    int need = m_checked_idx + BODY_CHUNK;
+    if (need > buffer_pool::get_instance()->get_max_size())
+        need = buffer_pool::get_instance()->get_max_size();
+    if (!m_read_buf.reserve(need, m_read_idx))
+    {
+        drop_sink();
+        return INTERNAL_ERROR;
     }
+    return NO_REQUEST;
+}
 
-    //如果请求资源为/1，表示跳转登录界面
-    else if (*(p + 1) == '1')
+
+/*
+ * @func:将读缓冲区中请求头部之后的请求体交给m_sink，然后丢弃，只保留请求行与请求头部(m_request指向它们)
+ * @note:返回NO_REQUEST后由process重新注册EPOLLIN，EPOLLONESHOT保证请求体交给m_sink之前不会读入新的数据，
+ *       m_sink处理得慢时不再从套接字读取，客户端由TCP流量控制放慢发送
+ */
+http_conn::HTTP_CODE http_conn::stream_body()
+{
+    char *data = m_read_buf.data() + m_checked_idx;
+    int used = m_read_idx - m_checked_idx;
+    int len = used;
+    bool done;
+    if (m_chunked)
     {
-        char *m_url_real = (char *)malloc(sizeof(char) * 200);
+        // 分块传输编码：就地解码后交给m_sink
+        used = m_decoder.decode(data, used, data, len);
+        if (used < 0)
+        {
+            drop_sink();
+            m_linger = false;
+            m_next_request = m_read_idx;
+            return BAD_REQUEST;
+        }
+        done = m_decoder.done();
+    }
+    else
+    {
+        if (len > m_body_left)
+            used = len = m_body_left;
+        m_body_left -= len;
+        done = m_body_left == 0;
+    }
+    if (len > 0 && !m_sink->write(data, len))
+    {
+        drop_sink();
+        m_linger = false;
+        m_next_request = m_read_idx;
+        return INTERNAL_ERROR;
+    }
+    if (!done)
+    {
+        m_read_idx = m_checked_idx;
+        return NO_REQUEST;
+    }
+    // 请求体之后就是流水线中的下一个请求
+    m_next_request = m_checked_idx + used;
+    return finish_body();
+}
+
+
+/*
+ * @func:请求体全部交给m_sink，由它填写响应
+ */
+http_conn::HTTP_CODE http_conn::finish_body()
+{
+    m_response.clear();
+    m_sink->finish(m_response);
+    drop_sink();
+    if (m_async)
+        return DEFERRED_REQUEST;
+    return do_response();
+}
 
-        // 将网站目录和/log.html进行拼接，更新到m_real_file中
-        strcpy(m_url_real, "/log.html");
-        strncpy(m_real_file + len, m_url_real, strlen(m_url_real));
 
-        free(m_url_real);
+/*
+ * @func:释放请求体的接收者
+ */
+void http_conn::drop_sink()
+{
+    delete m_sink;
+    m_sink = NULL;
+}
+
+
+/*
+ * @func:释放请求体的接收者与分块响应内容的来源
+ */
+void http_conn::drop_streams()
+{
+    drop_sink();
+    delete m_source;
+    m_source = NULL;
+}
+
+
+/*
+ * @func:由m_source生成下一段响应内容，以分块传输编码写入m_write_buf并加入iovec
+ * @note:内容先读到预留的块大小位置之后，确定长度后再移动到块大小之后
+ *       长度为0的块表示内容结束，之后释放m_source
+ */
+bool http_conn::next_chunk()
+{
+    // 块大小(十六进制，最多8位)与\r\n
+    const int head_max = 10;
+    int len = buffer_pool::get_instance()->get_max_size() - m_write_idx - head_max - 2;
+    if (len > BODY_CHUNK)
+        len = BODY_CHUNK;
+    if (len <= 0 || !grow_write_buf(m_write_idx + head_max + len + 2))
+    {
+        drop_streams();
+        return false;
     }
 
-    //如果请求资源为/5，表示跳转pic
-    else if (*(p + 1) == '5')
+    char *p = m_write_buf.data() + m_write_idx;
+    int n = m_source->read(p + head_max, len);
+    if (n < 0)
     {
-        char *m_url_real = (char *)malloc(sizeof(char) * 200);
+        drop_streams();
+        return false;
+    }
+    char head[16];
+    int head_len = snprintf(head, sizeof(head), "%x\r\n", n);
+    memmove(p + head_len, p + head_max, n);
+    memcpy(p, head, head_len);
+    memcpy(p + head_len + n, "\r\n", 2);
+    m_write_idx += head_len + n + 2;
+    if (n == 0)
+        drop_streams();
+    add_iov_write_buf();
+    return true;
+}
 
-        // 将网站目录和/picture.html进行拼接，更新到m_real_file中
-        strcpy(m_url_real, "/picture.html");
-        strncpy(m_real_file + len, m_url_real, strlen(m_url_real));
 
-        free(m_url_real);
+/*
+ * @func:根据路由处理函数填写的m_response确定响应类型
+ *       发送页面时与静态文件一样从文件缓存获取，处理函数生成的内容由process_write写入写缓冲区
+ */
+http_conn::HTTP_CODE http_conn::do_response()
+{
+    if (m_response.get_file())
+    {
+        set_real_file(m_response.get_file());
+        return do_file();
     }
+    if (m_response.get_source())
+        return STREAM_REQUEST;
+    if (m_response.get_status())
+        return DYNAMIC_REQUEST;
+    // 处理函数没有生成响应
+    return INTERNAL_ERROR;
+}
+
 
-    //如果请求资源为/6，表示跳转video
-    else if (*(p + 1) == '6')
+/*
+ * @func:获取m_real_file对应的资源文件
+ *       文件缓存命中时不需要stat/open/mmap，并处理预压缩、条件请求与范围请求
+ */
+http_conn::HTTP_CODE http_conn::do_file()
+{
+    // 从文件缓存获取资源文件，只有对所有用户可读的普通文件才能获取成功
+    m_file = file_cache::get_instance()->acquire(m_real_file);
+    m_file_offset = 0;
+    if (!m_file)
     {
-        char *m_url_real = (char *)malloc(sizeof(char) * 200);
+        // 通过stat获取请求资源文件信息，区分失败原因
+        // 失败返回NO_RESOURCE状态，表示资源不存在
+        struct stat file_stat;
+        if (stat(m_real_file, &file_stat) < 0)
+            return NO_RESOURCE;
 
-        // 将网站目录和/video.html进行拼接，更新到m_real_file中
-        strcpy(m_url_real, "/video.html");
-        strncpy(m_real_file + len, m_url_real, strlen(m_url_real));
+        // 判断文件类型，如果是目录，则返回BAD_REQUEST，表示请求报文有误
+        if (S_ISDIR(file_stat.st_mode))
+            return BAD_REQUEST;
 
-        free(m_url_real);
+        // 文件不可读，返回FORBIDDEN_REQUEST状态
+        return FORBIDDEN_REQUEST;
     }
+    // 客户端接受压缩编码且存在预压缩文件时，改为发送预压缩文件(范围请求针对原文件)
+    if (!m_range)
+        m_file = file_cache::get_instance()->select_encoding(m_file, m_accept_encoding);
+    // 条件请求：客户端缓存的资源文件仍然有效，只需要回复304响应报文头部
+    if (m_method == GET && not_modified())
+        return NOT_MODIFIED;
+    // 范围请求，确定发送的范围
+    if (m_range)
+        return resolve_range();
 
-    //如果请求资源为/7，表示跳转weixin
-    else if (*(p + 1) == '7')
-    {
-        char *m_url_real = (char *)malloc(sizeof(char) * 200);
+    //表示请求文件存在，且可以访问
+    return FILE_REQUEST;
+}
 
-        // 将网站目录和/fans.html进行拼接，更新到m_real_file中
-        strcpy(m_url_real, "/fans.html");
-        strncpy(m_real_file + len, m_url_real, strlen(m_url_real));
-        free(m_url_real);
+
+/*
+ * @func:将当前请求的资源文件归还给文件缓存
+ */
+void http_conn::close_file()
+{
+    if (m_file)
+    {
+        file_cache::get_instance()->release(m_file);
+        m_file = NULL;
     }
-    else
-        // 在parse_request_line处理请求行时，当url只有/则将m_url与judge.html界面进行拼接
-        // 如果以上均不符合，即不是登录和注册，直接将url与网站目录拼接
-        // 这里的情况是跳转到judge.html界面即欢迎界面，请求服务器上的一个图片
-        // 是一个GET请求
-        strncpy(m_real_file + len, m_url, FILENAME_LEN - len - 1);
-
-    // 通过stat获取请求资源文件信息，成功则将信息更新到m_file_stat结构体
-    // 失败返回NO_RESOURCE状态，表示资源不存在
-    if (stat(m_real_file, &m_file_stat) < 0)
-        return NO_RESOURCE;
-
-    // 判断文件的权限，是否可读，不可读则返回FORBIDDEN_REQUEST状态
-    if (!(m_file_stat.st_mode & S_IROTH))
-        return FORBIDDEN_REQUEST;
+}
 
-    // 判断文件类型，如果是目录，则返回BAD_REQUEST，表示请求报文有误
-    if (S_ISDIR(m_file_stat.st_mode))
-        return BAD_REQUEST;
 
-    // 以只读方式获取文件描述符，通过mmap将该文件映射到内存中
-    int fd = open(m_real_file, O_RDONLY);
-    m_file_address = (char *)mmap(0, m_file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-    //避免文件描述符的浪费和占用
-    close(fd);
+/*
+ * @func:将本批响应持有的全部资源文件归还给文件缓存
+ */
+void http_conn::close_files()
+{
+    close_file();
+    for (int i = 0; i < m_batch_file_count; ++i)
+        file_cache::get_instance()->release(m_batch_files[i]);
+    m_batch_file_count = 0;
+}
 
-    //表示请求文件存在，且可以访问
-    return FILE_REQUEST;
+
+/*
+ * @func:当前请求的资源文件内容(共享内存映射或预先生成的完整响应报文)已经加入iovec，
+ *      由本批响应持有到发送完毕，m_file留给流水线中的下一个请求使用
+ */
+void http_conn::hold_file()
+{
+    m_batch_files[m_batch_file_count++] = m_file;
+    m_file = NULL;
 }
 
 
 /*
- * @func:取消内存映射
+ * @func:将m_write_buf中尚未加入iovec的响应报文数据加入iovec
+ * @note:与上一个iovec在m_write_buf中相邻时直接合并(连续的错误响应或只有头部的响应)
  */
-void http_conn::unmap()
+void http_conn::add_iov_write_buf()
 {
-    if (m_file_address)
+    int len = m_write_idx - m_iv_write_idx;
+    if (len <= 0)
+        return;
+    char *base = m_write_buf.data() + m_iv_write_idx;
+    if (m_iv_count > 0 && (char *)m_iv[m_iv_count - 1].iov_base + m_iv[m_iv_count - 1].iov_len == base)
     {
-        munmap(m_file_address, m_file_stat.st_size);
-        m_file_address = 0;
+        m_iv[m_iv_count - 1].iov_len += len;
     }
+    else
+    {
+        m_iv[m_iv_count].iov_base = base;
+        m_iv[m_iv_count].iov_len = len;
+        m_iv_count++;
+    }
+    m_iv_write_idx = m_write_idx;
+    bytes_to_send += len;
+}
+
+
+/*
+ * @func:将响应内容加入iovec，之前写入m_write_buf的响应报文头部先加入
+ */
+void http_conn::add_iov(const char *buf, int len)
+{
+    add_iov_write_buf();
+    m_iv[m_iv_count].iov_base = (char *)buf;
+    m_iv[m_iv_count].iov_len = len;
+    m_iv_count++;
+    bytes_to_send += len;
 }
 
 
 /*
  * @func:将响应报文写入到通信套接字的写缓冲区，发送给浏览器(客户)端
+ *      本批的全部响应(流水线中的多个请求)通过iovec一起writev
+ *      最后一个响应的资源文件没有共享内存映射时，先发送iovec中的数据，再通过sendfile发送文件
  * @note:proActor模式下，是主线程进行I/O操作数据完成，将m_read_buf/m_write_buf数据准备好
+ *      写缓冲区满时注册写事件，资源文件保持打开，写事件到来后从m_file_offset处继续发送
  */
 bool http_conn::write()
 {
     int temp = 0;
+    bool result = false;
     // 表示响应报文为空，一般不会出现这种情况
     if (bytes_to_send == 0)
     {
         // 重新为套接字注册EPOLLONESHOT事件，并且监听读事件
-        modfd(m_epollfd, m_sockfd, EPOLLIN, m_TRIGMode);
-        init();
+        keep_alive();
         return true;
     }
 
@@ -863,72 +1757,133 @@ bool http_conn::write()
     {
         // 将响应报文的状态行、消息头、空行和响应正文发送给浏览器端
         // 从process_write函数中指定的iovec向量缓冲区，写入数据到M_socket文件描述符的写缓冲区
-        // 发送数据给浏览器端
-        temp = writev(m_sockfd, m_iv, m_iv_count);
-        // 发送数据失败
-        if(temp < 0)
+        if (m_iv_idx < m_iv_count && !m_file)
         {
-            // 非阻塞模式下，判断errno == EAGAIN 即写缓冲区满
-            if(errno == EAGAIN)
-            {
-                // m_sockfd重新注册EPOLLONESHOT事件，监听写事件
-                modfd(m_epollfd, m_sockfd, EPOLLOUT, m_TRIGMode);
-                return true;
-            }
-            // 取消do_request函数中开启的内存映射
-            unmap();
-            // return false,之后关闭连接
-            return false;
+            temp = writev(m_sockfd, m_iv + m_iv_idx, m_iv_count - m_iv_idx);
+        }
+        // 之后还需要sendfile发送文件
+        else if (m_iv_idx < m_iv_count)
+        {
+            // 使用MSG_MORE，让头部与文件的第一段数据合并成完整的TCP报文段
+            struct msghdr msg;
+            memset(&msg, 0, sizeof msg);
+            msg.msg_iov = m_iv + m_iv_idx;
+            msg.msg_iovlen = m_iv_count - m_iv_idx;
+            temp = sendmsg(m_sockfd, &msg, MSG_MORE);
+        }
+        // 资源文件由sendfile在内核中直接发送，m_file_offset随之后移
+        else
+        {
+            temp = sendfile(m_sockfd, m_file->fd, &m_file_offset, bytes_to_send);
+        }
+        if (write_done(temp < 0 ? -errno : temp, result))
+        {
+            return result;
+        }
+    }
+}
+
+
+/*
+ * @func:io_uring引擎模式下，处理事件循环批量提交的一次writev操作的结果
+ * @param:sent writev的返回值，出错时为-errno
+ * @note:没有发送完的部分继续同步发送，写缓冲区满时与write一样注册写事件
+ * @return:与write一致
+ */
+bool http_conn::write_complete(int sent)
+{
+    bool result = false;
+    if (write_done(sent, result))
+    {
+        return result;
+    }
+    return write();
+}
+
+
+/*
+ * @func:根据一次发送的结果更新已发送/未发送字节数
+ * @param:sent send/sendfile/writev的返回值，出错时为-errno
+ * @param:result 响应处理结束时，write应当返回的值
+ * @return:true 响应处理结束(发送完毕、写缓冲区满或出错)
+ *         false 还有数据需要继续发送
+ */
+bool http_conn::write_done(int sent, bool &result)
+{
+    // 发送数据失败
+    if (sent < 0)
+    {
+        // 非阻塞模式下，判断errno == EAGAIN 即写缓冲区满
+        if (sent == -EAGAIN)
+        {
+            // m_sockfd重新注册EPOLLONESHOT事件，监听写事件
+            modfd(m_epollfd, m_sockfd, EPOLLOUT, m_TRIGMode);
+            result = true;
+            return true;
         }
+        // 归还do_request函数中获取的资源文件
+        close_files();
+        // return false,之后关闭连接
+        result = false;
+        return true;
+    }
 
-        // 更新已经发送的字节数量
-        bytes_have_send += temp;
-        // 更新还未发送字节
-        bytes_to_send -= temp;
+    // 更新已经发送的字节数量
+    bytes_have_send += sent;
+    // 更新还未发送字节
+    bytes_to_send -= sent;
 
-        // iovec向量缓冲区第一个头部信息的数据已发送完，发送iovec第二个数据
-        if (bytes_have_send >= m_iv[0].iov_len)
+    // 跳过已经发送完的iovec，部分发送的iovec从未发送的位置继续
+    // sendfile发送文件时iovec已经全部发送完，不需要调整
+    while (sent > 0 && m_iv_idx < m_iv_count)
+    {
+        if ((size_t)sent >= m_iv[m_iv_idx].iov_len)
         {
-            // 不再继续发送头部信息
-            m_iv[0].iov_len = 0;
-            // iovec向量缓冲区 第二个指向URL访问资源文件的指针索引进行偏移
-            // iovec向量缓冲区 第一个指针指向的是m_write_buf，此时m_write_buf数据已经发送完毕
-            // 因此用 整体已经发送的字节数量bytes_have_send - m_write_buf中的字节数量可以得到 第二个指向URL访问资源文件的指针索引进行偏移
-            m_iv[1].iov_base = m_file_address + (bytes_have_send - m_write_idx);
-            // 缓冲区剩余未发送数据的大小
-            m_iv[1].iov_len = bytes_to_send;
+            sent -= m_iv[m_iv_idx].iov_len;
+            m_iv_idx++;
         }
-        // 继续发送iovec向量缓冲区第一个头部信息的数据
         else
         {
-            // iovec向量缓冲区 第一个指向m_write_buf的指针索引进行偏移
-            m_iv[0].iov_base = m_write_buf + bytes_have_send;
-            // 缓冲区剩余未发送数据的大小
-            m_iv[0].iov_len = m_iv[0].iov_len - bytes_have_send;
+            m_iv[m_iv_idx].iov_base = (char *)m_iv[m_iv_idx].iov_base + sent;
+            m_iv[m_iv_idx].iov_len -= sent;
+            sent = 0;
         }
+    }
+
+    // 判断条件，数据已全部发送完
+    if (bytes_to_send <= 0)
+    {
+        // 归还资源文件
+        close_files();
 
-        // 判断条件，数据已全部发送完
-        if (bytes_to_send <= 0)
+        // 分块发送的响应还没有结束，由调用者(通过take_pipelined)继续调用process生成下一段
+        if (m_source)
         {
-            // 取消内存映射
-            unmap();
-            // 重新注册写事件
-            modfd(m_epollfd, m_sockfd, EPOLLIN, m_TRIGMode);
+            init_response();
+            m_pipelined = true;
+            result = true;
+            return true;
+        }
 
-            // 浏览器的请求为长连接
-            if (m_linger)
-            {
-                // 重新初始化HTTP对象
-                init();
-                return true;
-            }
-            else
-            {
-                // return false,之后关闭连接
-                return false;
-            }
+        // 浏览器的请求为长连接(本批最后一个请求为长连接)
+        if (m_batch_linger)
+        {
+            // 准备处理下一个请求，读缓冲区中还有流水线中的后续请求时由调用者继续处理
+            // 短连接不再注册，连接由事件循环关闭，关闭前不会再有事件触发
+            keep_alive();
+            result = true;
+        }
+        else
+        {
+            // 连接即将关闭，缓冲区归还给缓冲区池
+            m_read_idx = 0;
+            release_buffers();
+            // return false,之后关闭连接
+            result = false;
         }
+        return true;
     }
+    return false;
 }
 
 
@@ -938,28 +1893,34 @@ bool http_conn::write()
  */
 bool http_conn::add_response(const char *format, ...)
 {
-    //如果写入内容超出m_write_buf大小则报错
-    if (m_write_idx >= WRITE_BUFFER_SIZE)
-        return false;
     // 定义可变参数列表
     va_list arg_list;
     // 将变量arg_list初始化为传入参数(初始化 va_list 变量，使其指向变长参数列表的第一个参数)
     va_start(arg_list, format);
-    // 将数据format从可变参数列表写入缓冲区写，返回写入数据的长度
-    int len=vsnprintf(m_write_buf+m_write_idx,WRITE_BUFFER_SIZE-1-m_write_idx,format,arg_list);
-    //如果写入的数据长度超过缓冲区剩余空间，则报错
-    if (len >= (WRITE_BUFFER_SIZE - 1 - m_write_idx))
+    // 写缓冲区空间不足时需要扩容后再写一次，保留一份参数列表
+    va_list arg_copy;
+    va_copy(arg_copy, arg_list);
+    // 将数据format从可变参数列表写入缓冲区写，返回数据的长度
+    int space = m_write_buf.size() - m_write_idx;
+    int len = vsnprintf(space > 0 ? m_write_buf.data() + m_write_idx : NULL, space > 0 ? space : 0,
+                        format, arg_list);
+    // va_end结束 va_list 的使用
+    va_end(arg_list);
+    // 写入的数据长度超过缓冲区剩余空间，扩容后重新写入，超出缓冲区大小上限则报错
+    if (len >= space)
     {
-        // va_end结束 va_list 的使用
-        va_end(arg_list);
-        return false;
+        if (len < 0 || !grow_write_buf(m_write_idx + len + 1))
+        {
+            va_end(arg_copy);
+            return false;
+        }
+        vsnprintf(m_write_buf.data() + m_write_idx, m_write_buf.size() - m_write_idx, format, arg_copy);
     }
+    va_end(arg_copy);
     //更新m_write_idx位置
     m_write_idx += len;
-    // 清空可变参列表
-    va_end(arg_list);
 
-    LOG_INFO("request:%s", m_write_buf);
+    LOG_INFO("request:%s", m_write_buf.data());
 
     return true;
 }
@@ -1017,6 +1978,43 @@ bool http_conn::add_linger()
 }
 
 
+/*
+ * @func:为响应报文添加消息报头(第二部分)
+ *      --添加内容编码，存在预压缩文件时告知缓存代理响应内容随Accept-Encoding变化
+ */
+bool http_conn::add_content_encoding()
+{
+    if (!m_file->vary)
+        return true;
+    if (m_file->encoding != ENCODING_IDENTITY &&
+        !add_response("Content-Encoding:%s\r\n", file_cache::encoding_name(m_file->encoding)))
+        return false;
+    return add_response("Vary:%s\r\n", "Accept-Encoding");
+}
+
+
+/*
+ * @func:为响应报文添加消息报头(第二部分)
+ *      --添加实体标签与最后修改时间，浏览器再次访问时用于条件请求
+ */
+bool http_conn::add_validators()
+{
+    return add_response("ETag:%s\r\n", m_file->etag) &&
+           add_response("Last-Modified:%s\r\n", m_file->last_modified);
+}
+
+
+/*
+ * @func:为响应报文添加消息报头(第二部分)
+ *      --添加Content-Range，表示发送的范围与文件总大小
+ */
+bool http_conn::add_content_range(off_t start, off_t end, off_t size)
+{
+    return add_response("Content-Range:bytes %lld-%lld/%lld\r\n",
+                        (long long)start, (long long)end, (long long)size);
+}
+
+
 /*
  * @func:为响应报文添加消息报头(第二部分)
  *      --添加空行
@@ -1037,6 +2035,19 @@ bool http_conn::add_content(const char *content)
 }
 
 
+/*
+ * @func:为响应报文添加任意内容(可以包含\0)，写缓冲区空间不足时扩容
+ */
+bool http_conn::add_data(const char *data, int len)
+{
+    if (m_write_buf.size() - m_write_idx < len && !grow_write_buf(m_write_idx + len))
+        return false;
+    memcpy(m_write_buf.data() + m_write_idx, data, len);
+    m_write_idx += len;
+    return true;
+}
+
+
 /*
  * @func:生成响应报文
  *      （根据process函数中调用process_read解析请求报文，返回的HTTP_CODE状态码,
@@ -1087,38 +2098,163 @@ bool http_conn::process_write(HTTP_CODE ret)
         // 文件存在且可以访问，200
         case FILE_REQUEST:
         {
-            // 状态行--200 OK:客户端请求被正常处理
-            add_status_line(200, ok_200_title);
+            // 小文件命中预先生成的完整响应报文，不需要再生成响应报文头部，一次写操作即可发送
+            const char *response;
+            int response_len;
+            if (!m_range && file_cache::get_instance()->get_response(m_file, m_linger, response, response_len))
+            {
+                add_iov(response, response_len);
+                hold_file();
+                return true;
+            }
+
+            // 本响应的响应报文头部在m_write_buf中的起始位置(之前可能是流水线中前面请求的响应)
+            int header_start = m_write_idx;
+            // 发送的文件内容：范围请求只发送[m_range_start, m_range_end]，否则发送整个文件
+            off_t offset = 0;
+            off_t length = m_file->st.st_size;
+            if (m_range)
+            {
+                // 状态行--206 Partial Content:只发送了请求的部分内容
+                add_status_line(206, partial_206_title);
+                offset = m_range_start;
+                length = m_range_end - m_range_start + 1;
+            }
+            else
+            {
+                // 状态行--200 OK:客户端请求被正常处理
+                add_status_line(200, ok_200_title);
+            }
             // GET请求，请求访问的文件有内容
-            if (m_file_stat.st_size != 0)
+            if (length != 0)
             {
-                // 消息报头
-                add_headers(m_file_stat.st_size);
-
-                // 将向量缓冲区分别指向 m_write_buf与m_file_address
-                // 之后可以通过writev函数将两个缓冲区的数据写入到用于通信的套接字写缓冲区，返回给客户端
-                // 第一个iovec指针指向响应报文缓冲区，长度指向m_write_idx
-                m_iv[0].iov_base = m_write_buf;
-                m_iv[0].iov_len = m_write_idx;
-                // 第二个iovec指针指向mmap返回的文件指针，长度指向文件大小
-                m_iv[1].iov_base = m_file_address;
-                m_iv[1].iov_len = m_file_stat.st_size;
-                m_iv_count = 2;
-                // 发送的全部数据为响应报文头部信息和文件大小
-                bytes_to_send = m_write_idx + m_file_stat.st_size;
+                // 消息报头，范围请求还需要Content-Range，预压缩文件还需要Content-Encoding与Vary
+                add_content_length(length);
+                if (m_range)
+                    add_content_range(m_range_start, m_range_end, m_file->st.st_size);
+                add_validators();
+                add_linger();
+                add_content_encoding();
+                add_blank_line();
+                // 小文件保存完整响应报文，之后的请求直接发送
+                if (!m_range)
+                    file_cache::get_instance()->set_response(m_file, m_linger, m_write_buf.data() + header_start,
+                                                             m_write_idx - header_start);
+
+                // 资源文件有共享的内存映射时，iovec指向内存映射中的发送范围，与响应报文头部一起writev
+                // 否则文件内容在iovec发送完之后由sendfile从offset处发送
+                m_file_offset = offset;
+                if (m_file->addr)
+                {
+                    add_iov(m_file->addr + offset, length);
+                    hold_file();
+                }
+                else
+                {
+                    add_iov_write_buf();
+                    bytes_to_send += length;
+                }
                 return true;
             }
+            // 空文件没有需要发送的内容，直接归还
+            close_file();
+            break;
+        }
+
+        // 资源文件未被修改，304
+        case NOT_MODIFIED:
+        {
+            // 状态行--304 Not Modified：客户端直接使用本地缓存，没有响应内容
+            add_status_line(304, not_modified_304_title);
+            // 消息报头
+            add_validators();
+            add_linger();
+            add_content_encoding();
+            add_blank_line();
+            close_file();
+            break;
+        }
+
+        // 请求的范围超出文件大小，416
+        case RANGE_NOT_SATISFIABLE:
+        {
+            // 状态行--416 Range Not Satisfiable
+            add_status_line(416, error_416_title);
+            // 消息报头，Content-Range告知文件大小
+            add_content_length(strlen(error_416_form));
+            add_response("Content-Range:bytes */%lld\r\n", (long long)m_file->st.st_size);
+            add_linger();
+            add_blank_line();
+            close_file();
+            if (!add_content(error_416_form))
+                return false;
+            break;
+        }
+
+        // 路由处理函数生成的响应内容
+        case DYNAMIC_REQUEST:
+        {
+            const std::string &body = m_response.get_body();
+            add_status_line(m_response.get_status(), m_response.get_title());
+            add_content_length(body.size());
+            add_response("Content-Type:%s\r\n", m_response.get_content_type());
+            add_linger();
+            add_blank_line();
+            if (!add_data(body.data(), body.size()))
+                return false;
+            break;
+        }
+
+        // 路由处理函数逐段生成的响应内容，分块传输编码
+        case STREAM_REQUEST:
+        {
+            // 连接持有m_source直到最后一段，之后每一段在上一段发送完后由process生成
+            m_source = m_response.get_source();
+            add_status_line(m_response.get_status(), m_response.get_title());
+            add_response("Transfer-Encoding:chunked\r\n");
+            add_response("Content-Type:%s\r\n", m_response.get_content_type());
+            add_linger();
+            add_blank_line();
+            // 第一段与响应报文头部一起发送
+            if (!next_chunk())
+                return false;
             break;
         }
 
         default:
             return false;
     }
-    // 除FILE_REQUEST状态外，其余状态只申请一个iovec，指向响应报文缓冲区
-    m_iv[0].iov_base = m_write_buf;
-    m_iv[0].iov_len = m_write_idx;
-    m_iv_count = 1;
-    bytes_to_send = m_write_idx;
+    // 除FILE_REQUEST状态外，其余状态的响应全部在响应报文缓冲区中
+    add_iov_write_buf();
+    return true;
+}
+
+
+/*
+ * @func:路由处理函数调用defer，为当前请求创建异步处理的完成句柄
+ */
+http_async *http_conn::defer()
+{
+    m_async = new http_async(m_sockfd, m_generation, m_completion);
+    return m_async;
+}
+
+
+/*
+ * @func:异步处理已完成，由连接所属的事件循环调用，生成响应报文并注册写事件
+ * @return:生成响应报文失败时返回false，由调用者关闭连接
+ * @note:工作线程已经处理完该连接(见http_async::arrive)，连接上没有注册事件，不会被并发访问
+ */
+bool http_conn::resume(http_async *async)
+{
+    m_response = async->response();
+    m_response.bind(this);
+    bool write_ret = process_write(do_response());
+    m_batch_count++;
+    m_batch_linger = m_linger;
+    if (!write_ret)
+        return false;
+    modfd(m_epollfd, m_sockfd, EPOLLOUT, m_TRIGMode);
     return true;
 }
 
@@ -1129,10 +2265,28 @@ bool http_conn::process_write(HTTP_CODE ret)
  */
 void http_conn::process()
 {
+    // 分块发送的响应：上一段已经发送完，生成下一段
+    if (m_source)
+    {
+        mysql = NULL;
+        bool write_ret = next_chunk();
+        m_batch_count = 1;
+        m_batch_linger = m_linger;
+        if (!write_ret)
+        {
+            // 通知事件循环关闭连接，由它删除定时器、归还连接对象；投递后不能再访问该连接
+            m_completion->post(m_sockfd, m_generation);
+            return;
+        }
+        modfd(m_epollfd, m_sockfd, EPOLLOUT, m_TRIGMode);
+        return;
+    }
+
     // 解析HTTP请求报文
     HTTP_CODE read_ret = process_read();
     if(read_ret == NO_REQUEST)
     {
+        mysql = NULL;
         // NO_REQUEST请求报文，不完整，需要继续获取客户端数据
         // 修改该通信套接字事件，重新注册EPOLLONESHOT事件，继续监听该通信套接字读事件
         modfd(m_epollfd,m_sockfd,EPOLLIN,m_TRIGMode);
@@ -1147,11 +2301,44 @@ void http_conn::process()
         // FILE_REQUEST  请求资源可以正常访问
         // INTERNAL_ERROR 服务器内部错误，该结果在主状态机逻辑switch的default下，一般不会触发
     // 调用process_write()生成响应报文
-    bool write_ret = process_write(read_ret);
+    bool write_ret = true;
+    if (read_ret != DEFERRED_REQUEST)
+    {
+        write_ret = process_write(read_ret);
+        m_batch_count++;
+        m_batch_linger = m_linger;
+    }
+    // HTTP/1.1流水线：读缓冲区中已经到达的后续请求继续解析，响应追加到本批之后，一次writev发送
+    // 后续请求不完整时保留其解析状态，本批响应发送完后再继续接收
+    while (write_ret && read_ret != DEFERRED_REQUEST && pipeline_ready())
+    {
+        next_request();
+        read_ret = process_read();
+        if (read_ret == NO_REQUEST || read_ret == DEFERRED_REQUEST)
+            break;
+        write_ret = process_write(read_ret);
+        m_batch_count++;
+        m_batch_linger = m_linger;
+    }
+    // 路由处理函数都已经返回，不再使用数据库连接
+    // 连接交回事件循环(注册事件、投递完成队列)之后可能立即被关闭并复用，之后不能再访问该连接，在这里清空
+    mysql = NULL;
+    if (read_ret == DEFERRED_REQUEST)
+    {
+        // 路由处理函数异步处理，本批结束，不注册写事件
+        // 本批之前的响应等异步处理完成后与它的响应一起发送(响应必须按请求的顺序发送)
+        // 交出完成句柄之后不能再访问该连接，事件循环可能已经开始生成响应
+        http_async *async = m_async;
+        m_async = NULL;
+        async->arrive();
+        return;
+    }
     if(!write_ret)
     {
-        // 生成响应报文失败，关闭套接字连接
-        close_conn();
+        // 生成响应报文失败，通知事件循环关闭套接字连接(删除定时器、归还连接对象)
+        // 投递后事件循环可能已经关闭连接并把连接对象交给新连接，不能再访问该连接
+        m_completion->post(m_sockfd, m_generation);
+        return;
     }
     // 写成功了，为该套接字重新注册EPOLLONESHOT事件，监听写事件
     // 之后在proactor模式下，服务器主线程检测写事件，并调用http_conn::write函数将响应报文发送给浏览器端
@@ -18,23 +18,42 @@
 #include <errno.h>
 #include <sys/wait.h>
 #include <sys/uio.h>
+#include <sys/sendfile.h>
 #include <map>
+#include <atomic>
 
 #include "../lock/locker.h"
 #include "../CGImysql/sql_connection_pool.h"
+#include "../CGImysql/sql_executor.h"
 #include "../timer/lst_timer.h"
 #include "../log/log.h"
+#include "../reactor/completion_queue.h"
+#include "../cache/file_cache.h"
+#include "../buffer/buffer_pool.h"
+#include "http_request.h"
+#include "http_router.h"
+#include "http_handler.h"
+#include "http_chunked.h"
+
+
+struct conn_slot;
 
 
 class http_conn{
 public:
     // 设置读取文件的名称m_real_file大小
     static const int FILENAME_LEN = 200;
-    // 设置读缓冲区m_read_buf大小
-    static const int READ_BUFFER_SIZE = 2048;
-    // 设置读缓冲区m_read_buf大小
-    static const int WRITE_BUFFER_SIZE = 1024;
-    // HTTP方法名--本项目只使用到GET与POST
+    // 流水线中一批最多合并发送的响应数量
+    static const int PIPELINE_MAX = 16;
+    // m_write_buf距离缓冲区大小上限的剩余空间不足该值时不再合并后续响应，保证一个响应报文头部可以完整写入
+    static const int PIPELINE_WRITE_RESERVE = 512;
+    // 流式接收请求体时读缓冲区在请求头部之后预留的空间，每次最多读入这么多请求体
+    // 也是分块发送响应时每一段的最大长度
+    static const int BODY_CHUNK = 16 * 1024;
+    // 持有状态m_hold的取值
+    static const int HOLD_CLOSED = 1;
+    static const int HOLD_WORKER = 2;
+    // HTTP方法名--本项目只使用到GET、POST与PUT
     enum METHOD
     {
         GET = 0,
@@ -74,6 +93,16 @@ public:
         FILE_REQUEST,
         // 服务器内部错误
         INTERNAL_ERROR,
+        // 资源文件未被修改，客户端可以使用本地缓存
+        NOT_MODIFIED,
+        // 请求的范围超出文件大小
+        RANGE_NOT_SATISFIABLE,
+        // 路由处理函数生成了响应内容
+        DYNAMIC_REQUEST,
+        // 路由处理函数异步处理，响应稍后由事件循环生成
+        DEFERRED_REQUEST,
+        // 路由处理函数的响应内容以分块传输编码逐段发送
+        STREAM_REQUEST,
         // 客户端已经关闭连接了
         CLOSED_CONNECTION
     };
@@ -89,147 +118,318 @@ public:
     };
 
 public:
-    http_conn(){}
+    http_conn() : m_slot(NULL), m_hold(0), m_pipelined(false), m_file(NULL), m_batch_file_count(0),
+                  m_sink(NULL), m_source(NULL), m_async(NULL), m_generation(0) {}
     ~http_conn(){}
 
 public:
     // 初始化套接字--函数内部会调用私有方法init
-    void init(int sockfd, const sockaddr_in &addr, char *, int, int, std::string user, std::string passwd, std::string sqlname);
-    // 关闭http连接
-    void close_conn(bool real_close = true);
+    // epollfd为该连接所属事件循环(主Reactor或从Reactor)的epoll实例
+    void init(int sockfd, const sockaddr_in &addr, int epollfd, char *, int, int);
     // http处理函数
     void process();
     // 读取浏览器端发来的全部数据
     bool read_once();
     // 响应报文写入函数
     bool write();
+    /*******************io_uring I/O引擎*****************/
+    // 读缓冲区中可写入数据的起始位置
+    char *read_buf_tail()
+    {
+        return m_read_buf.data() + m_read_idx;
+    }
+    // 读缓冲区剩余空间，缓冲区已满时先扩容，达到大小上限时返回0
+    int read_buf_space()
+    {
+        if (!grow_read_buf())
+            return 0;
+        return m_read_buf.size() - m_read_idx;
+    }
+    // 处理一次recv的结果(字节数或-errno)，返回值与read_once一致
+    bool read_complete(int bytes);
+    // 获取待发送的iovec向量，返回向量个数，响应报文为空或需要sendfile发送文件时返回0
+    int get_iov(struct iovec *&iov)
+    {
+        iov = m_iv + m_iv_idx;
+        return (bytes_to_send > 0 && !m_file) ? m_iv_count - m_iv_idx : 0;
+    }
+    // 处理一次writev的结果(字节数或-errno)，返回值与write一致
+    bool write_complete(int sent);
+    /*******************io_uring I/O引擎*****************/
+    // 长连接的响应发送完毕后，读缓冲区中还有流水线中的后续请求，或者分块发送的响应还需要生成下一段，
+    // 需要调用者继续调用process处理
+    // 每次只有一个调用者得到true，其余调用者(以及读缓冲区中没有后续请求时)得到false
+    bool take_pipelined()
+    {
+        return m_pipelined.exchange(false);
+    }
     // 获取服务器ip信息
     sockaddr_in *get_address()
     {
         return &m_address;
     }
+    // 获取该http连接的通信套接字
+    int get_sockfd()
+    {
+        return m_sockfd;
+    }
 
     /*******************数据库:函数需要补充*****************/
     // 初始化数据库读取线程
-    void initmysql_result(connection_pool *connPool);
+    static void initmysql_result(connection_pool *connPool, int close_log);
     /*******************数据库:函数需要补充*****************/
+    // 登记页面跳转、登录/注册校验等路由，启动时调用一次
+    // upload_max_mb为上传文件的大小上限(MB)，0表示不开启上传接口
+    static void init_routes(int upload_max_mb = 0);
+    /*******************异步路由处理*****************/
+    // 路由处理函数通过http_response::defer调用，返回异步处理的完成句柄
+    http_async *defer();
+    // 事件循环调用：异步处理已完成，生成响应报文并注册写事件，失败时返回false
+    bool resume(http_async *async);
+    // 连接的代数，每个新连接从进程内的计数器取得，用于识别文件描述符/连接对象已被复用的过期异步处理
+    unsigned get_generation()
+    {
+        return m_generation;
+    }
+    /*******************异步路由处理*****************/
 
-    // 是否关闭连接
-    int timer_flag;
-    // 是否正在处理数据中
-    int improv;
+    /*******************连接的持有与回收*****************/
+    // 线程池分派任务时调用：工作线程持有该连接，连接关闭后连接对象与文件描述符保留到工作线程交回
+    void hold()
+    {
+        m_hold.fetch_add(HOLD_WORKER);
+    }
+    // 工作线程处理完任务后调用(已经注册事件或投递完成队列)，连接已关闭且没有其他工作线程持有时回收
+    void unhold();
+    // 事件循环关闭连接时调用：标记连接已关闭，没有工作线程持有时返回true，由调用者立即回收
+    bool try_close()
+    {
+        return m_hold.fetch_or(HOLD_CLOSED) == 0;
+    }
+    // 回收连接：释放上传与分块响应、归还资源文件与缓冲区、关闭套接字
+    void release();
+    /*******************连接的持有与回收*****************/
+
+    // 连接所在的连接表位置，工作线程最后交回已关闭的连接时用于放回空闲链表
+    conn_slot *m_slot;
+    // Reactor模式下，工作线程处理完成后向所属事件循环回报结果的完成队列
+    completion_queue *m_completion;
 
 private:
     // 对类私有的成员变量进行初始化
     void init();
+    // 初始化一个请求的解析状态
+    void init_request();
+    // 初始化一批响应的发送状态
+    void init_response();
+    // 丢弃已经处理完的请求，将读缓冲区中剩余的流水线数据移动到缓冲区开头，准备解析下一个请求
+    void next_request();
+    // 是否继续解析流水线中的下一个请求，将其响应与本批响应合并发送
+    bool pipeline_ready();
+    // 长连接的响应发送完毕，准备处理下一个请求
+    void keep_alive();
     // 从m_read_buf读取，并处理请求报文
     HTTP_CODE process_read();
     // 向m_write_buf写入响应报文数据
     bool process_write(HTTP_CODE ret);
     // 主状态机解析报文中的请求行数据
-    HTTP_CODE parse_request_line(char *text);
+    HTTP_CODE parse_request_line(const char *text, int len);
     // 主状态机解析报文中的请求头数据
-    HTTP_CODE parse_headers(char *text);
+    HTTP_CODE parse_headers(const char *text, int len);
     // 主状态机解析报文中的请求内容
-    HTTP_CODE parse_content(char *text);
+    HTTP_CODE parse_content();
+    // 请求头部解析完，路由需要流式接收请求体时调用处理函数
+    HTTP_CODE begin_body();
+    // 将读缓冲区中的请求体交给m_sink
+    HTTP_CODE stream_body();
+    // 请求体全部交给m_sink后，由它生成响应
+    HTTP_CODE finish_body();
+    void drop_sink();
+    // 放弃尚未完成的流式请求体与分块响应，只由正在处理该连接的线程或回收连接时调用
+    void drop_streams();
+    // 由m_source生成下一段响应内容，以分块传输编码写入m_write_buf
+    bool next_chunk();
+    // 解析请求头部Accept-Encoding字段
+    void parse_accept_encoding(const char *text, int len);
+    // 解析请求头部Range字段
+    void parse_range(const char *text, int len);
+    // 根据文件大小与If-Range确定最终发送的范围
+    HTTP_CODE resolve_range();
+    // 根据If-None-Match/If-Modified-Since判断客户端缓存的资源文件是否仍然有效
+    bool not_modified();
+    // 将网站根目录与请求的资源路径拼接到m_real_file中
+    void set_real_file(const char *url, int len = -1);
     // 生成响应报文
     HTTP_CODE do_request();
+    // 获取m_real_file对应的资源文件，处理条件请求与范围请求
+    HTTP_CODE do_file();
+    // 调用路由处理函数
+    HTTP_CODE call_handler(const route *r);
+    // 根据路由处理函数填写的m_response确定响应类型
+    HTTP_CODE do_response();
     // 从状态机（从每个部分中--请求行/请求头/请求数据--获取一行）--分析是请求报文的哪一部分
     LINE_STATUS parse_line();
     // 移动到当前处理行的初始位置
     // m_start_line是已经解析的字符
     // get_line用于将指针向后偏移，指向未处理的字符
-    char *get_line() { return m_read_buf + m_start_line; };
-    // 撤销内存映射
-    void unmap();
+    const char *get_line() { return m_read_buf.data() + m_start_line; };
+    // 读缓冲区中text处长度为len的数据的视图
+    http_view make_view(const char *text, int len)
+    {
+        http_view view;
+        view.off = text - m_read_buf.data();
+        view.len = len;
+        return view;
+    }
+    // 视图在读缓冲区中的起始地址
+    const char *view_data(const http_view &view)
+    {
+        return m_read_buf.data() + view.off;
+    }
+    // 读缓冲区已满时扩容，达到大小上限时返回false
+    bool grow_read_buf();
+    // 写缓冲区扩容到不小于need，达到大小上限时返回false
+    bool grow_write_buf(int need);
+    // 连接空闲时将读写缓冲区归还给缓冲区池(读缓冲区中还有未处理的数据时保留)
+    void release_buffers();
+    // 将当前请求的资源文件归还给文件缓存
+    void close_file();
+    // 将本批响应持有的全部资源文件归还给文件缓存
+    void close_files();
+    // 当前请求的资源文件内容已经加入iovec，由本批响应持有到发送完毕
+    void hold_file();
+    // 将m_write_buf中尚未加入iovec的响应报文数据加入iovec
+    void add_iov_write_buf();
+    // 将响应内容加入iovec
+    void add_iov(const char *buf, int len);
+    // 根据一次发送的结果更新发送进度，响应处理结束时返回true，并通过result给出write的返回值
+    bool write_done(int sent, bool &result);
 
     // 下面一组函数用于填充HTTP应答
     // 根据响应报文格式，生成对应8个部分，以下函数均由process_write调用填充HTTP应答
     bool add_response(const char *format, ...);
     bool add_content(const char *content);
+    bool add_data(const char *data, int len);
     bool add_status_line(int status,const char *title);
     bool add_headers(int content_length);
     bool add_content_type();
     bool add_content_length(int content_length);
     bool add_linger();
+    bool add_content_encoding();
+    bool add_content_range(off_t start, off_t end, off_t size);
+    bool add_validators();
     bool add_blank_line();
 
 public:
-    // epoll_create创建的epoll树实例
-    static int m_epollfd;
-    // 当前的连接客户端计数
-    static int m_user_count;
-    /*******************数据库对象*****************/
-    // 数据库对象
-    MYSQL *mysql;
-    /*******************数据库对象*****************/
+    // 当前的连接客户端计数(多个事件循环线程并发修改，使用原子变量)
+    static std::atomic<int> m_user_count;
+    // 下一个连接的代数(多个事件循环线程并发接受连接，使用原子变量)
+    static std::atomic<unsigned> m_next_generation;
+
+    // 以下成员按访问频率排列：每次读写事件都会访问的状态与下标放在对象开头，集中在前两个缓存行中，
+    // 请求解析结果其次，iovec数组、文件路径等体积较大的部分放在最后
+
+    // 该连接所属事件循环的epoll树实例，连接在其生命周期内固定在同一个事件循环上
+    int m_epollfd;
+    // 持有状态：HOLD_CLOSED位表示事件循环已关闭连接，其余部分为持有该连接的工作线程数 * HOLD_WORKER
+    std::atomic<int> m_hold;
     // IO 事件类别: 读事件为0，写事件为1
     int m_state;
+    // 进入线程池任务队列的时间(微秒，单调时钟)，由线程池设置，用于统计任务的排队时间
+    unsigned long m_queued_us;
+    /*******************数据库对象*****************/
+    // 数据库对象，工作线程处理该连接期间有效，路由处理函数第一次使用时才从连接池取出
+    lazy_connection *mysql;
+    /*******************数据库对象*****************/
 
 private:
     // 该http对象用于通信的套接字
     int m_sockfd;
-    // 客户端ip信息
-    sockaddr_in m_address;
-    // 存储读取的请求报文数据
-    char m_read_buf[READ_BUFFER_SIZE];
+    // 触发模式
+    int m_TRIGMode;
     // 读缓冲区m_read_buf中数据最后一个字节的下一个位置
     int m_read_idx;
     // m_read_buf当前正在读取的位置m_checked_idx(正在分析的字符在读缓冲区的位置)
     int m_checked_idx;
     // m_read_buf中已经解析的字符个数(当前正在解析的行的起始位置)
     int m_start_line;
-    // 存储发出的响应报文数据
-    char m_write_buf[WRITE_BUFFER_SIZE];
+    // 当前请求完整解析后，流水线中下一个请求在m_read_buf中的起始位置，-1表示当前请求尚未解析完
+    int m_next_request;
     // 指示m_write_buf中的长度
     int m_write_idx;
+    // m_write_buf中已经加入iovec的长度
+    int m_iv_write_idx;
+    // 剩余发送字节数
+    int bytes_to_send;
+    // 已发送字节数
+    int bytes_have_send;
+    // 第一个尚未发送完的iovec
+    int m_iv_idx;
+    int m_iv_count;
     // 主状态机的状态
     CHECK_STATE m_check_state;
+    // 判断HTTP请求是否保持连接
+    bool m_linger;
+    // 本批最后一个响应是否为长连接(流水线中后续请求的解析会修改m_linger)
+    bool m_batch_linger;
+    // 读缓冲区中还有流水线中的后续请求等待处理
+    std::atomic<bool> m_pipelined;
+    // 存储读取的请求报文数据，从缓冲区池分配，请求较大时扩容
+    // 解析时不修改其中的数据，解析结果以视图的形式保存在m_request中
+    buffer m_read_buf;
+    // 存储发出的响应报文数据，从缓冲区池分配，响应报文头部较多时扩容
+    buffer m_write_buf;
+    // 当前请求的资源文件，从文件缓存获取
+    // 有共享内存映射的小文件与响应报文头部一起writev，交给m_batch_files持有
+    // 其余文件在生成响应后仍保存在这里，作为本批最后一个响应，由sendfile从m_file_offset处发送
+    file_entry *m_file;
+    // 资源文件下一次sendfile的起始偏移
+    off_t m_file_offset;
+    // 本批响应中内容已经加入iovec的资源文件数量
+    int m_batch_file_count;
+    // 本批合并发送的响应数量
+    int m_batch_count;
+
     // 请求方法
     METHOD m_method;
-
-    // 以下为解析请求报文中对应的6个变量
-    // m_real_file存储读取文件的名称
-    // 存储客户请求文件的完整路径，其内容等于 doc_root + m_url, doc_root是网站根目录
-    char m_real_file[FILENAME_LEN];
-    // 请求目标文件的文件名，客户端想要访问的资源
-    char *m_url;
-    // HTTP协议版本,仅支持HTTP 1.1
-    char *m_version;
-    // 指定了服务器的域名或IP地址
-    char *m_host;
+    // 以下为解析请求报文中对应的变量
     // 请求报文的请求数据(请求体)的总长度
-    int m_content_length;
-    // 判断HTTP请求是否保持连接
-    bool m_linger;
+    off_t m_content_length;
+    // 流式接收请求体时，请求体的接收者与尚未到达的长度
+    body_sink *m_sink;
+    off_t m_body_left;
+    // 请求体使用分块传输编码，由m_decoder解码
+    bool m_chunked;
+    chunked_decoder m_decoder;
+    // 分块发送的响应内容的来源，最后一段发送前为非NULL
+    body_source *m_source;
+    // 客户端接受的内容编码，(1 << FILE_ENCODING)组成的位掩码
+    int m_accept_encoding;
+    // 是否为范围请求(Range: bytes=start-end)，只支持单个范围
+    bool m_range;
+    // 请求范围的起止位置(包含end)，-1表示省略：start-、-suffix
+    off_t m_range_start;
+    off_t m_range_end;
 
-    // 读取服务器上的文件地址(客户请求的资源文件被mmap（内存映射）到内存中的起始位置)
-    char *m_file_address;
-    // 客户端请求的资源文件状态(是否存在/是否为目录/是否可读/并获取文件大小等信息)
-    struct stat m_file_stat;
-    // io向量机制iovec
-    struct iovec m_iv[2];
-    int m_iv_count;
-    // 是否启用的POST
-    int cgi;
-    // 存储请求头数据
-    char *m_string;
-    // 剩余发送字节数
-    int bytes_to_send;
-    // 已发送字节数
-    int bytes_have_send;
     // 服务器根目录
     char *doc_root;
-
-    /*******************数据库相关变量*****************/
-    // 数据库用户名密码匹配表
-    std::map<std::string, std::string> m_users;
-    // 触发模式
-    int m_TRIGMode;
     // 是否开启日志
     int m_close_log;
-    char sql_user[100];
-    char sql_passwd[100];
-    char sql_name[100];
-    /*******************数据库相关变量*****************/
+    // 客户端ip信息
+    sockaddr_in m_address;
+    // 请求行、请求头部字段与请求体在读缓冲区中的位置
+    http_request m_request;
+    // 路由处理函数生成的响应
+    http_response m_response;
+    // 当前请求的异步处理句柄，工作线程处理完该连接后交出
+    http_async *m_async;
+    // 连接的代数
+    unsigned m_generation;
+    // 本批响应中内容已经加入iovec的资源文件，在发送完之前一直持有
+    file_entry *m_batch_files[PIPELINE_MAX];
+    // io向量机制iovec，依次指向各个响应的m_write_buf片段与响应内容(共享内存映射或预先生成的完整响应报文)
+    struct iovec m_iv[PIPELINE_MAX * 2];
+    // m_real_file存储读取文件的名称
+    // 存储客户请求文件的完整路径，其内容等于 doc_root + 请求的资源路径, doc_root是网站根目录
+    char m_real_file[FILENAME_LEN];
 };
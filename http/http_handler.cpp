@@ -0,0 +1,131 @@
+#include "http_handler.h"
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include "http_conn.h"
+#include "../reactor/completion_queue.h"
+
+
+const char *handler_request::header(HTTP_HEADER id, int &len) const
+{
+    http_view value;
+    if (!m_request.get(id, value))
+        return NULL;
+    len = value.len;
+    return m_base + value.off;
+}
+
+
+const char *handler_request::header(const char *name, int &len) const
+{
+    for (int i = 0; i < m_request.field_count; ++i)
+    {
+        const http_field &field = m_request.fields[i];
+        if (view_case_equal(m_base + field.name.off, field.name.len, name))
+        {
+            len = field.value.len;
+            return m_base + field.value.off;
+        }
+    }
+    return NULL;
+}
+
+
+file_body_sink::file_body_sink(int fd, const char *path, off_t max)
+    : m_fd(fd), m_path(path), m_max(max), m_size(0), m_done(false)
+{
+}
+
+
+file_body_sink::~file_body_sink()
+{
+    if (m_fd != -1)
+        close(m_fd);
+    if (!m_done)
+        unlink(m_path.c_str());
+}
+
+
+bool file_body_sink::write(const char *data, int len)
+{
+    // 分块传输编码的请求体事先不知道长度，写入时检查上限
+    m_size += len;
+    if (m_size > m_max)
+        return false;
+    while (len > 0)
+    {
+        ssize_t n = ::write(m_fd, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+
+void file_body_sink::finish(http_response &resp)
+{
+    m_done = close(m_fd) == 0;
+    m_fd = -1;
+    if (m_done)
+        resp.send(201, "Created", "text/plain", "", 0);
+}
+
+
+dir_body_source::dir_body_source(DIR *dir)
+    : m_dir(dir)
+{
+}
+
+
+dir_body_source::~dir_body_source()
+{
+    closedir(m_dir);
+}
+
+
+int dir_body_source::read(char *buf, int len)
+{
+    int n = 0;
+    while (n < len)
+    {
+        if (m_pending.empty())
+        {
+            struct dirent *entry = readdir(m_dir);
+            if (!entry)
+                break;
+            if (entry->d_name[0] == '.')
+                continue;
+            m_pending = entry->d_name;
+            m_pending += '\n';
+        }
+        int copy = len - n;
+        if (copy > (int)m_pending.size())
+            copy = m_pending.size();
+        memcpy(buf + n, m_pending.data(), copy);
+        m_pending.erase(0, copy);
+        n += copy;
+    }
+    return n;
+}
+
+
+http_async *http_response::defer()
+{
+    return m_conn->defer();
+}
+
+
+/*
+ * @func: 工作线程与complete都到达后，将句柄投递到连接所属事件循环的完成队列
+ */
+void http_async::arrive()
+{
+    if (m_pending.fetch_sub(1) == 1)
+        m_queue->post(this);
+}
@@ -0,0 +1,302 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include <dirent.h>
+#include <sys/types.h>
+#include <mysql/mysql.h>
+#include "http_request.h"
+#include "../CGImysql/sql_connection_pool.h"
+
+
+class http_conn;
+class http_async;
+class http_response;
+class completion_queue;
+
+
+/*
+ * 路由处理函数看到的请求
+ * 资源路径、查询字符串、请求头部字段与请求体都直接指向读缓冲区，不以\0结尾
+ * 只在处理函数执行期间有效，异步处理时需要的数据要在处理函数返回前复制出来
+ */
+class handler_request
+{
+public:
+    handler_request(const http_request &request, const char *base, int method, const char *root,
+                    lazy_connection *mysql)
+        : m_request(request), m_base(base), m_method(method), m_root(root), m_mysql(mysql) {}
+
+    // 请求方法(http_conn::METHOD)
+    int method() const
+    {
+        return m_method;
+    }
+    // 资源路径(以/开头)
+    const char *path(int &len) const
+    {
+        return view(m_request.path, len);
+    }
+    // ?之后的查询字符串
+    const char *query(int &len) const
+    {
+        return view(m_request.query, len);
+    }
+    // POST请求的请求体
+    const char *body(int &len) const
+    {
+        return view(m_request.body, len);
+    }
+    // 网站根目录(以\0结尾，不以/结尾)
+    const char *root() const
+    {
+        return m_root;
+    }
+    // 请求头部字段的值，不存在时返回NULL
+    const char *header(HTTP_HEADER id, int &len) const;
+    // 按字段名(忽略大小写)查找请求头部字段的值，用于没有编号的字段，不存在时返回NULL
+    const char *header(const char *name, int &len) const;
+    // 工作线程为本次请求取出的数据库连接，第一次调用时才从连接池取出，只能在处理函数中同步使用
+    MYSQL *mysql() const
+    {
+        return m_mysql ? m_mysql->get() : NULL;
+    }
+
+private:
+    const char *view(const http_view &v, int &len) const
+    {
+        len = v.len;
+        return m_base + v.off;
+    }
+
+private:
+    const http_request &m_request;
+    const char *m_base;
+    int m_method;
+    const char *m_root;
+    lazy_connection *m_mysql;
+};
+
+
+/*
+ * 流式请求体的接收者
+ * 路由处理函数通过http_response::receive_body设置，请求体到达后分段交给write，
+ * 不在读缓冲区中累积，上传的大小不受读缓冲区大小上限限制
+ * 请求体全部到达后调用finish填写响应(可以defer)，之后由连接delete
+ */
+class body_sink
+{
+public:
+    virtual ~body_sink() {}
+    // 收到一段请求体，返回false时放弃该请求，回复500并关闭连接
+    virtual bool write(const char *data, int len) = 0;
+    // 请求体全部到达，填写响应
+    virtual void finish(http_response &resp) = 0;
+};
+
+
+/*
+ * 分块发送的响应内容的来源
+ * 路由处理函数通过http_response::send_stream设置，响应以分块传输编码(Transfer-Encoding: chunked)发送，
+ * 不需要事先知道内容长度，也不需要一次生成全部内容
+ * 上一段发送完后才由工作线程调用read生成下一段，网络较慢时不会在内存中堆积，之后由连接delete
+ */
+class body_source
+{
+public:
+    virtual ~body_source() {}
+    // 生成下一段内容写入buf(最多len字节)，返回写入的字节数，返回0表示内容结束，返回-1时关闭连接
+    virtual int read(char *buf, int len) = 0;
+};
+
+
+/*
+ * 将请求体写入文件的body_sink，请求体全部写入后回复201
+ * 连接在请求体到达之前关闭，或写入的大小超出上限时，删除不完整的文件
+ */
+class file_body_sink : public body_sink
+{
+public:
+    // fd为已经打开的文件，由该对象关闭；path用于删除不完整的文件；max为文件的大小上限(字节)
+    file_body_sink(int fd, const char *path, off_t max);
+    ~file_body_sink();
+    bool write(const char *data, int len);
+    void finish(http_response &resp);
+
+private:
+    int m_fd;
+    std::string m_path;
+    // 文件的大小上限与已经写入的大小
+    off_t m_max;
+    off_t m_size;
+    // 请求体已经全部写入
+    bool m_done;
+};
+
+
+/*
+ * 逐段列出目录中文件名的body_source，每个文件名一行，跳过以.开头的文件
+ * 目录中的文件数量不限，每段只读取放得下的文件名，放不下的部分留到下一段
+ */
+class dir_body_source : public body_source
+{
+public:
+    // dir为已经打开的目录，由该对象关闭
+    explicit dir_body_source(DIR *dir);
+    ~dir_body_source();
+    int read(char *buf, int len);
+
+private:
+    DIR *m_dir;
+    // 上一段放不下的文件名的剩余部分
+    std::string m_pending;
+};
+
+
+/*
+ * 路由处理函数生成的响应，三选一：
+ * send_file发送网站根目录下的页面，与静态文件一样经过文件缓存，支持条件请求、范围请求与预压缩
+ * send发送处理函数生成的内容(例如JSON)，内容复制到连接的写缓冲区
+ * send_stream以分块传输编码逐段发送body_source生成的内容
+ * 都没有调用时回复500
+ */
+class http_response
+{
+public:
+    http_response() : m_conn(NULL) { clear(); }
+
+    // 发送网站根目录下的页面，page以/开头，必须是静态字符串
+    void send_file(const char *page)
+    {
+        m_file = page;
+    }
+    // 发送生成的内容，title与content_type必须是静态字符串
+    void send(int status, const char *title, const char *content_type, const char *body, int len)
+    {
+        m_status = status;
+        m_title = title;
+        m_content_type = content_type;
+        m_body.assign(body, len);
+    }
+    // 逐段发送source生成的内容，source由连接持有
+    void send_stream(int status, const char *title, const char *content_type, body_source *source)
+    {
+        m_status = status;
+        m_title = title;
+        m_content_type = content_type;
+        m_source = source;
+    }
+    // 异步处理：处理函数返回后连接不再等待，由返回的句柄在任意线程完成响应
+    // 只能在处理函数中调用一次，之后应填写句柄中的响应，而不是当前对象
+    http_async *defer();
+    // 以流的形式接收请求体，由sink生成响应，sink由连接持有
+    // 路由设置了stream_body时，处理函数在请求头部解析完后即被调用，请求体随后分段到达
+    // 否则请求体已经完整读入，一次交给sink
+    void receive_body(body_sink *sink)
+    {
+        m_sink = sink;
+    }
+
+    // 以下由http_conn使用
+    void clear()
+    {
+        m_file = NULL;
+        m_status = 0;
+        m_title = NULL;
+        m_content_type = NULL;
+        m_body.clear();
+        m_sink = NULL;
+        m_source = NULL;
+    }
+    void bind(http_conn *conn)
+    {
+        m_conn = conn;
+    }
+    const char *get_file() const
+    {
+        return m_file;
+    }
+    int get_status() const
+    {
+        return m_status;
+    }
+    const char *get_title() const
+    {
+        return m_title;
+    }
+    const char *get_content_type() const
+    {
+        return m_content_type;
+    }
+    const std::string &get_body() const
+    {
+        return m_body;
+    }
+    body_sink *get_sink() const
+    {
+        return m_sink;
+    }
+    body_source *get_source() const
+    {
+        return m_source;
+    }
+
+private:
+    // 生成该响应的连接，defer时使用
+    http_conn *m_conn;
+    const char *m_file;
+    int m_status;
+    const char *m_title;
+    const char *m_content_type;
+    std::string m_body;
+    body_sink *m_sink;
+    body_source *m_source;
+};
+
+
+/*
+ * 异步处理的完成句柄
+ * 处理函数通过http_response::defer获得，将耗时的工作交给其他线程，工作线程随即返回处理其他连接
+ * 工作完成后在response()中填写响应并调用complete，句柄交给连接所属事件循环的完成队列，
+ * 由事件循环生成响应报文并注册写事件
+ * 连接在此期间超时关闭(文件描述符已被其他连接复用)时，事件循环丢弃该响应
+ */
+class http_async
+{
+public:
+    http_async(int sockfd, unsigned generation, completion_queue *queue)
+        : m_sockfd(sockfd), m_generation(generation), m_queue(queue), m_pending(2) {}
+
+    // 处理完成后需要填写的响应
+    http_response &response()
+    {
+        return m_response;
+    }
+    // 任意线程调用：处理完成，之后不能再访问该对象
+    void complete()
+    {
+        arrive();
+    }
+
+    // 以下由http_conn与事件循环使用
+    // 工作线程处理完该连接后调用，与complete都调用之后才交给事件循环
+    // (避免工作线程还在访问连接时事件循环就开始生成响应)
+    void arrive();
+    int get_sockfd() const
+    {
+        return m_sockfd;
+    }
+    unsigned get_generation() const
+    {
+        return m_generation;
+    }
+
+private:
+    int m_sockfd;
+    // 连接的代数，文件描述符被其他连接复用后不同
+    unsigned m_generation;
+    // 连接所属事件循环的完成队列
+    completion_queue *m_queue;
+    // 尚未到达的一方(工作线程与complete)的数量
+    std::atomic<int> m_pending;
+    http_response m_response;
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <string.h>
+#include <strings.h>
+#include "http_scan.h"
+
+
+// 读缓冲区中的一段数据：相对读缓冲区起始位置的偏移与长度
+// 只记录位置，不复制也不修改请求报文，读缓冲区扩容(首地址改变)后仍然有效
+struct http_view
+{
+    int off;
+    int len;
+};
+
+
+// 请求头部字段
+struct http_field
+{
+    // 需要处理的字段，其余为HEADER_UNKNOWN
+    HTTP_HEADER id;
+    http_view name;
+    // 字段值，不包括两端的空格和\t字符
+    http_view value;
+};
+
+
+/*
+ * 解析后的请求
+ * 请求行各部分、请求头部字段、请求体都是读缓冲区的视图，解析时不写入\0，也不复制报文
+ * 请求总是从读缓冲区开头开始解析(流水线中的后续请求会先移动到缓冲区开头)，偏移相对缓冲区起始位置
+ */
+struct http_request
+{
+    // 保存的请求头部字段数量上限，超出的字段忽略
+    static const int MAX_FIELDS = 32;
+
+    // 请求方法
+    http_view method;
+    // 请求的资源路径，不包括查询字符串
+    http_view path;
+    // ?之后的查询字符串
+    http_view query;
+    // HTTP协议版本
+    http_view version;
+    // POST请求的请求体
+    http_view body;
+    // 按出现顺序保存的请求头部字段
+    http_field fields[MAX_FIELDS];
+    int field_count;
+    // 需要处理的字段在fields中的下标(重复出现时为最后一个)，-1表示不存在
+    signed char index[HEADER_NUM];
+
+    // 清空上一个请求的解析结果
+    void clear()
+    {
+        method.len = path.len = query.len = version.len = body.len = 0;
+        method.off = path.off = query.off = version.off = body.off = 0;
+        field_count = 0;
+        memset(index, -1, sizeof(index));
+    }
+    // 添加请求头部字段，字段数量达到上限时忽略
+    void add_field(HTTP_HEADER id, http_view name, http_view value)
+    {
+        if (field_count >= MAX_FIELDS)
+            return;
+        fields[field_count].id = id;
+        fields[field_count].name = name;
+        fields[field_count].value = value;
+        if (id != HEADER_UNKNOWN)
+            index[id] = field_count;
+        field_count++;
+    }
+    // 获取请求头部字段的值，不存在时返回false
+    bool get(HTTP_HEADER id, http_view &value) const
+    {
+        if (index[id] < 0)
+            return false;
+        value = fields[(int)index[id]].value;
+        return true;
+    }
+};
+
+
+// 视图内容是否与字符串相同
+inline bool view_equal(const char *p, int len, const char *s)
+{
+    return len == (int)strlen(s) && memcmp(p, s, len) == 0;
+}
+
+
+// 视图内容是否与字符串相同，忽略大小写
+inline bool view_case_equal(const char *p, int len, const char *s)
+{
+    return len == (int)strlen(s) && strncasecmp(p, s, len) == 0;
+}
@@ -0,0 +1,89 @@
+#include "http_router.h"
+#include <stddef.h>
+
+
+http_router::http_router()
+{
+    node root = {'\0', -1, -1, -1, -1};
+    m_nodes.push_back(root);
+}
+
+
+http_router *http_router::get_instance()
+{
+    static http_router instance;
+    return &instance;
+}
+
+
+/*
+ * @func: 登记路由，沿路径逐字符查找或创建字典树节点，将路由挂到最后一个节点上
+ * @note: 同一节点上先登记的路由先匹配
+ */
+void http_router::add(const route &r)
+{
+    int cur = 0;
+    for (const char *p = r.path; *p; ++p)
+    {
+        int child = m_nodes[cur].child;
+        while (child != -1 && m_nodes[child].c != *p)
+            child = m_nodes[child].sibling;
+        if (child == -1)
+        {
+            node n = {*p, -1, m_nodes[cur].child, -1, -1};
+            m_nodes.push_back(n);
+            child = (int)m_nodes.size() - 1;
+            m_nodes[cur].child = child;
+        }
+        cur = child;
+    }
+
+    entry e = {r, -1};
+    m_routes.push_back(e);
+    int idx = (int)m_routes.size() - 1;
+    // 追加到链表末尾
+    int *tail = (r.match == ROUTE_EXACT) ? &m_nodes[cur].exact : &m_nodes[cur].prefix;
+    while (*tail != -1)
+        tail = &m_routes[*tail].next;
+    *tail = idx;
+}
+
+
+int http_router::find(int head, int method) const
+{
+    for (int i = head; i != -1; i = m_routes[i].next)
+    {
+        if (m_routes[i].r.methods & (1 << method))
+            return i;
+    }
+    return -1;
+}
+
+
+/*
+ * @func: 查找资源路径对应的路由
+ * @note: 沿字典树走一遍路径，记录经过的节点上最长的前缀匹配，
+ *        路径完整走完时优先使用该节点上的完全匹配
+ */
+const route *http_router::match(int method, const char *path, int len) const
+{
+    int best = find(m_nodes[0].prefix, method);
+    int cur = 0;
+    for (int i = 0; i < len; ++i)
+    {
+        int child = m_nodes[cur].child;
+        while (child != -1 && m_nodes[child].c != path[i])
+            child = m_nodes[child].sibling;
+        if (child == -1)
+            return best == -1 ? NULL : &m_routes[best].r;
+        cur = child;
+        int found = find(m_nodes[cur].prefix, method);
+        if (found != -1)
+            best = found;
+    }
+
+    int exact = find(m_nodes[cur].exact, method);
+    if (exact != -1)
+        return &m_routes[exact].r;
+    return best == -1 ? NULL : &m_routes[best].r;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+
+
+class handler_request;
+class http_response;
+
+// 路由处理函数：读取请求，在resp中填写响应(见http_handler.h)
+typedef void (*route_handler)(const handler_request &req, http_response &resp);
+
+// 路由的匹配方式
+enum ROUTE_MATCH
+{
+    // 资源路径与path完全相同
+    ROUTE_EXACT = 0,
+    // 资源路径以path开头
+    ROUTE_PREFIX
+};
+
+
+// 一条路由
+struct route
+{
+    // 资源路径或路径前缀，以/开头
+    const char *path;
+    ROUTE_MATCH match;
+    // 允许的请求方法，(1 << http_conn::METHOD)组成的位掩码
+    int methods;
+    // 静态页面：发送该文件(相对网站根目录)，handler为NULL时使用
+    const char *file;
+    // 处理函数：由它处理请求并生成响应，可以异步完成
+    route_handler handler;
+    // 流式接收请求体：请求头部解析完即调用处理函数，由它通过receive_body接收请求体
+    bool stream_body;
+};
+
+
+/*
+ * 路由表(进程内单例)
+ * 启动时通过add登记路由，按路径逐字符建立字典树，之后只读
+ * match沿字典树走一遍资源路径即可找到路由：完全匹配优先，其次是最长的前缀匹配
+ * 同一路径可以按请求方法登记多条路由，匹配时不分配内存、不加锁
+ */
+class http_router
+{
+public:
+    // 局部静态变量实现单例模式
+    static http_router *get_instance();
+
+    // 登记路由，只能在启动阶段(事件循环与工作线程运行之前)调用
+    void add(const route &r);
+    // 查找资源路径对应的路由，没有匹配的路由时返回NULL，由调用者按静态文件处理
+    const route *match(int method, const char *path, int len) const;
+
+private:
+    http_router();
+    ~http_router() {}
+    http_router(const http_router &) = delete;
+    http_router &operator=(const http_router &) = delete;
+
+    // 在节点的路由链表中查找允许该请求方法的路由，不存在时返回-1
+    int find(int head, int method) const;
+
+private:
+    // 字典树节点
+    struct node
+    {
+        // 从父节点到该节点的字符
+        char c;
+        // 第一个子节点与下一个兄弟节点，-1表示不存在
+        int child;
+        int sibling;
+        // 路径到该节点为止的完全匹配/前缀匹配路由链表，-1表示不存在
+        int exact;
+        int prefix;
+    };
+    // 登记的路由与同一节点上的下一条路由
+    struct entry
+    {
+        route r;
+        int next;
+    };
+
+    // 字典树节点，下标0为根节点
+    std::vector<node> m_nodes;
+    std::vector<entry> m_routes;
+};
@@ -0,0 +1,180 @@
+#include "http_scan.h"
+#include <strings.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTTP_SCAN_X86 1
+#endif
+
+
+/*
+ * @func: 逐字节查找\r或\n，也用于处理SIMD实现剩余的不足一组的字节
+ */
+static int scan_line_end_scalar(const char *buf, int begin, int end)
+{
+    for (; begin < end; ++begin)
+    {
+        if (buf[begin] == '\r' || buf[begin] == '\n')
+            break;
+    }
+    return begin;
+}
+
+
+#ifdef HTTP_SCAN_X86
+/*
+ * @func: SSE2实现，每次比较16个字节，x86_64总是支持SSE2
+ */
+__attribute__((target("sse2")))
+static int scan_line_end_sse2(const char *buf, int begin, int end)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    for (; begin + 16 <= end; begin += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + begin));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+        if (mask)
+            return begin + __builtin_ctz(mask);
+    }
+    return scan_line_end_scalar(buf, begin, end);
+}
+
+
+/*
+ * @func: AVX2实现，每次比较32个字节
+ */
+__attribute__((target("avx2")))
+static int scan_line_end_avx2(const char *buf, int begin, int end)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    for (; begin + 32 <= end; begin += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + begin));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+        if (mask)
+            return begin + __builtin_ctz(mask);
+    }
+    return scan_line_end_sse2(buf, begin, end);
+}
+#endif
+
+
+typedef int (*scan_func)(const char *, int, int);
+
+
+/*
+ * @func: 根据CPU支持的指令集选择扫描实现
+ */
+static scan_func select_scan()
+{
+#ifdef HTTP_SCAN_X86
+    // 在main之前的静态初始化阶段使用__builtin_cpu_supports，需要先初始化CPU信息
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return scan_line_end_avx2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return scan_line_end_sse2;
+    }
+#endif
+    return scan_line_end_scalar;
+}
+
+
+static scan_func s_scan = select_scan();
+
+
+int scan_line_end(const char *buf, int begin, int end)
+{
+    return s_scan(buf, begin, end);
+}
+
+
+bool scan_impl_supported(SCAN_IMPL impl)
+{
+    switch (impl)
+    {
+    case SCAN_SCALAR:
+        return true;
+#ifdef HTTP_SCAN_X86
+    case SCAN_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case SCAN_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+
+int scan_line_end_impl(SCAN_IMPL impl, const char *buf, int begin, int end)
+{
+    if (!scan_impl_supported(impl))
+        return -1;
+    switch (impl)
+    {
+#ifdef HTTP_SCAN_X86
+    case SCAN_SSE2:
+        return scan_line_end_sse2(buf, begin, end);
+    case SCAN_AVX2:
+        return scan_line_end_avx2(buf, begin, end);
+#endif
+    default:
+        return scan_line_end_scalar(buf, begin, end);
+    }
+}
+
+
+/*
+ * @func: 根据字段名查找请求头部字段
+ * @note: 需要处理的字段名长度几乎各不相同，按长度分支后最多两次比较
+ */
+HTTP_HEADER lookup_header(const char *name, int len)
+{
+    switch (len)
+    {
+    case 4:
+        if (strncasecmp(name, "Host", 4) == 0)
+            return HEADER_HOST;
+        break;
+    case 5:
+        if (strncasecmp(name, "Range", 5) == 0)
+            return HEADER_RANGE;
+        break;
+    case 8:
+        if (strncasecmp(name, "If-Range", 8) == 0)
+            return HEADER_IF_RANGE;
+        break;
+    case 10:
+        if (strncasecmp(name, "Connection", 10) == 0)
+            return HEADER_CONNECTION;
+        break;
+    case 13:
+        if (strncasecmp(name, "If-None-Match", 13) == 0)
+            return HEADER_IF_NONE_MATCH;
+        break;
+    case 14:
+        if (strncasecmp(name, "Content-Length", 14) == 0)
+            return HEADER_CONTENT_LENGTH;
+        break;
+    case 15:
+        if (strncasecmp(name, "Accept-Encoding", 15) == 0)
+            return HEADER_ACCEPT_ENCODING;
+        break;
+    case 17:
+        if (strncasecmp(name, "If-Modified-Since", 17) == 0)
+            return HEADER_IF_MODIFIED_SINCE;
+        if (strncasecmp(name, "Transfer-Encoding", 17) == 0)
+            return HEADER_TRANSFER_ENCODING;
+        break;
+    default:
+        break;
+    }
+    return HEADER_UNKNOWN;
+}
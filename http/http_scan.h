@@ -0,0 +1,43 @@
+#pragma once
+
+
+// 请求头部中需要处理的字段
+enum HTTP_HEADER
+{
+    HEADER_UNKNOWN = 0,
+    HEADER_HOST,
+    HEADER_RANGE,
+    HEADER_IF_RANGE,
+    HEADER_CONNECTION,
+    HEADER_CONTENT_LENGTH,
+    HEADER_IF_NONE_MATCH,
+    HEADER_ACCEPT_ENCODING,
+    HEADER_IF_MODIFIED_SINCE,
+    HEADER_TRANSFER_ENCODING,
+    HEADER_NUM
+};
+
+
+/*
+ * 请求报文扫描
+ * scan_line_end在[begin, end)中查找第一个\r或\n，x86上每次比较16(SSE2)或32(AVX2)个字节，
+ * 启动时根据CPU支持的指令集选择实现，其他平台使用逐字节比较
+ * lookup_header按字段名长度分组，组内只需要一次忽略大小写的比较
+ */
+// 返回第一个\r或\n的位置，不存在时返回end
+int scan_line_end(const char *buf, int begin, int end);
+
+// scan_line_end的各个实现，用于测试各实现的结果是否一致，以及基准测试比较各实现的速度
+enum SCAN_IMPL
+{
+    SCAN_SCALAR = 0,
+    SCAN_SSE2,
+    SCAN_AVX2,
+    SCAN_IMPL_NUM
+};
+// CPU是否支持该实现
+bool scan_impl_supported(SCAN_IMPL impl);
+// 使用指定的实现查找，CPU不支持该实现时返回-1
+int scan_line_end_impl(SCAN_IMPL impl, const char *buf, int begin, int end);
+// 根据字段名(不含冒号)查找请求头部字段
+HTTP_HEADER lookup_header(const char *name, int len);
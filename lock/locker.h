@@ -2,6 +2,12 @@
 #include <exception>
 #include <pthread.h>
 #include <semaphore.h>
+#include <atomic>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <time.h>
 
 // 互斥锁类
 class locker{
@@ -127,4 +133,82 @@ public:
     }
 private:
     sem_t  m_sem;
-};
\ No newline at end of file
+};
+
+
+// 事件计数类(eventcount)：无锁队列等数据结构的等待/唤醒，基于futex
+// 等待者先prepare_wait登记并取得当前纪元，再检查一次条件，条件仍不满足时wait(纪元)
+// 通知者先使条件成立(例如入队)，再notify：没有等待者时只是一次原子读，不进入内核
+// 登记之后、wait之前发生的notify会改变纪元，wait立即返回，不会丢失唤醒
+class event_count{
+public:
+    event_count() : m_epoch(0), m_waiters(0) {}
+
+    // 登记为等待者，返回当前纪元
+    int prepare_wait()
+    {
+        m_waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return m_epoch.load();
+    }
+
+    // 条件已经满足，取消登记
+    void cancel_wait()
+    {
+        m_waiters.fetch_sub(1);
+    }
+
+    // 纪元仍为epoch时阻塞，被唤醒(或纪元已经改变)后取消登记
+    void wait(int epoch)
+    {
+        syscall(SYS_futex, (int *)&m_epoch, FUTEX_WAIT_PRIVATE, epoch, NULL, NULL, 0);
+        m_waiters.fetch_sub(1);
+    }
+
+    // 同wait，最多阻塞timeout_ms毫秒，超时返回false
+    bool wait(int epoch, int timeout_ms)
+    {
+        struct timespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        long ret = syscall(SYS_futex, (int *)&m_epoch, FUTEX_WAIT_PRIVATE, epoch, &ts, NULL, 0);
+        bool timeout = (ret == -1 && errno == ETIMEDOUT);
+        m_waiters.fetch_sub(1);
+        return !timeout;
+    }
+
+    // 是否有已经登记的等待者
+    bool has_waiters() const
+    {
+        return m_waiters.load() > 0;
+    }
+
+    // 唤醒一个等待者
+    void notify_one()
+    {
+        notify(1);
+    }
+
+    // 唤醒全部等待者
+    void notify_all()
+    {
+        notify(0x7fffffff);
+    }
+
+private:
+    void notify(int count)
+    {
+        // 与prepare_wait中的fetch_add构成Dekker式同步：
+        // 要么通知者看到等待者，要么等待者在登记后的检查中看到已经成立的条件
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load() == 0)
+            return;
+        m_epoch.fetch_add(1);
+        syscall(SYS_futex, (int *)&m_epoch, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+    }
+
+    // futex字，每次通知加1
+    std::atomic<int> m_epoch;
+    // 已经登记的等待者数量
+    std::atomic<int> m_waiters;
+};
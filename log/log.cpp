@@ -4,6 +4,7 @@
 #include <time.h>
 #include <stdarg.h>
 #include <cstring>
+#include "../affinity/cpu_affinity.h"
 
 
 using namespace std;
@@ -77,7 +78,7 @@ void *Log::async_write_log()
  *      2.创建写缓冲区
  *      3.异步,还需要设置阻塞队列,且创建一个写线程，从阻塞队列中pop日志信息写入到日志文件中
  */
-bool Log::init(const char *file_name, int close_log, int log_buf_size, int split_lines, int max_queue_size)
+bool Log::init(const char *file_name, int close_log, int log_buf_size, int split_lines, int max_queue_size, int cpu)
 {
     //如果设置了max_queue_size,则设置为异步
     if (max_queue_size >= 1)
@@ -86,8 +87,13 @@ bool Log::init(const char *file_name, int close_log, int log_buf_size, int split
         // string类型日志的循环队列
         m_log_queue = new block_queue<std::string>(max_queue_size);
         pthread_t tid;
+        // 异步写日志线程绑定CPU，避免被调度器在核之间迁移
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        cpu_affinity::set_attr(&attr, cpu);
         // flush_log_thread为回调函数,这里表示创建线程异步写日志
-        pthread_create(&tid, NULL, flush_log_thread, NULL);
+        pthread_create(&tid, &attr, flush_log_thread, NULL);
+        pthread_attr_destroy(&attr);
     }
 
     m_close_log = close_log;
@@ -221,7 +227,11 @@ void Log::write_log(int level, const char *format, ...)
 
     // 传入的日志信息，已经按照format赋值给valst
     // 将日志信息写入m_buf
-    int m = vsnprintf(m_buf + n, m_log_buf_size - 1, format, valst);
+    // 超出日志缓冲区的部分截断，保留换行符与\0的位置
+    int avail = m_log_buf_size - n - 1;
+    int m = vsnprintf(m_buf + n, avail, format, valst);
+    if (m >= avail)
+        m = avail - 1;
     m_buf[n + m] = '\n';
     m_buf[n + m + 1] = '\0';
     log_str = m_buf;
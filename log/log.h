@@ -14,8 +14,9 @@ public:
     static void *flush_log_thread(void *args);
 
     //可选择的参数有日志文件、日志缓冲区大小、最大行数以及最长日志条队列
+    //cpu不小于0时，异步写日志线程绑定到该CPU
     bool init(const char *file_name, int close_log, int log_buf_size = 8192,
-              int split_lines = 5000000, int max_queue_size = 0);
+              int split_lines = 5000000, int max_queue_size = 0, int cpu = -1);
     // 将输出内容按照标准格式整理
     void write_log(int level, const char *format, ...);
     // 强制刷新缓冲区
@@ -19,7 +19,13 @@ int main(int argc, char *argv[])
     // 初始化服务器相关变量
     server.init(config.PORT, config.user, config.password, config.databasename,
                 config.LOGWrite, config.OPT_LINGER, config.TRIGMode,  config.sql_num,  config.thread_num,
-                config.close_log, config.actor_model, config.db_Port);
+                config.close_log, config.actor_model, config.db_Port, config.reactor_num,
+                config.backlog, config.reuseport, config.io_engine, config.file_cache,
+                config.buffer_max, config.schedule, config.cpu_list, config.thread_max,
+                config.upload_max);
+
+    // 解析线程绑定的CPU列表，需要在创建日志线程之前
+    server.affinity_init();
 
     // 初始化日志系统
     server.log_write();
@@ -27,6 +33,15 @@ int main(int argc, char *argv[])
     // 初始化数据库连接池
     server.sql_pool();
 
+    // 初始化静态文件缓存
+    server.cache_init();
+
+    // 初始化连接读写缓冲区的缓冲区池
+    server.buffer_init();
+
+    // 登记路由
+    server.route_init();
+
     // 初始化线程池
     server.thread_pool();
 
@@ -38,6 +53,9 @@ int main(int argc, char *argv[])
     // 定时器系统用于统一事件源的管道套接字创建设置
     server.eventListen();
 
+    // 创建从Reactor(主Reactor + N个从Reactor模式)
+    server.reactor_pool();
+
     // 运行
     server.eventLoop();
 
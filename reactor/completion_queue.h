@@ -0,0 +1,101 @@
+/*************************************************************
+*完成队列：Reactor模式下工作线程向事件循环回报处理结果
+*工作线程读/写失败或短连接响应发送完毕时，将需要关闭的连接投递到该连接所属事件循环的完成队列中，
+*并通过eventfd唤醒事件循环；事件循环在epoll上监听eventfd，批量取出后删除定时器、关闭连接
+*处理成功的连接由工作线程重新注册EPOLLONESHOT事件即可，不需要回报，定时器已在分发任务时调整
+*异步路由处理函数(见http/http_handler.h)完成后也投递到这里，由事件循环生成响应并注册写事件
+*这样事件循环把任务交给线程池后即可继续处理其他事件，不必等待工作线程处理完成
+**************************************************************/
+#pragma once
+#include <list>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include "../lock/locker.h"
+
+
+class http_async;
+
+
+// 需要关闭的连接：通信套接字与投递时连接的代数
+// 投递之后、事件循环处理之前连接可能已经因超时等原因关闭，文件描述符被新连接复用，代数不同时不关闭
+struct completion_close
+{
+    int sockfd;
+    unsigned generation;
+};
+
+
+class completion_queue
+{
+public:
+    completion_queue()
+    {
+        // 非阻塞eventfd，计数器为0时read直接返回EAGAIN
+        m_eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_eventfd == -1)
+        {
+            throw std::exception();
+        }
+    }
+
+    ~completion_queue()
+    {
+        close(m_eventfd);
+    }
+
+    // 挂到事件循环epoll实例上的文件描述符
+    int get_fd()
+    {
+        return m_eventfd;
+    }
+
+    // 工作线程调用：投递一个需要关闭的连接(generation为该连接的代数)，并唤醒事件循环
+    void post(int sockfd, unsigned generation)
+    {
+        completion_close item = {sockfd, generation};
+        m_mutex.lock();
+        m_queue.push_back(item);
+        m_mutex.unlock();
+
+        // eventfd计数器累加，多次投递只会唤醒事件循环一次
+        uint64_t one = 1;
+        ssize_t ret = ::write(m_eventfd, &one, sizeof one);
+        (void)ret;
+    }
+
+    // 任意线程调用：投递一个已完成的异步处理，并唤醒事件循环
+    void post(http_async *async)
+    {
+        m_mutex.lock();
+        m_async.push_back(async);
+        m_mutex.unlock();
+
+        uint64_t one = 1;
+        ssize_t ret = ::write(m_eventfd, &one, sizeof one);
+        (void)ret;
+    }
+
+    // 事件循环调用：清空eventfd计数器，一次性取出全部需要关闭的连接与已完成的异步处理
+    void take(std::list<completion_close> &items, std::list<http_async *> &asyncs)
+    {
+        uint64_t count;
+        ssize_t ret = ::read(m_eventfd, &count, sizeof count);
+        (void)ret;
+
+        m_mutex.lock();
+        items.swap(m_queue);
+        asyncs.swap(m_async);
+        m_mutex.unlock();
+    }
+
+private:
+    // 用于唤醒事件循环的eventfd
+    int m_eventfd;
+    // 需要关闭的连接队列
+    std::list<completion_close> m_queue;
+    // 已完成的异步处理队列
+    std::list<http_async *> m_async;
+    // 保护队列的互斥锁
+    locker m_mutex;
+};
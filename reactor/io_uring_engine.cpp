@@ -0,0 +1,213 @@
+#include "io_uring_engine.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+
+// 内核与用户态共享的队列指针，需要使用带内存序的读写
+#define URING_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define URING_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+
+io_uring_engine::io_uring_engine() :
+        m_ring_fd(-1), m_sq_ptr(MAP_FAILED), m_cq_ptr(MAP_FAILED), m_sq_ring_sz(0), m_cq_ring_sz(0),
+        m_sqes((struct io_uring_sqe *)MAP_FAILED), m_sqes_sz(0), m_pending(0), m_inflight(0)
+{
+}
+
+
+io_uring_engine::~io_uring_engine()
+{
+    if (m_sqes != MAP_FAILED)
+        munmap(m_sqes, m_sqes_sz);
+    if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr)
+        munmap(m_cq_ptr, m_cq_ring_sz);
+    if (m_sq_ptr != MAP_FAILED)
+        munmap(m_sq_ptr, m_sq_ring_sz);
+    if (m_ring_fd != -1)
+        close(m_ring_fd);
+}
+
+
+/*
+ * @func: 创建io_uring实例，映射提交队列、完成队列与提交队列项数组
+ * @param: entries 提交队列长度
+ */
+bool io_uring_engine::init(unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof p);
+    m_ring_fd = sys_io_uring_setup(entries, &p);
+    if (m_ring_fd < 0)
+    {
+        m_ring_fd = -1;
+        return false;
+    }
+
+    m_sq_ring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    m_cq_ring_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    // 新内核中提交队列与完成队列可以通过一次mmap映射
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+    {
+        if (m_cq_ring_sz > m_sq_ring_sz)
+            m_sq_ring_sz = m_cq_ring_sz;
+        m_cq_ring_sz = m_sq_ring_sz;
+    }
+
+    m_sq_ptr = mmap(0, m_sq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ptr == MAP_FAILED)
+        return false;
+
+    if (single_mmap)
+    {
+        m_cq_ptr = m_sq_ptr;
+    }
+    else
+    {
+        m_cq_ptr = mmap(0, m_cq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        m_ring_fd, IORING_OFF_CQ_RING);
+        if (m_cq_ptr == MAP_FAILED)
+            return false;
+    }
+
+    m_sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    m_sqes = (struct io_uring_sqe *)mmap(0, m_sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                         m_ring_fd, IORING_OFF_SQES);
+    if (m_sqes == MAP_FAILED)
+        return false;
+
+    char *sq = (char *)m_sq_ptr;
+    m_sq_head = (unsigned *)(sq + p.sq_off.head);
+    m_sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    m_sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    m_sq_entries = (unsigned *)(sq + p.sq_off.ring_entries);
+    m_sq_array = (unsigned *)(sq + p.sq_off.array);
+
+    char *cq = (char *)m_cq_ptr;
+    m_cq_head = (unsigned *)(cq + p.cq_off.head);
+    m_cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    m_cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    m_cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return true;
+}
+
+
+/*
+ * @func: 获取一个空闲的提交队列项，并将其放入提交队列
+ * @note: 尚在飞行中的操作也占用完成队列空间，因此同时限制已准备与已提交未完成的数量
+ */
+struct io_uring_sqe *io_uring_engine::get_sqe()
+{
+    if (m_pending + m_inflight >= *m_sq_entries)
+        return NULL;
+
+    unsigned tail = *m_sq_tail;
+    unsigned head = URING_LOAD_ACQUIRE(m_sq_head);
+    if (tail - head >= *m_sq_entries)
+        return NULL;
+
+    unsigned index = tail & *m_sq_mask;
+    struct io_uring_sqe *sqe = &m_sqes[index];
+    memset(sqe, 0, sizeof *sqe);
+    m_sq_array[index] = index;
+    URING_STORE_RELEASE(m_sq_tail, tail + 1);
+    ++m_pending;
+    return sqe;
+}
+
+
+/*
+ * @func: 准备一个recv操作
+ */
+bool io_uring_engine::prep_recv(int fd, void *buf, unsigned len, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->user_data = user_data;
+    return true;
+}
+
+
+/*
+ * @func: 准备一个writev操作
+ * @note: iov指向的向量在操作完成之前必须保持有效
+ */
+bool io_uring_engine::prep_writev(int fd, const struct iovec *iov, int iovcnt, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)iov;
+    sqe->len = iovcnt;
+    sqe->user_data = user_data;
+    return true;
+}
+
+
+/*
+ * @func: 一次io_uring_enter提交全部已准备的操作，并等待全部完成
+ */
+bool io_uring_engine::submit_and_wait()
+{
+    while (m_pending > 0 || m_inflight > 0)
+    {
+        unsigned wait_nr = m_pending + m_inflight;
+        int ret = sys_io_uring_enter(m_ring_fd, m_pending, wait_nr, IORING_ENTER_GETEVENTS);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        m_pending -= ret;
+        m_inflight += ret;
+
+        // 完成队列中的事件已经足够，由pop_cqe取出
+        unsigned ready = URING_LOAD_ACQUIRE(m_cq_tail) - *m_cq_head;
+        if (m_pending == 0 && ready >= m_inflight)
+            break;
+    }
+    return true;
+}
+
+
+/*
+ * @func: 从完成队列中取出一个完成事件
+ */
+bool io_uring_engine::pop_cqe(uint64_t &user_data, int &res)
+{
+    unsigned head = *m_cq_head;
+    if (head == URING_LOAD_ACQUIRE(m_cq_tail))
+        return false;
+
+    struct io_uring_cqe *cqe = &m_cqes[head & *m_cq_mask];
+    user_data = cqe->user_data;
+    res = cqe->res;
+    URING_STORE_RELEASE(m_cq_head, head + 1);
+    if (m_inflight > 0)
+        --m_inflight;
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+
+/*
+ * io_uring I/O引擎：直接使用io_uring_setup/io_uring_enter系统调用与共享内存环形队列，不依赖liburing
+ * 事件循环在一次epoll_wait返回后，将本轮所有就绪连接的recv/writev操作写入提交队列(SQ)，
+ * 再通过一次io_uring_enter批量提交并等待完成，从完成队列(CQ)中取出每个操作的结果
+ * 这样每轮事件只需要一次系统调用，而不是每个连接一次recv/writev
+ * 注意：
+ *      通信套接字是非阻塞的，操作无法立即完成时结果为-EAGAIN，不会在内核中挂起，因此批量等待不会阻塞事件循环
+ *      每个事件循环独占一个io_uring实例，不需要加锁
+ */
+class io_uring_engine
+{
+public:
+    io_uring_engine();
+    ~io_uring_engine();
+
+    // 创建io_uring实例并映射提交/完成队列，内核不支持时返回false
+    bool init(unsigned entries);
+    // 准备一个recv操作，提交队列已满时返回false
+    bool prep_recv(int fd, void *buf, unsigned len, uint64_t user_data);
+    // 准备一个writev操作，提交队列已满时返回false
+    bool prep_writev(int fd, const struct iovec *iov, int iovcnt, uint64_t user_data);
+    // 提交全部已准备的操作，并等待它们全部完成
+    bool submit_and_wait();
+    // 取出一个完成事件，res为操作结果(字节数或-errno)，没有完成事件时返回false
+    bool pop_cqe(uint64_t &user_data, int &res);
+    // 已准备但尚未提交的操作数量
+    unsigned pending() const
+    {
+        return m_pending;
+    }
+
+private:
+    // 获取一个空闲的提交队列项
+    struct io_uring_sqe *get_sqe();
+
+private:
+    // io_uring实例的文件描述符
+    int m_ring_fd;
+    // 提交队列/完成队列环形缓冲区的映射
+    void *m_sq_ptr;
+    void *m_cq_ptr;
+    size_t m_sq_ring_sz;
+    size_t m_cq_ring_sz;
+    // 提交队列项数组的映射
+    struct io_uring_sqe *m_sqes;
+    size_t m_sqes_sz;
+
+    // 提交队列：内核消费head，用户生产tail
+    unsigned *m_sq_head;
+    unsigned *m_sq_tail;
+    unsigned *m_sq_mask;
+    unsigned *m_sq_entries;
+    unsigned *m_sq_array;
+    // 完成队列：内核生产tail，用户消费head
+    unsigned *m_cq_head;
+    unsigned *m_cq_tail;
+    unsigned *m_cq_mask;
+    struct io_uring_cqe *m_cqes;
+
+    // 已准备但尚未提交的操作数量
+    unsigned m_pending;
+    // 已提交但尚未取出完成事件的操作数量
+    unsigned m_inflight;
+};
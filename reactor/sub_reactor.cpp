@@ -0,0 +1,278 @@
+#include "sub_reactor.h"
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include "../webserver.h"
+
+
+// 唤醒管道上传递的消息类型
+// 有新连接等待注册
+static const char WAKEUP_NEWCONN = 'c';
+// 定时器信号到达
+static const char WAKEUP_TICK = 't';
+// 退出事件循环
+static const char WAKEUP_QUIT = 'q';
+
+
+/*
+ * @func: 从Reactor构造函数
+ * @param: server 所属服务器
+ * @param: id 从Reactor编号
+ * @param: close_log 是否关闭日志
+ */
+sub_reactor::sub_reactor(WebServer *server, int id, int close_log) :
+        m_server(server), m_id(id), m_close_log(close_log),
+        m_epollfd(-1), m_listenfd(-1), m_running(false), m_events(NULL), m_ring(NULL)
+{
+    m_wakeupfd[0] = -1;
+    m_wakeupfd[1] = -1;
+}
+
+
+/*
+ * @func: 析构函数，停止事件循环并释放资源
+ */
+sub_reactor::~sub_reactor()
+{
+    stop();
+    if (m_epollfd != -1)
+        close(m_epollfd);
+    if (m_listenfd != -1)
+        close(m_listenfd);
+    if (m_wakeupfd[0] != -1)
+    {
+        close(m_wakeupfd[0]);
+        close(m_wakeupfd[1]);
+    }
+    delete[] m_events;
+    delete m_ring;
+}
+
+
+/*
+ * @func: 创建本事件循环独占的epoll实例与唤醒管道，启动事件循环线程
+ * @param: listenfd 该从Reactor独占的SO_REUSEPORT监听套接字，-1表示不持有监听套接字
+ * @param: listen_trigmode 监听套接字的事件触发模式
+ * @param: cpu 事件循环线程绑定的CPU，-1表示不绑定
+ */
+bool sub_reactor::start(int listenfd, int listen_trigmode, int cpu)
+{
+    m_epollfd = epoll_create(5);
+    if (m_epollfd == -1)
+        return false;
+
+    // 监听套接字挂到本epoll实例上，由本线程accept
+    m_listenfd = listenfd;
+    if (m_listenfd != -1)
+        m_server->utils.addfd(m_epollfd, m_listenfd, false, listen_trigmode);
+
+    // 与定时器的统一事件源一样，使用socketpair作为唤醒管道
+    if (socketpair(PF_UNIX, SOCK_STREAM, 0, m_wakeupfd) == -1)
+        return false;
+    // 写端非阻塞，主Reactor写入时不会被阻塞
+    m_server->utils.setnonblocking(m_wakeupfd[1]);
+    // 读端挂到本epoll实例上，LT模式
+    m_server->utils.addfd(m_epollfd, m_wakeupfd[0], false, 0);
+    // 完成队列的eventfd挂到本epoll实例上
+    m_server->utils.addfd(m_epollfd, m_completion.get_fd(), false, 0);
+
+    m_events = new epoll_event[MAX_EVENT_NUMBER];
+    // 开启io_uring引擎时，每个事件循环独占一个io_uring实例
+    m_ring = m_server->create_ring();
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    cpu_affinity::set_attr(&attr, cpu);
+    int ret = pthread_create(&m_thread, &attr, worker, this);
+    pthread_attr_destroy(&attr);
+    if (ret != 0)
+        return false;
+    m_running = true;
+    return true;
+}
+
+
+/*
+ * @func: 通知事件循环线程退出，并等待其结束
+ */
+void sub_reactor::stop()
+{
+    if (!m_running)
+        return;
+    wakeup(WAKEUP_QUIT);
+    pthread_join(m_thread, NULL);
+    m_running = false;
+}
+
+
+/*
+ * @func: 主Reactor调用，将新连接放入待注册队列，并唤醒从Reactor
+ * @note: 连接的初始化(挂到epoll实例、创建定时器)在从Reactor线程中完成，
+ *        这样定时器容器只会被其所属线程访问，不需要加锁
+ */
+void sub_reactor::dispatch(int connfd, const sockaddr_in &client_address)
+{
+    client_data conn;
+    conn.address = client_address;
+    conn.sockfd = connfd;
+    conn.timer = NULL;
+
+    m_queuelocker.lock();
+    m_pending.push_back(conn);
+    m_queuelocker.unlock();
+
+    wakeup(WAKEUP_NEWCONN);
+}
+
+
+/*
+ * @func: 主Reactor调用，通知从Reactor处理到期的定时器
+ */
+void sub_reactor::tick()
+{
+    wakeup(WAKEUP_TICK);
+}
+
+
+/*
+ * @func: 向唤醒管道写入一个消息字符
+ */
+void sub_reactor::wakeup(char msg)
+{
+    send(m_wakeupfd[1], &msg, 1, 0);
+}
+
+
+/*
+ * @func: 从Reactor线程函数
+ * @note: 屏蔽SIGALRM/SIGTERM，信号统一由主Reactor线程处理
+ */
+void *sub_reactor::worker(void *arg)
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGALRM);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    sub_reactor *reactor = (sub_reactor *)arg;
+    reactor->run();
+    return reactor;
+}
+
+
+/*
+ * @func: 处理唤醒管道上的消息
+ */
+bool sub_reactor::dealwithwakeup(bool &timeout, bool &stop)
+{
+    char msgs[1024];
+    int ret = recv(m_wakeupfd[0], msgs, sizeof(msgs), 0);
+    if (ret <= 0)
+        return false;
+
+    for (int i = 0; i < ret; ++i)
+    {
+        switch (msgs[i])
+        {
+            case WAKEUP_NEWCONN:
+            {
+                dealwithnewconn();
+                break;
+            }
+            case WAKEUP_TICK:
+            {
+                timeout = true;
+                break;
+            }
+            case WAKEUP_QUIT:
+            {
+                stop = true;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+
+/*
+ * @func: 取出待注册队列中的全部新连接，挂到本事件循环上
+ */
+void sub_reactor::dealwithnewconn()
+{
+    std::list<client_data> conns;
+    m_queuelocker.lock();
+    conns.swap(m_pending);
+    m_queuelocker.unlock();
+
+    for (std::list<client_data>::iterator it = conns.begin(); it != conns.end(); ++it)
+    {
+        // 初始化http连接对象并创建定时器，连接从此固定在本事件循环上
+        m_server->timer(it->sockfd, it->address, this);
+    }
+}
+
+
+/*
+ * @func: 从Reactor事件循环，与WebServer::eventLoop处理逻辑一致，但只处理本循环持有的连接
+ */
+void sub_reactor::run()
+{
+    bool timeout = false;
+    bool stop = false;
+
+    while (!stop)
+    {
+        int number = epoll_wait(m_epollfd, m_events, MAX_EVENT_NUMBER, -1);
+        if (number < 0 && errno != EINTR)
+        {
+            LOG_ERROR("sub reactor %d: %s", m_id, "epoll failure");
+            break;
+        }
+
+        for (int i = 0; i < number; i++)
+        {
+            int sockfd = m_events[i].data.fd;
+            // SO_REUSEPORT分片模式下，本线程的监听套接字上有新连接
+            if (sockfd == m_listenfd)
+            {
+                m_server->dealclientdata(m_listenfd, this);
+            }
+            // 主Reactor发来的消息
+            else if (sockfd == m_wakeupfd[0])
+            {
+                if (!dealwithwakeup(timeout, stop))
+                    LOG_ERROR("sub reactor %d: %s", m_id, "dealwithwakeup failure");
+            }
+            // Reactor模式下，工作线程通知需要关闭的连接
+            else if (sockfd == m_completion.get_fd())
+            {
+                m_server->dealwithcompletion(&m_completion);
+            }
+            // 处理异常事件，服务器端关闭该http连接，移除对应的定时器
+            else if (m_events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                m_server->close_conn(sockfd);
+            }
+            else if (m_events[i].events & EPOLLIN)
+            {
+                m_server->dealwithread(sockfd, m_ring);
+            }
+            else if (m_events[i].events & EPOLLOUT)
+            {
+                m_server->dealwithwrite(sockfd, m_ring);
+            }
+        }
+
+        // io_uring引擎：一次系统调用提交本轮的全部读写操作
+        m_server->dealwithuring(m_ring);
+
+        // 与主循环相同，读写事件处理完后再处理定时任务
+        if (timeout)
+        {
+            m_timer_lst.tick();
+            timeout = false;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <list>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+
+#include "../lock/locker.h"
+#include "../timer/lst_timer.h"
+#include "completion_queue.h"
+#include "io_uring_engine.h"
+
+
+class WebServer;
+
+
+/*
+ * 从Reactor(sub reactor)：主Reactor + N个从Reactor 模式下的单个事件循环
+ * 每个从Reactor运行在独立线程上，拥有自己的epoll实例与定时器容器
+ * 主Reactor只负责accept，新连接通过dispatch交给某个从Reactor，之后该连接的读写事件、
+ * 超时处理都固定在这个从Reactor线程上完成，直到连接关闭
+ * SO_REUSEPORT分片模式下，每个从Reactor持有自己的监听套接字，直接在本线程accept，不经过主Reactor
+ * 连接表conn_table按文件描述符索引，每个从Reactor只会访问自己持有的那部分连接
+ */
+class sub_reactor
+{
+public:
+    sub_reactor(WebServer *server, int id, int close_log);
+    ~sub_reactor();
+
+    // 创建epoll实例、唤醒管道，并启动事件循环线程
+    // listenfd不为-1时，该从Reactor持有一个SO_REUSEPORT监听套接字，自己accept新连接
+    // cpu不小于0时事件循环线程绑定到该CPU
+    bool start(int listenfd = -1, int listen_trigmode = 0, int cpu = -1);
+    // 通知事件循环线程退出，并回收线程
+    void stop();
+    // 主Reactor调用：将新接受的连接交给该从Reactor
+    void dispatch(int connfd, const sockaddr_in &client_address);
+    // 主Reactor调用：定时器信号到达，通知从Reactor处理自己的定时器容器
+    void tick();
+
+    int get_epollfd() const
+    {
+        return m_epollfd;
+    }
+
+    sort_timer_lst *get_timer_lst()
+    {
+        return &m_timer_lst;
+    }
+
+    completion_queue *get_completion()
+    {
+        return &m_completion;
+    }
+
+private:
+    // 从Reactor线程函数，调用私有成员run
+    static void *worker(void *arg);
+    // 从Reactor事件循环
+    void run();
+    // 向唤醒管道写入一个消息字符
+    void wakeup(char msg);
+    // 处理唤醒管道上的消息
+    bool dealwithwakeup(bool &timeout, bool &stop);
+    // 将待注册队列中的新连接挂到本epoll实例上
+    void dealwithnewconn();
+
+private:
+    // 所属服务器，用于复用其读写、定时器处理逻辑
+    WebServer *m_server;
+    // 从Reactor编号
+    int m_id;
+    // 是否关闭日志
+    int m_close_log;
+    // 本事件循环独占的epoll实例
+    int m_epollfd;
+    // 本事件循环独占的SO_REUSEPORT监听套接字，-1表示由主Reactor分发连接
+    int m_listenfd;
+    // 唤醒管道：主Reactor写 m_wakeupfd[1]，从Reactor在epoll上监听 m_wakeupfd[0]
+    int m_wakeupfd[2];
+    // 事件循环线程
+    pthread_t m_thread;
+    bool m_running;
+    // 就绪事件数组
+    epoll_event *m_events;
+    // 主Reactor交付、等待注册的新连接
+    std::list<client_data> m_pending;
+    // 保护待注册队列的互斥锁
+    locker m_queuelocker;
+    // 本事件循环独占的定时器容器
+    sort_timer_lst m_timer_lst;
+    // Reactor模式下，工作线程向本事件循环回报需要关闭的连接
+    completion_queue m_completion;
+    // 本事件循环独占的io_uring实例，为NULL表示使用recv/writev
+    io_uring_engine *m_ring;
+};
@@ -0,0 +1,130 @@
+/*************************************************************
+*异步路由处理的完成句柄测试
+*http_async在工作线程处理完连接(arrive)与处理函数完成(complete)都到达之后，
+*才投递到事件循环的完成队列，且只投递一次，与两者的先后顺序、所在线程无关
+*需要关闭的连接与投递时的代数一起取出，事件循环据此跳过文件描述符已被复用的连接
+**************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <set>
+#include <vector>
+#include "test.h"
+#include "../http/http_handler.h"
+#include "../reactor/completion_queue.h"
+
+
+static int take_all(completion_queue &queue, std::list<http_async *> &asyncs)
+{
+    std::list<completion_close> closes;
+    queue.take(closes, asyncs);
+    return (int)asyncs.size();
+}
+
+
+// 工作线程先返回，异步处理后完成(cgi_register的顺序)
+static void test_complete_after_arrive()
+{
+    completion_queue queue;
+    http_async *async = new http_async(5, 7, &queue);
+    async->arrive();
+
+    std::list<http_async *> asyncs;
+    CHECK(take_all(queue, asyncs) == 0);
+
+    async->response().send_file("/log.html");
+    async->complete();
+    CHECK(take_all(queue, asyncs) == 1);
+    CHECK(asyncs.front() == async);
+    CHECK(async->get_sockfd() == 5);
+    CHECK(async->get_generation() == 7);
+    CHECK(strcmp(async->response().get_file(), "/log.html") == 0);
+    delete async;
+}
+
+
+// 处理函数返回之前已经完成，工作线程处理完连接后才投递
+static void test_complete_before_arrive()
+{
+    completion_queue queue;
+    http_async *async = new http_async(5, 8, &queue);
+    async->response().send(200, "OK", "text/plain", "done", 4);
+    async->complete();
+
+    std::list<http_async *> asyncs;
+    CHECK(take_all(queue, asyncs) == 0);
+
+    async->arrive();
+    CHECK(take_all(queue, asyncs) == 1);
+    CHECK(asyncs.front()->response().get_body() == "done");
+    delete async;
+}
+
+
+struct complete_args
+{
+    std::vector<http_async *> *asyncs;
+};
+
+
+static void *complete_all(void *arg)
+{
+    std::vector<http_async *> &asyncs = *((complete_args *)arg)->asyncs;
+    for (size_t i = 0; i < asyncs.size(); ++i)
+        asyncs[i]->complete();
+    return NULL;
+}
+
+
+// 另一个线程与工作线程同时到达，每个句柄恰好投递一次
+static void test_concurrent_arrive()
+{
+    const int count = 100000;
+    completion_queue queue;
+    std::vector<http_async *> asyncs;
+    for (int i = 0; i < count; ++i)
+        asyncs.push_back(new http_async(i, i, &queue));
+
+    complete_args args = {&asyncs};
+    pthread_t tid;
+    CHECK(pthread_create(&tid, NULL, complete_all, &args) == 0);
+    for (int i = 0; i < count; ++i)
+        asyncs[i]->arrive();
+    pthread_join(tid, NULL);
+
+    std::list<http_async *> posted;
+    CHECK(take_all(queue, posted) == count);
+    std::set<http_async *> unique(posted.begin(), posted.end());
+    CHECK((int)unique.size() == count);
+    for (int i = 0; i < count; ++i)
+        delete asyncs[i];
+}
+
+
+// 需要关闭的连接按投递的顺序取出，代数与投递时相同
+static void test_close_generation()
+{
+    completion_queue queue;
+    queue.post(5, 7);
+    queue.post(6, 9);
+
+    std::list<completion_close> closes;
+    std::list<http_async *> asyncs;
+    queue.take(closes, asyncs);
+    CHECK(closes.size() == 2 && asyncs.empty());
+    CHECK(closes.front().sockfd == 5 && closes.front().generation == 7);
+    CHECK(closes.back().sockfd == 6 && closes.back().generation == 9);
+
+    closes.clear();
+    queue.take(closes, asyncs);
+    CHECK(closes.empty());
+}
+
+
+int main()
+{
+    test_complete_after_arrive();
+    test_complete_before_arrive();
+    test_concurrent_arrive();
+    test_close_generation();
+    return TEST_RESULT();
+}
@@ -0,0 +1,159 @@
+/*************************************************************
+*分块传输编码请求体解码器测试
+*输入在任意位置截断分多次到达(包括块大小行的中间)、chunk-extension与trailer字段、
+*最后一块之后流水线中的下一个请求、格式错误
+**************************************************************/
+#include <string.h>
+#include <string>
+#include "test.h"
+#include "../http/http_chunked.h"
+
+
+// 模拟读缓冲区：输入每次到达step字节，解码出的数据就地写回缓冲区开头
+// 返回消耗的输入字节数，格式错误返回-1
+static int decode_in_place(const std::string &input, int step, std::string &body, std::string &rest)
+{
+    std::string buf = input;
+    chunked_decoder decoder;
+    int consumed = 0;
+    int written = 0;
+    int len = buf.size();
+    while (consumed < len && !decoder.done())
+    {
+        int n = len - consumed;
+        if (n > step)
+            n = step;
+        int out_len = 0;
+        int ret = decoder.decode(&buf[consumed], n, &buf[written], out_len);
+        if (ret < 0)
+            return -1;
+        consumed += ret;
+        written += out_len;
+        // 没有到达结尾时，一次到达的输入应该全部被消耗
+        if (!decoder.done() && ret != n)
+            return -1;
+    }
+    if (!decoder.done())
+        return -1;
+    body.assign(buf.data(), written);
+    rest.assign(buf.data() + consumed, len - consumed);
+    return consumed;
+}
+
+
+// 以各种到达方式(一次全部到达、逐字节到达、在每个位置截断为两段)解码，结果都应该相同
+static void check_decode(const std::string &input, const std::string &expect, const std::string &expect_rest)
+{
+    std::string body, rest;
+    for (int step = 1; step <= (int)input.size(); ++step)
+    {
+        int ret = decode_in_place(input, step, body, rest);
+        CHECK(ret == (int)(input.size() - expect_rest.size()));
+        CHECK(body == expect);
+        CHECK(rest == expect_rest);
+        if (ret < 0 || body != expect || rest != expect_rest)
+        {
+            fprintf(stderr, "  step %d\n", step);
+            return;
+        }
+    }
+
+    // 在每个位置截断为两段
+    for (size_t cut = 0; cut <= input.size(); ++cut)
+    {
+        std::string buf = input;
+        chunked_decoder decoder;
+        int out1 = 0, out2 = 0;
+        int n1 = decoder.decode(&buf[0], cut, &buf[0], out1);
+        CHECK(n1 >= 0);
+        if (n1 < 0)
+            return;
+        int n2 = decoder.decode(&buf[n1], buf.size() - n1, &buf[out1], out2);
+        CHECK(n2 >= 0);
+        CHECK(decoder.done());
+        CHECK(std::string(buf.data(), out1 + out2) == expect);
+        CHECK(buf.substr(n1 + n2) == expect_rest);
+    }
+}
+
+
+static void test_basic()
+{
+    check_decode("4\r\nWiki\r\n5\r\npedia\r\n0\r\n\r\n", "Wikipedia", "");
+}
+
+
+// 多位十六进制块大小，截断在块大小行中间时数字要累加到下一段
+static void test_split_size_line()
+{
+    std::string data(0x1a2, 'x');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = 'a' + i % 26;
+    std::string input = "1A2\r\n" + data + "\r\n10\r\n0123456789abcdef\r\n0\r\n\r\n";
+    check_decode(input, data + "0123456789abcdef", "");
+}
+
+
+static void test_extension()
+{
+    check_decode("5;name=value\r\nhello\r\n6;a=\"b;c\"\r\n world\r\n0;last\r\n\r\n", "hello world", "");
+}
+
+
+static void test_trailer()
+{
+    check_decode("3\r\nabc\r\n0\r\nX-Checksum: 123\r\nX-Other: a\r\n\r\n", "abc", "");
+}
+
+
+// 最后一块之后是流水线中的下一个请求，不能被消耗，也不能被就地写回的数据覆盖
+static void test_pipelined()
+{
+    const std::string next = "GET /index.html HTTP/1.1\r\nHost: x\r\n\r\n";
+    check_decode("3\r\nabc\r\n0\r\n\r\n" + next, "abc", next);
+    check_decode("3\r\nabc\r\n0\r\nX-Trailer: 1\r\n\r\n" + next, "abc", next);
+    // 下一个请求的请求体也是分块的
+    check_decode("1\r\na\r\n0\r\n\r\n" + std::string("POST / HTTP/1.1\r\n\r\n1\r\nb\r\n0\r\n\r\n"), "a",
+                 "POST / HTTP/1.1\r\n\r\n1\r\nb\r\n0\r\n\r\n");
+}
+
+
+// 只有最后一块的空请求体
+static void test_empty()
+{
+    check_decode("0\r\n\r\n", "", "");
+}
+
+
+static int decode_error(const std::string &input)
+{
+    std::string body, rest;
+    return decode_in_place(input, input.size(), body, rest);
+}
+
+
+static void test_malformed()
+{
+    // 缺少块大小
+    CHECK(decode_error("\r\nabc\r\n0\r\n\r\n") == -1);
+    // 块数据之后不是\r\n
+    CHECK(decode_error("3\r\nabcX\r\n0\r\n\r\n") == -1);
+    CHECK(decode_error("3\r\nabc\rX0\r\n\r\n") == -1);
+    // 块大小超过15个十六进制位
+    CHECK(decode_error("1000000000000000\r\n") == -1);
+    // 结尾空行的\r之后不是\n
+    CHECK(decode_error("0\r\n\rX") == -1);
+}
+
+
+int main()
+{
+    test_basic();
+    test_split_size_line();
+    test_extension();
+    test_trailer();
+    test_pipelined();
+    test_empty();
+    test_malformed();
+    return TEST_RESULT();
+}
@@ -0,0 +1,211 @@
+/*************************************************************
+*不经过事件循环与线程池直接驱动http_conn：连接的两端是一对UNIX域套接字，
+*客户端一端由测试写入请求、读取响应，服务器一端交给http_conn
+*pump按http_conn注册的事件依次调用read_once/process/write，与Proactor模式下事件循环与工作线程的调用顺序相同
+*单元测试与基准测试共用
+**************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "../http/http_conn.h"
+
+
+// 解析出的一个响应
+struct harness_response
+{
+    int status;
+    std::string headers;
+    std::string body;
+};
+
+
+/*
+ * @func: 创建临时的网站根目录，写入files中的文件(文件名与内容交替)，返回目录路径
+ *        初始化http_conn依赖的缓冲区池、文件缓存与路由表，只调用一次
+ *        upload_max_mb大于0时登记上传接口
+ */
+inline std::string harness_setup(const std::vector<std::string> &files, int upload_max_mb = 0)
+{
+    char dir[] = "/tmp/http_test_XXXXXX";
+    if (!mkdtemp(dir))
+        abort();
+    for (size_t i = 0; i + 1 < files.size(); i += 2)
+    {
+        std::string path = std::string(dir) + files[i];
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1 || write(fd, files[i + 1].data(), files[i + 1].size()) != (ssize_t)files[i + 1].size())
+            abort();
+        close(fd);
+    }
+    buffer_pool::get_instance()->init(64 * 1024);
+    file_cache::get_instance()->init(8 * 1024 * 1024, 1);
+    http_conn::init_routes(upload_max_mb);
+    return dir;
+}
+
+
+/*
+ * @func: 删除harness_setup创建的网站根目录
+ */
+inline void harness_cleanup(const std::string &root, const std::vector<std::string> &files)
+{
+    for (size_t i = 0; i + 1 < files.size(); i += 2)
+        unlink((root + files[i]).c_str());
+    rmdir(root.c_str());
+}
+
+
+class conn_harness
+{
+public:
+    explicit conn_harness(const std::string &root) : m_root(root), m_closed(false)
+    {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, m_fds) == -1)
+            abort();
+        m_epollfd = epoll_create1(EPOLL_CLOEXEC);
+        fcntl(m_fds[1], F_SETFL, fcntl(m_fds[1], F_GETFL) | O_NONBLOCK);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        // LT模式，关闭日志
+        m_conn.init(m_fds[0], addr, m_epollfd, &m_root[0], 0, 1);
+        m_conn.m_completion = &m_queue;
+    }
+
+    ~conn_harness()
+    {
+        // 与连接关闭时一样回收：释放上传与分块响应、归还资源文件与缓冲区，关闭服务器一端
+        m_conn.release();
+        close(m_fds[1]);
+        close(m_epollfd);
+    }
+
+    // 客户端发送数据
+    void send(const std::string &data)
+    {
+        size_t off = 0;
+        while (off < data.size())
+        {
+            ssize_t n = ::write(m_fds[1], data.data() + off, data.size() - off);
+            if (n <= 0)
+                abort();
+            off += n;
+        }
+    }
+
+    /*
+     * @func: 按http_conn注册的事件处理连接，直到没有就绪的事件
+     *        读失败、写失败(短连接发送完毕)或工作线程通知关闭时标记连接已关闭
+     */
+    void pump()
+    {
+        epoll_event event;
+        while (!m_closed && epoll_wait(m_epollfd, &event, 1, 0) == 1)
+        {
+            if (event.events & EPOLLIN)
+            {
+                if (!m_conn.read_once())
+                {
+                    m_closed = true;
+                    break;
+                }
+                process();
+            }
+            else if (event.events & EPOLLOUT)
+            {
+                if (!m_conn.write())
+                {
+                    m_closed = true;
+                    break;
+                }
+                if (m_conn.take_pipelined())
+                    process();
+            }
+        }
+    }
+
+    // 客户端读取目前收到的全部数据
+    std::string recv()
+    {
+        std::string data;
+        char buf[16384];
+        ssize_t n;
+        while ((n = ::read(m_fds[1], buf, sizeof(buf))) > 0)
+            data.append(buf, n);
+        return data;
+    }
+
+    // 发送请求，处理后返回收到的全部响应
+    std::string request(const std::string &data)
+    {
+        send(data);
+        pump();
+        return recv();
+    }
+
+    bool closed() const
+    {
+        return m_closed;
+    }
+
+    http_conn &conn()
+    {
+        return m_conn;
+    }
+
+private:
+    void process()
+    {
+        m_conn.mysql = NULL;
+        m_conn.process();
+        std::list<completion_close> closes;
+        std::list<http_async *> asyncs;
+        m_queue.take(closes, asyncs);
+        if (!closes.empty())
+            m_closed = true;
+    }
+
+private:
+    std::string m_root;
+    int m_fds[2];
+    int m_epollfd;
+    bool m_closed;
+    completion_queue m_queue;
+    http_conn m_conn;
+};
+
+
+/*
+ * @func: 将收到的数据拆分为响应，响应体按Content-Length截取
+ * @return: 数据不完整或格式错误时返回false
+ */
+inline bool parse_responses(const std::string &data, std::vector<harness_response> &out)
+{
+    size_t pos = 0;
+    while (pos < data.size())
+    {
+        size_t end = data.find("\r\n\r\n", pos);
+        if (end == std::string::npos || data.compare(pos, 9, "HTTP/1.1 ") != 0)
+            return false;
+        harness_response resp;
+        resp.status = atoi(data.c_str() + pos + 9);
+        resp.headers = data.substr(pos, end + 4 - pos);
+        size_t length = 0;
+        size_t field = resp.headers.find("Content-Length:");
+        if (field != std::string::npos)
+            length = strtoul(resp.headers.c_str() + field + 15, NULL, 10);
+        pos = end + 4;
+        if (pos + length > data.size())
+            return false;
+        resp.body = data.substr(pos, length);
+        pos += length;
+        out.push_back(resp);
+    }
+    return true;
+}
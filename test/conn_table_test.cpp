@@ -0,0 +1,195 @@
+/*************************************************************
+*连接表的回收测试
+*线程池分派任务时工作线程持有连接(hold)，事件循环在此期间关闭连接(release)只标记关闭，
+*连接对象不放回空闲链表、文件描述符不关闭，最后一个工作线程交回(unhold)时才回收
+*没有工作线程持有时release立即回收，无论交回与关闭的先后顺序，每个连接恰好回收一次
+**************************************************************/
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "test.h"
+#include "../http/conn_table.h"
+
+
+static char g_root[] = "/tmp";
+static int g_epollfd;
+
+
+// 新连接：一对UNIX域套接字，服务器一端登记到连接表
+static conn_slot *open_conn(int &peer)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+        return NULL;
+    peer = fds[1];
+    conn_slot *slot = conn_table::get_instance()->acquire(fds[0]);
+    if (!slot)
+        return NULL;
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    slot->conn.init(fds[0], addr, g_epollfd, g_root, 0, 1);
+    return slot;
+}
+
+
+static bool fd_open(int fd)
+{
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+
+// 没有工作线程持有时，关闭连接立即回收
+static void test_release_idle()
+{
+    int peer;
+    conn_slot *slot = open_conn(peer);
+    CHECK(slot);
+    int fd = slot->conn.get_sockfd();
+    int users = http_conn::m_user_count;
+
+    conn_table::get_instance()->release(fd);
+    CHECK(conn_table::get_instance()->get(fd) == NULL);
+    CHECK(!fd_open(fd));
+    CHECK(http_conn::m_user_count == users - 1);
+
+    // 空闲链表后进先出，下一个连接复用刚回收的连接对象
+    int peer2;
+    CHECK(open_conn(peer2) == slot);
+    conn_table::get_instance()->release(slot->conn.get_sockfd());
+    close(peer);
+    close(peer2);
+}
+
+
+// 工作线程持有期间关闭连接：连接对象与文件描述符保留到工作线程交回
+static void test_release_held()
+{
+    int peer;
+    conn_slot *slot = open_conn(peer);
+    CHECK(slot);
+    int fd = slot->conn.get_sockfd();
+    int users = http_conn::m_user_count;
+
+    slot->conn.hold();
+    conn_table::get_instance()->release(fd);
+    CHECK(conn_table::get_instance()->get(fd) == NULL);
+    CHECK(fd_open(fd));
+    CHECK(slot->conn.get_sockfd() == fd);
+    CHECK(http_conn::m_user_count == users);
+
+    // 工作线程还没有交回，新连接不能拿到同一个连接对象
+    int peer2;
+    conn_slot *other = open_conn(peer2);
+    CHECK(other && other != slot);
+
+    slot->conn.unhold();
+    CHECK(!fd_open(fd));
+    CHECK(http_conn::m_user_count == users);
+
+    conn_table::get_instance()->release(other->conn.get_sockfd());
+    close(peer);
+    close(peer2);
+}
+
+
+// 工作线程重新注册事件后、交回之前，事件循环又把连接分派给另一个工作线程，两个都交回后才回收
+static void test_release_two_holders()
+{
+    int peer;
+    conn_slot *slot = open_conn(peer);
+    CHECK(slot);
+    int fd = slot->conn.get_sockfd();
+
+    slot->conn.hold();
+    slot->conn.hold();
+    conn_table::get_instance()->release(fd);
+    slot->conn.unhold();
+    CHECK(fd_open(fd));
+    slot->conn.unhold();
+    CHECK(!fd_open(fd));
+    close(peer);
+}
+
+
+// 工作线程先交回，之后关闭连接时立即回收
+static void test_unhold_then_release()
+{
+    int peer;
+    conn_slot *slot = open_conn(peer);
+    CHECK(slot);
+    int fd = slot->conn.get_sockfd();
+
+    slot->conn.hold();
+    slot->conn.unhold();
+    CHECK(fd_open(fd));
+    conn_table::get_instance()->release(fd);
+    CHECK(!fd_open(fd));
+    close(peer);
+}
+
+
+struct unhold_args
+{
+    conn_slot *slot;
+    pthread_barrier_t *barrier;
+};
+
+
+static void *unhold_worker(void *arg)
+{
+    unhold_args *args = (unhold_args *)arg;
+    pthread_barrier_wait(args->barrier);
+    args->slot->conn.unhold();
+    return NULL;
+}
+
+
+// 工作线程交回与事件循环关闭同时发生，连接恰好回收一次
+static void test_concurrent_release()
+{
+    const int rounds = 20000;
+    int users = http_conn::m_user_count;
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, 2);
+    for (int i = 0; i < rounds; ++i)
+    {
+        int peer;
+        conn_slot *slot = open_conn(peer);
+        if (!slot)
+        {
+            CHECK(slot);
+            break;
+        }
+        int fd = slot->conn.get_sockfd();
+        slot->conn.hold();
+
+        unhold_args args = {slot, &barrier};
+        pthread_t tid;
+        pthread_create(&tid, NULL, unhold_worker, &args);
+        pthread_barrier_wait(&barrier);
+        conn_table::get_instance()->release(fd);
+        pthread_join(tid, NULL);
+
+        CHECK(!fd_open(fd));
+        close(peer);
+    }
+    pthread_barrier_destroy(&barrier);
+    CHECK(http_conn::m_user_count == users);
+}
+
+
+int main()
+{
+    conn_table::get_instance()->init(65536);
+    g_epollfd = epoll_create1(EPOLL_CLOEXEC);
+
+    test_release_idle();
+    test_release_held();
+    test_release_two_holders();
+    test_unhold_then_release();
+    test_concurrent_release();
+
+    close(g_epollfd);
+    return TEST_RESULT();
+}
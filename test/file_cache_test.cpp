@@ -0,0 +1,193 @@
+/*************************************************************
+*静态文件缓存测试
+*同一路径命中同一个缓存对象；完整响应报文只发布一次，之后不加锁读取到的内容完整
+*多个线程同时获取、生成响应报文并释放，内存预算很小、不断淘汰时，连接持有的文件仍然有效
+*文件被替换后由inotify移出缓存，之后获取到新的内容
+**************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string>
+#include "test.h"
+#include "../cache/file_cache.h"
+
+
+// 文件数量与大小：总大小超过内存预算，不断触发淘汰
+static const int FILE_NUM = 64;
+static const int FILE_SIZE = 4096;
+static const int THREAD_NUM = 8;
+static const int ROUNDS = 2000;
+
+static char g_dir[] = "/tmp/file_cache_testXXXXXX";
+
+
+static std::string file_path(int i)
+{
+    char name[32];
+    snprintf(name, sizeof name, "/f%d.html", i);
+    return std::string(g_dir) + name;
+}
+
+
+static std::string file_content(int i, int size)
+{
+    std::string content(size, (char)('a' + i % 26));
+    snprintf(&content[0], size, "%d", i);
+    return content;
+}
+
+
+static bool write_file(const std::string &path, const std::string &content)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    bool ok = write(fd, content.data(), content.size()) == (ssize_t)content.size();
+    close(fd);
+    return ok;
+}
+
+
+// 完整响应报文的头部，包含路径与长短连接，不同文件、不同连接类型互不相同
+static std::string header_of(const std::string &path, bool linger)
+{
+    return "HTTP/1.1 200 OK\r\nX-Path:" + path + (linger ? "\r\nkeep-alive\r\n\r\n" : "\r\nclose\r\n\r\n");
+}
+
+
+static bool response_ok(file_entry *entry, bool linger, const char *buf, int len)
+{
+    std::string expect = header_of(entry->path, linger);
+    expect.append(entry->addr, entry->st.st_size);
+    return len == (int)expect.size() && memcmp(buf, expect.data(), len) == 0;
+}
+
+
+static void test_hit()
+{
+    file_cache *cache = file_cache::get_instance();
+    std::string path = file_path(0);
+    file_entry *a = cache->acquire(path.c_str());
+    file_entry *b = cache->acquire(path.c_str());
+    CHECK(a && a == b);
+    CHECK(a->addr && a->st.st_size == FILE_SIZE);
+
+    const char *buf;
+    int len;
+    CHECK(!cache->get_response(a, true, buf, len));
+    std::string header = header_of(path, true);
+    cache->set_response(a, true, header.data(), header.size());
+    CHECK(cache->get_response(a, true, buf, len) && response_ok(a, true, buf, len));
+    // 已经生成的响应报文不再替换，之前取得的指针一直有效
+    const char *first = buf;
+    cache->set_response(b, true, "X", 1);
+    CHECK(cache->get_response(b, true, buf, len) && buf == first && response_ok(b, true, buf, len));
+    // 长短连接各一份
+    CHECK(!cache->get_response(a, false, buf, len));
+
+    cache->release(a);
+    cache->release(b);
+}
+
+
+static void *worker(void *arg)
+{
+    file_cache *cache = file_cache::get_instance();
+    unsigned seed = (unsigned)(long)arg;
+    long *failures = new long(0);
+    for (int r = 0; r < ROUNDS; ++r)
+    {
+        int i = rand_r(&seed) % FILE_NUM;
+        bool linger = rand_r(&seed) & 1;
+        std::string path = file_path(i);
+        file_entry *entry = cache->acquire(path.c_str());
+        if (!entry || entry->st.st_size != FILE_SIZE || memcmp(entry->addr, file_content(i, FILE_SIZE).data(), FILE_SIZE))
+        {
+            ++*failures;
+            if (entry)
+                cache->release(entry);
+            continue;
+        }
+        const char *buf;
+        int len;
+        if (cache->get_response(entry, linger, buf, len))
+        {
+            if (!response_ok(entry, linger, buf, len))
+                ++*failures;
+        }
+        else
+        {
+            std::string header = header_of(path, linger);
+            cache->set_response(entry, linger, header.data(), header.size());
+        }
+        cache->release(entry);
+    }
+    return failures;
+}
+
+
+// 多个线程同时访问，内存预算只够缓存一部分文件，淘汰与获取、生成响应报文、释放同时发生
+static void test_concurrent()
+{
+    pthread_t tids[THREAD_NUM];
+    for (long t = 0; t < THREAD_NUM; ++t)
+        CHECK(pthread_create(&tids[t], NULL, worker, (void *)(t + 1)) == 0);
+    long failures = 0;
+    for (int t = 0; t < THREAD_NUM; ++t)
+    {
+        void *ret;
+        pthread_join(tids[t], &ret);
+        failures += *(long *)ret;
+        delete (long *)ret;
+    }
+    CHECK(failures == 0);
+
+    long hits, misses;
+    file_cache::get_instance()->get_response_stat(hits, misses);
+    CHECK(hits > 0 && misses > 0);
+}
+
+
+// 文件被替换(写入临时文件后rename)，inotify通知后移出缓存，正在使用旧文件的连接不受影响
+static void test_invalidate()
+{
+    file_cache *cache = file_cache::get_instance();
+    std::string path = file_path(1);
+    file_entry *old_entry = cache->acquire(path.c_str());
+    CHECK(old_entry && old_entry->st.st_size == FILE_SIZE);
+
+    std::string content = file_content(1, FILE_SIZE / 2);
+    std::string tmp = std::string(g_dir) + "/.tmp";
+    CHECK(write_file(tmp, content) && rename(tmp.c_str(), path.c_str()) == 0);
+    CHECK(cache->get_inotify_fd() != -1);
+    cache->dealwithinotify();
+
+    file_entry *entry = cache->acquire(path.c_str());
+    CHECK(entry && entry != old_entry && entry->st.st_size == FILE_SIZE / 2);
+    CHECK(memcmp(old_entry->addr, file_content(1, FILE_SIZE).data(), FILE_SIZE) == 0);
+    cache->release(old_entry);
+    cache->release(entry);
+}
+
+
+int main()
+{
+    if (!mkdtemp(g_dir))
+        return 1;
+    for (int i = 0; i < FILE_NUM; ++i)
+        write_file(file_path(i), file_content(i, FILE_SIZE));
+    // 每个分片16KB：只能缓存一部分文件与响应报文
+    file_cache::get_instance()->init(FILE_CACHE_SHARDS * 16 * 1024, 1);
+
+    test_hit();
+    test_concurrent();
+    test_invalidate();
+
+    for (int i = 0; i < FILE_NUM; ++i)
+        unlink(file_path(i).c_str());
+    rmdir(g_dir);
+    return TEST_RESULT();
+}
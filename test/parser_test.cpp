@@ -0,0 +1,186 @@
+/*************************************************************
+*HTTP请求解析测试
+*解析器不再向读缓冲区写入\0，请求行、头部字段与请求体都以偏移与长度记录，缓冲区也不再清零
+*这里检查：流水线中后续请求的第一个字符不被覆盖、请求在任意位置截断、头部字段的值以长度结束、
+*复用的缓冲区中残留的数据不影响下一个请求、资源路径过长时截断
+**************************************************************/
+#include "test.h"
+#include "conn_harness.h"
+
+
+static const char *const FILES[] = {
+    "/judge.html", "JUDGE",
+    "/register.html", "REGISTER",
+    "/a.txt", "0123456789",
+};
+
+static std::string g_root;
+
+
+static std::vector<harness_response> request(const std::string &data, bool *closed = NULL)
+{
+    conn_harness harness(g_root);
+    std::vector<harness_response> responses;
+    CHECK(parse_responses(harness.request(data), responses));
+    if (closed)
+        *closed = harness.closed();
+    return responses;
+}
+
+
+static std::string get(const char *path, const char *headers = "")
+{
+    return std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n" + headers + "\r\n";
+}
+
+
+static void test_simple()
+{
+    bool closed = true;
+    std::vector<harness_response> r = request(get("/a.txt"), &closed);
+    CHECK(r.size() == 1);
+    CHECK(r.size() == 1 && r[0].status == 200 && r[0].body == "0123456789");
+    CHECK(!closed);
+}
+
+
+// 一次到达多个请求，响应按顺序返回
+static void test_pipelined()
+{
+    std::vector<harness_response> r = request(get("/a.txt") + get("/0") + get("/"));
+    CHECK(r.size() == 3);
+    if (r.size() != 3)
+        return;
+    CHECK(r[0].body == "0123456789");
+    CHECK(r[1].body == "REGISTER");
+    CHECK(r[2].body == "JUDGE");
+}
+
+
+// POST请求体之后紧跟下一个请求，请求体按Content-Length结束
+static void test_body_then_pipelined()
+{
+    std::string post = "POST /0 HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\nContent-Length: 5\r\n\r\nhello";
+    std::vector<harness_response> r = request(post + get("/a.txt"));
+    CHECK(r.size() == 2);
+    if (r.size() != 2)
+        return;
+    CHECK(r[0].body == "REGISTER");
+    CHECK(r[1].body == "0123456789");
+}
+
+
+// 请求逐字节到达，每到达一个字节处理一次
+static void test_byte_by_byte()
+{
+    std::string data = get("/a.txt", "Range: bytes=2-5\r\n") + get("/");
+    conn_harness harness(g_root);
+    std::string received;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        harness.send(data.substr(i, 1));
+        harness.pump();
+        received += harness.recv();
+    }
+    std::vector<harness_response> r;
+    CHECK(parse_responses(received, r));
+    CHECK(r.size() == 2);
+    if (r.size() != 2)
+        return;
+    CHECK(r[0].status == 206 && r[0].body == "2345");
+    CHECK(r[1].status == 200 && r[1].body == "JUDGE");
+}
+
+
+// 头部字段名不区分大小写，值之前的空白被跳过，值在\r\n处结束
+static void test_header_values()
+{
+    bool closed = true;
+    std::vector<harness_response> r =
+        request("GET /a.txt HTTP/1.1\r\nhost: localhost\r\nconnection:   Keep-Alive\r\nRANGE: bytes=9-\r\n\r\n", &closed);
+    CHECK(r.size() == 1 && r[0].status == 206 && r[0].body == "9");
+    CHECK(!closed);
+}
+
+
+// 查询字符串与absolute-form不属于资源路径
+static void test_request_target()
+{
+    std::vector<harness_response> r = request(get("/a.txt?x=1&y=2") + get("http://localhost/a.txt"));
+    CHECK(r.size() == 2);
+    if (r.size() != 2)
+        return;
+    CHECK(r[0].status == 200 && r[0].body == "0123456789");
+    CHECK(r[1].status == 200 && r[1].body == "0123456789");
+}
+
+
+// 同一连接上较短的请求复用缓冲区，上一个请求残留的数据不能被当作本请求的一部分
+static void test_reused_buffer()
+{
+    conn_harness harness(g_root);
+    std::string received = harness.request(get("/register.html", "X-Padding: aaaaaaaaaaaaaaaaaaaaaaaaaaaa\r\n"));
+    received += harness.request("GET /a.txt HTTP/1.1\r\nConnection: keep-alive\r\n\r\n");
+    std::vector<harness_response> r;
+    CHECK(parse_responses(received, r));
+    CHECK(r.size() == 2);
+    if (r.size() != 2)
+        return;
+    CHECK(r[0].body == "REGISTER");
+    CHECK(r[1].status == 200 && r[1].body == "0123456789");
+}
+
+
+// 资源路径超过m_real_file的长度时截断，不越界；截断后的文件不存在，连接被关闭
+static void test_long_path()
+{
+    std::string path = "/" + std::string(http_conn::FILENAME_LEN * 2, 'b');
+    bool closed = false;
+    std::vector<harness_response> r = request(get(path.c_str()), &closed);
+    CHECK(r.empty());
+    CHECK(closed);
+}
+
+
+// Connection: close，响应后关闭
+static void test_short_connection()
+{
+    bool closed = false;
+    std::vector<harness_response> r = request("GET /a.txt HTTP/1.1\r\nConnection: close\r\n\r\n", &closed);
+    CHECK(r.size() == 1 && r[0].body == "0123456789");
+    CHECK(closed);
+}
+
+
+// 请求行格式错误(没有资源路径、不支持的请求方法或协议版本)，回复错误后关闭
+static void test_bad_request()
+{
+    const char *const requests[] = {"GARBAGE\r\n\r\n", "DELETE /a.txt HTTP/1.1\r\n\r\n",
+                                    "GET /a.txt HTTP/1.0\r\n\r\n", "GET a.txt HTTP/1.1\r\n\r\n"};
+    for (size_t i = 0; i < sizeof(requests) / sizeof(requests[0]); ++i)
+    {
+        bool closed = false;
+        std::vector<harness_response> r = request(requests[i], &closed);
+        CHECK(r.size() == 1 && r[0].status >= 400);
+        CHECK(closed);
+    }
+}
+
+
+int main()
+{
+    std::vector<std::string> files(FILES, FILES + sizeof(FILES) / sizeof(FILES[0]));
+    g_root = harness_setup(files);
+    test_simple();
+    test_pipelined();
+    test_body_then_pipelined();
+    test_byte_by_byte();
+    test_header_values();
+    test_request_target();
+    test_reused_buffer();
+    test_long_path();
+    test_short_connection();
+    test_bad_request();
+    harness_cleanup(g_root, files);
+    return TEST_RESULT();
+}
@@ -0,0 +1,191 @@
+/*************************************************************
+*请求报文扫描测试
+*scan_line_end的SIMD实现(SSE2/AVX2)与逐字节实现的结果必须一致：
+*\r或\n位于一组的任意位置、恰好在组的边界上、在不足一组的剩余字节中、不存在，
+*起点不对齐，以及高位为1的字节(有符号比较容易出错)
+*查找范围紧贴不可访问的内存页时，不能读取范围之外的字节
+*lookup_header对需要处理的字段名忽略大小写，其他字段名(包括只差一个字符的)都是HEADER_UNKNOWN
+**************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <string>
+#include "test.h"
+#include "../http/http_scan.h"
+
+
+static const char *const IMPL_NAMES[SCAN_IMPL_NUM] = {"scalar", "sse2", "avx2"};
+
+
+// 参考实现
+static int reference(const char *buf, int begin, int end)
+{
+    while (begin < end && buf[begin] != '\r' && buf[begin] != '\n')
+        ++begin;
+    return begin;
+}
+
+
+// 各实现与参考实现比较，不一致时输出实现与位置
+static void check_all(const char *buf, int begin, int end)
+{
+    int expect = reference(buf, begin, end);
+    CHECK(scan_line_end(buf, begin, end) == expect);
+    for (int impl = 0; impl < SCAN_IMPL_NUM; ++impl)
+    {
+        if (!scan_impl_supported((SCAN_IMPL)impl))
+            continue;
+        int got = scan_line_end_impl((SCAN_IMPL)impl, buf, begin, end);
+        if (got != expect)
+        {
+            fprintf(stderr, "%s: begin %d end %d expect %d got %d\n", IMPL_NAMES[impl], begin, end, expect, got);
+            ++g_failures;
+        }
+    }
+}
+
+
+// 在每个位置放一个\r或\n，每种起点与终点
+static void test_every_position()
+{
+    const int size = 100;
+    char buf[size];
+    const char targets[] = {'\r', '\n'};
+    for (int t = 0; t < 2; ++t)
+    {
+        for (int pos = -1; pos < size; ++pos)
+        {
+            memset(buf, 'a', size);
+            if (pos >= 0)
+                buf[pos] = targets[t];
+            for (int begin = 0; begin <= size; ++begin)
+                for (int end = begin; end <= size; ++end)
+                    check_all(buf, begin, end);
+        }
+    }
+}
+
+
+// 高位为1的字节，与\r(0x0d)、\n(0x0a)只差最高位
+static void test_high_bytes()
+{
+    char buf[64];
+    for (int i = 0; i < 64; ++i)
+        buf[i] = (char)(i % 2 ? 0x8d : 0x8a);
+    check_all(buf, 0, 64);
+    buf[40] = '\n';
+    check_all(buf, 0, 64);
+    check_all(buf, 3, 41);
+    check_all(buf, 3, 40);
+}
+
+
+// 随机内容，\r与\n较少出现
+static void test_random()
+{
+    srand(1);
+    char buf[300];
+    for (int round = 0; round < 20000; ++round)
+    {
+        for (int i = 0; i < (int)sizeof(buf); ++i)
+        {
+            int r = rand() % 512;
+            buf[i] = r == 0 ? '\r' : r == 1 ? '\n' : (char)(r & 0xff);
+        }
+        int begin = rand() % sizeof(buf);
+        int end = begin + rand() % (sizeof(buf) - begin + 1);
+        check_all(buf, begin, end);
+    }
+}
+
+
+// 查找范围的结尾紧贴不可访问的内存页，读取范围之外的字节会导致段错误
+static void test_page_boundary()
+{
+    long page = sysconf(_SC_PAGESIZE);
+    char *mem = (char *)mmap(NULL, page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(mem != MAP_FAILED);
+    if (mem == MAP_FAILED)
+        return;
+    CHECK(mprotect(mem + page, page, PROT_NONE) == 0);
+    memset(mem, 'a', page);
+    for (int len = 0; len <= 70; ++len)
+    {
+        int begin = page - len;
+        check_all(mem, begin, page);
+        if (len > 0)
+        {
+            mem[page - 1] = '\n';
+            check_all(mem, begin, page);
+            mem[page - 1] = 'a';
+        }
+    }
+    munmap(mem, page * 2);
+}
+
+
+static void test_lookup_header()
+{
+    struct
+    {
+        const char *name;
+        HTTP_HEADER id;
+    } headers[] = {
+        {"Host", HEADER_HOST},
+        {"Range", HEADER_RANGE},
+        {"If-Range", HEADER_IF_RANGE},
+        {"Connection", HEADER_CONNECTION},
+        {"Content-Length", HEADER_CONTENT_LENGTH},
+        {"If-None-Match", HEADER_IF_NONE_MATCH},
+        {"Accept-Encoding", HEADER_ACCEPT_ENCODING},
+        {"If-Modified-Since", HEADER_IF_MODIFIED_SINCE},
+        {"Transfer-Encoding", HEADER_TRANSFER_ENCODING},
+    };
+    for (size_t i = 0; i < sizeof(headers) / sizeof(headers[0]); ++i)
+    {
+        std::string name = headers[i].name;
+        int len = name.size();
+        CHECK(lookup_header(name.data(), len) == headers[i].id);
+
+        std::string lower = name, upper = name;
+        for (int j = 0; j < len; ++j)
+        {
+            lower[j] = tolower(lower[j]);
+            upper[j] = toupper(upper[j]);
+        }
+        CHECK(lookup_header(lower.data(), len) == headers[i].id);
+        CHECK(lookup_header(upper.data(), len) == headers[i].id);
+
+        // 前缀与只差一个字符的字段名
+        CHECK(lookup_header(name.data(), len - 1) == HEADER_UNKNOWN);
+        for (int j = 0; j < len; ++j)
+        {
+            std::string miss = name;
+            miss[j] = miss[j] == 'x' ? 'y' : 'x';
+            CHECK(lookup_header(miss.data(), len) == HEADER_UNKNOWN);
+        }
+        // 名字后面紧跟的字符不属于字段名
+        std::string longer = name + ": value";
+        CHECK(lookup_header(longer.data(), len) == headers[i].id);
+        CHECK(lookup_header(longer.data(), len + 1) == HEADER_UNKNOWN);
+    }
+
+    const char *const unknown[] = {"", "User-Agent", "Accept", "Cookie", "Referer", "Content-Type", "Hosts"};
+    for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); ++i)
+        CHECK(lookup_header(unknown[i], strlen(unknown[i])) == HEADER_UNKNOWN);
+}
+
+
+int main()
+{
+    for (int impl = 0; impl < SCAN_IMPL_NUM; ++impl)
+        printf("%s: %s\n", IMPL_NAMES[impl], scan_impl_supported((SCAN_IMPL)impl) ? "tested" : "not supported");
+    test_every_position();
+    test_high_bytes();
+    test_random();
+    test_page_boundary();
+    test_lookup_header();
+    return TEST_RESULT();
+}
@@ -0,0 +1,22 @@
+/*************************************************************
+*单元测试使用的检查宏
+*检查失败时输出文件名、行号与表达式并继续执行，main返回失败的数量，ctest据此判断测试是否通过
+**************************************************************/
+#pragma once
+#include <stdio.h>
+
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                  \
+    do                                                                               \
+    {                                                                                \
+        if (!(cond))                                                                 \
+        {                                                                            \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++g_failures;                                                            \
+        }                                                                            \
+    } while (0)
+
+// 在main的最后返回
+#define TEST_RESULT() (g_failures ? (fprintf(stderr, "%d check(s) failed\n", g_failures), 1) : 0)
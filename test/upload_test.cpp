@@ -0,0 +1,158 @@
+/*************************************************************
+*上传接口测试
+*PUT /upload/文件名将请求体写入上传目录，完成后回复201，同名文件已经存在时回复409
+*Content-Length超过上传大小上限时回复413，分块传输编码的请求体超过上限时放弃上传并删除不完整的文件
+*上传途中连接关闭，回收连接时立即删除不完整的文件，同名文件可以重新上传
+**************************************************************/
+#include <stdio.h>
+#include <dirent.h>
+#include "test.h"
+#include "conn_harness.h"
+
+
+static const char *const FILES[] = {
+    "/judge.html", "JUDGE",
+};
+
+static std::string g_root;
+
+
+static std::string put(const char *name, const std::string &headers)
+{
+    return std::string("PUT /upload/") + name + " HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n" +
+           headers + "\r\n";
+}
+
+
+static std::string upload_path(const char *name)
+{
+    return g_root + "/upload/" + name;
+}
+
+
+static bool read_file(const char *name, std::string &content)
+{
+    FILE *fp = fopen(upload_path(name).c_str(), "rb");
+    if (!fp)
+        return false;
+    char buf[4096];
+    size_t n;
+    content.clear();
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        content.append(buf, n);
+    fclose(fp);
+    return true;
+}
+
+
+static bool file_exists(const char *name)
+{
+    return access(upload_path(name).c_str(), F_OK) == 0;
+}
+
+
+// 数据较多时分段发送，每段之后处理连接，套接字缓冲区不会写满；连接关闭后不再发送
+static void send_pumped(conn_harness &harness, const std::string &data)
+{
+    const size_t step = 16 * 1024;
+    for (size_t off = 0; off < data.size() && !harness.closed(); off += step)
+    {
+        harness.send(data.substr(off, step));
+        harness.pump();
+    }
+}
+
+
+static void test_upload()
+{
+    conn_harness harness(g_root);
+    std::vector<harness_response> r;
+    CHECK(parse_responses(harness.request(put("a.txt", "Content-Length: 5\r\n") + "hello"), r));
+    CHECK(r.size() == 1 && r[0].status == 201);
+    std::string content;
+    CHECK(read_file("a.txt", content) && content == "hello");
+
+    // 同名文件已经存在，不覆盖
+    r.clear();
+    CHECK(parse_responses(harness.request(put("a.txt", "Content-Length: 3\r\n") + "abc"), r));
+    CHECK(r.size() == 1 && r[0].status == 409);
+    CHECK(read_file("a.txt", content) && content == "hello");
+}
+
+
+// Content-Length超过上限，不创建文件
+static void test_too_large()
+{
+    conn_harness harness(g_root);
+    std::vector<harness_response> r;
+    CHECK(parse_responses(harness.request(put("big.bin", "Content-Length: 1048577\r\n")), r));
+    CHECK(r.size() == 1 && r[0].status == 413);
+    CHECK(!file_exists("big.bin"));
+}
+
+
+// 分块传输编码的请求体写入超过上限时放弃上传，删除不完整的文件
+static void test_chunked_too_large()
+{
+    conn_harness harness(g_root);
+    std::string chunk = "10000\r\n" + std::string(0x10000, 'x') + "\r\n";
+    std::string data = put("chunked.bin", "Transfer-Encoding: chunked\r\n");
+    for (int i = 0; i < 17; ++i)
+        data += chunk;
+    data += "0\r\n\r\n";
+    send_pumped(harness, data);
+    CHECK(harness.closed());
+    CHECK(!file_exists("chunked.bin"));
+}
+
+
+// 上传途中连接关闭，回收连接时删除不完整的文件，同名文件可以立即重新上传
+static void test_abort()
+{
+    {
+        conn_harness harness(g_root);
+        harness.request(put("part.txt", "Content-Length: 100\r\n") + "0123456789");
+        CHECK(!harness.closed());
+        CHECK(file_exists("part.txt"));
+    }
+    CHECK(!file_exists("part.txt"));
+
+    conn_harness harness(g_root);
+    std::vector<harness_response> r;
+    CHECK(parse_responses(harness.request(put("part.txt", "Content-Length: 2\r\n") + "ok"), r));
+    CHECK(r.size() == 1 && r[0].status == 201);
+}
+
+
+static void remove_uploads()
+{
+    std::string dir = g_root + "/upload";
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL)
+    {
+        if (entry->d_name[0] != '.')
+            unlink((dir + "/" + entry->d_name).c_str());
+    }
+    closedir(d);
+    rmdir(dir.c_str());
+}
+
+
+int main()
+{
+    std::vector<std::string> files(FILES, FILES + sizeof(FILES) / sizeof(FILES[0]));
+    // 上传大小上限1MB
+    g_root = harness_setup(files, 1);
+
+    test_upload();
+    test_too_large();
+    test_chunked_too_large();
+    test_abort();
+
+    remove_uploads();
+    harness_cleanup(g_root, files);
+    return TEST_RESULT();
+}
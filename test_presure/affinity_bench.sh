@@ -0,0 +1,38 @@
+#!/bin/bash
+# 对比线程不绑定CPU与通过-x绑定CPU两种情况下长连接请求的尾延迟
+# latency_bench(闭环长连接客户端)输出全部请求延迟的p50/p99/p99.9/最大值
+# 绑定CPU的效果依赖硬件：单核机器上没有区别，多路(NUMA)服务器上才能看出跨节点访问的影响
+#
+# 用法(在项目目录TinyWebServerBymyself下运行，需先编译服务器与test_presure下的基准测试):
+#   ./test_presure/affinity_bench.sh [CPU列表] [连接数] [测试时间] [服务器的其他参数...]
+# 例如(Reactor模式，固定分派):
+#   ./test_presure/affinity_bench.sh 0-7 32 5 -a 1 -w 3
+
+CPU_LIST=${1:-0-$(($(nproc) - 1))}
+CONNECTIONS=${2:-32}
+SECONDS_PER_RUN=${3:-5}
+shift $(($# < 3 ? $# : 3))
+PORT=${PORT:-9017}
+SERVER=${SERVER:-./TinyWebServerBymyself}
+LATENCY=${LATENCY:-./build/test_presure/latency_bench}
+ROUNDS=${ROUNDS:-3}
+
+run()
+{
+    local name=$1
+    shift
+    # 关闭日志，避免日志写入成为瓶颈
+    $SERVER -p $PORT -c 1 "$@" > /dev/null 2>&1 &
+    local pid=$!
+    sleep 1
+    echo "==== $name: $SERVER -p $PORT -c 1 $*"
+    for i in $(seq $ROUNDS); do
+        $LATENCY $PORT $CONNECTIONS $SECONDS_PER_RUN
+    done
+    kill $pid
+    wait $pid 2> /dev/null
+    sleep 1
+}
+
+run "unpinned" "$@"
+run "pinned" -x $CPU_LIST "$@"
@@ -0,0 +1,132 @@
+/*************************************************************
+*长连接请求延迟测试(闭环)
+*每个客户端线程持有一条长连接，发送一个请求、读完响应后再发送下一个，记录每个请求的往返时间，
+*结束后输出全部请求延迟的p50/p99/p99.9/最大值
+*与webbench(每个请求新建连接，只统计吞吐量)互补，用于比较线程绑定CPU等改动对尾延迟的影响
+*
+*用法: latency_bench 端口 连接数 测试时间(秒) [资源路径]
+*例如: latency_bench 9006 32 5 /0
+**************************************************************/
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+
+
+typedef std::chrono::steady_clock bench_clock;
+
+
+/*
+ * @func: 读取一个响应(按Content-Length确定响应体的长度)
+ * @return: 连接关闭或出错时返回false
+ */
+static bool read_response(int fd, char *buf, int size)
+{
+    int got = 0, need = -1;
+    while (need < 0 || got < need)
+    {
+        if (got >= size - 1)
+            return false;
+        int n = read(fd, buf + got, size - 1 - got);
+        if (n <= 0)
+            return false;
+        got += n;
+        if (need < 0)
+        {
+            buf[got] = '\0';
+            char *end = strstr(buf, "\r\n\r\n");
+            if (end)
+            {
+                char *length = strcasestr(buf, "Content-Length:");
+                need = end + 4 - buf + (length && length < end ? atoi(length + 15) : 0);
+            }
+        }
+    }
+    return true;
+}
+
+
+/*
+ * @func: 一个客户端线程：在一条长连接上循环发送请求直到deadline，延迟(us)追加到samples
+ */
+static void client(int port, const std::string &request, bench_clock::time_point deadline,
+                   std::vector<double> &samples, std::mutex &mutex)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        perror("connect");
+        close(fd);
+        return;
+    }
+
+    std::vector<double> local;
+    static const int BUF_SIZE = 1 << 20;
+    std::vector<char> buf(BUF_SIZE);
+    while (bench_clock::now() < deadline)
+    {
+        bench_clock::time_point start = bench_clock::now();
+        if (write(fd, request.data(), request.size()) != (ssize_t)request.size())
+            break;
+        if (!read_response(fd, buf.data(), BUF_SIZE))
+        {
+            fprintf(stderr, "connection closed by server\n");
+            break;
+        }
+        local.push_back(std::chrono::duration<double, std::micro>(bench_clock::now() - start).count());
+    }
+    close(fd);
+
+    std::lock_guard<std::mutex> guard(mutex);
+    samples.insert(samples.end(), local.begin(), local.end());
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        fprintf(stderr, "usage: %s port connections seconds [path]\n", argv[0]);
+        return 1;
+    }
+    int port = atoi(argv[1]);
+    int connections = atoi(argv[2]);
+    double seconds = atof(argv[3]);
+    std::string path = argc > 4 ? argv[4] : "/0";
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n";
+
+    std::vector<double> samples;
+    std::mutex mutex;
+    bench_clock::time_point deadline =
+        bench_clock::now() + std::chrono::duration_cast<bench_clock::duration>(std::chrono::duration<double>(seconds));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < connections; ++i)
+        threads.emplace_back(client, port, std::cref(request), deadline, std::ref(samples), std::ref(mutex));
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    size_t count = samples.size();
+    if (count == 0)
+    {
+        printf("no samples\n");
+        return 1;
+    }
+    std::sort(samples.begin(), samples.end());
+    printf("requests=%zu (%.0f/s) p50=%.0fus p99=%.0fus p99.9=%.0fus max=%.0fus\n", count, count / seconds,
+           samples[count / 2], samples[count * 99 / 100], samples[count * 999 / 1000], samples[count - 1]);
+    return 0;
+}
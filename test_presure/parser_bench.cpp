@@ -0,0 +1,302 @@
+/*************************************************************
+*请求解析基准测试，语料为浏览器实际发出的请求(页面、子资源、XHR、表单提交、条件请求与范围请求)
+*1. 按行拆分请求报文：scan_line_end的逐字节、SSE2、AVX2实现
+*2. 请求头部字段名查找：lookup_header与依次调用strncasecmp比较每个字段名(原parse_headers的方式)
+*3. 完整处理：经过UNIX域套接字，由http_conn解析并生成响应(包括系统调用)
+*
+*用法(在构建目录下): ./test_presure/parser_bench [轮数]
+**************************************************************/
+#include <stdio.h>
+#include <strings.h>
+#include <time.h>
+#include "../test/conn_harness.h"
+#include "../http/http_scan.h"
+
+
+static const char *const CORPUS[] = {
+    // Chrome打开页面
+    "GET / HTTP/1.1\r\n"
+    "Host: 192.168.1.10:9006\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "sec-ch-ua: \"Not_A Brand\";v=\"8\", \"Chromium\";v=\"120\", \"Google Chrome\";v=\"120\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Windows\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+    "Sec-Fetch-Site: none\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Cookie: _ga=GA1.1.1234567890.1700000000; session=8f14e45fceea167a5a36dedd4bea2543; theme=dark\r\n"
+    "\r\n",
+    // Chrome加载图片
+    "GET /frame.jpg HTTP/1.1\r\n"
+    "Host: 192.168.1.10:9006\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Not_A Brand\";v=\"8\", \"Chromium\";v=\"120\", \"Google Chrome\";v=\"120\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Windows\"\r\n"
+    "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: image\r\n"
+    "Referer: http://192.168.1.10:9006/5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "If-None-Match: \"65a1b2c3-1f4a2\"\r\n"
+    "If-Modified-Since: Fri, 12 Jan 2024 08:00:00 GMT\r\n"
+    "\r\n",
+    // Firefox
+    "GET /judge.html HTTP/1.1\r\n"
+    "Host: 192.168.1.10:9006\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Ubuntu; Linux x86_64; rv:121.0) Gecko/20100101 Firefox/121.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Accept-Language: zh-CN,zh;q=0.8,zh-TW;q=0.7,zh-HK;q=0.5,en-US;q=0.3,en;q=0.2\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-Site: none\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "\r\n",
+    // Safari播放视频的范围请求
+    "GET /xxx.mp4 HTTP/1.1\r\n"
+    "Host: 192.168.1.10:9006\r\n"
+    "Accept: */*\r\n"
+    "Accept-Language: zh-CN,zh-Hans;q=0.9\r\n"
+    "Connection: keep-alive\r\n"
+    "Range: bytes=0-1048575\r\n"
+    "Accept-Encoding: identity\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.2 Safari/605.1.15\r\n"
+    "Referer: http://192.168.1.10:9006/6\r\n"
+    "X-Playback-Session-Id: 0E8E2B7F-4C1D-4C8B-9E2A-3B1A2F5D6C7E\r\n"
+    "\r\n",
+    // XHR
+    "GET /api/status HTTP/1.1\r\n"
+    "Host: 192.168.1.10:9006\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Not_A Brand\";v=\"8\", \"Chromium\";v=\"120\", \"Google Chrome\";v=\"120\"\r\n"
+    "Accept: application/json, text/plain, */*\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Windows\"\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: cors\r\n"
+    "Sec-Fetch-Dest: empty\r\n"
+    "Referer: http://192.168.1.10:9006/\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Cookie: _ga=GA1.1.1234567890.1700000000; session=8f14e45fceea167a5a36dedd4bea2543; theme=dark\r\n"
+    "\r\n",
+    // 登录表单提交
+    "POST /2CGISQL.cgi HTTP/1.1\r\n"
+    "Host: 192.168.1.10:9006\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 25\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Origin: http://192.168.1.10:9006\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8\r\n"
+    "Referer: http://192.168.1.10:9006/1\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n"
+    "user=alice&password=12345",
+    // curl
+    "GET /log.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:9006\r\n"
+    "User-Agent: curl/8.5.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n",
+};
+static const int CORPUS_SIZE = sizeof(CORPUS) / sizeof(CORPUS[0]);
+
+static const char *const IMPL_NAMES[SCAN_IMPL_NUM] = {"scalar", "sse2", "avx2"};
+
+// 防止编译器优化掉结果
+static volatile long g_sink;
+
+
+static double now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+// 原parse_headers的字段名查找：依次与每个字段名(带冒号)比较
+static HTTP_HEADER lookup_header_linear(const char *text)
+{
+    static const struct
+    {
+        const char *name;
+        int len;
+        HTTP_HEADER id;
+    } names[] = {
+        {"Connection:", 11, HEADER_CONNECTION},
+        {"Content-length:", 15, HEADER_CONTENT_LENGTH},
+        {"Host:", 5, HEADER_HOST},
+        {"Range:", 6, HEADER_RANGE},
+        {"If-Range:", 9, HEADER_IF_RANGE},
+        {"If-None-Match:", 14, HEADER_IF_NONE_MATCH},
+        {"Accept-Encoding:", 16, HEADER_ACCEPT_ENCODING},
+        {"If-Modified-Since:", 18, HEADER_IF_MODIFIED_SINCE},
+        {"Transfer-Encoding:", 18, HEADER_TRANSFER_ENCODING},
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+        if (strncasecmp(text, names[i].name, names[i].len) == 0)
+            return names[i].id;
+    }
+    return HEADER_UNKNOWN;
+}
+
+
+// 拆分语料中的每一行，返回每个请求的平均耗时(ns)
+static double bench_scan(SCAN_IMPL impl, int rounds)
+{
+    double start = now_ns();
+    long lines = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (int i = 0; i < CORPUS_SIZE; ++i)
+        {
+            const char *buf = CORPUS[i];
+            int end = strlen(buf);
+            int pos = 0;
+            while (pos < end)
+            {
+                int eol = scan_line_end_impl(impl, buf, pos, end);
+                ++lines;
+                pos = eol + 2;
+            }
+        }
+    }
+    g_sink = lines;
+    return (now_ns() - start) / ((double)rounds * CORPUS_SIZE);
+}
+
+
+// 语料中所有请求头部字段的名字
+struct header_name
+{
+    const char *text;
+    int len;
+};
+
+
+static void collect_names(std::vector<header_name> &names)
+{
+    for (int i = 0; i < CORPUS_SIZE; ++i)
+    {
+        const char *line = strstr(CORPUS[i], "\r\n") + 2;
+        while (strncmp(line, "\r\n", 2) != 0)
+        {
+            const char *colon = strchr(line, ':');
+            header_name name = {line, (int)(colon - line)};
+            names.push_back(name);
+            line = strstr(line, "\r\n") + 2;
+        }
+    }
+}
+
+
+// 查找所有字段名，返回每个字段的平均耗时(ns)
+static double bench_lookup(const std::vector<header_name> &names, bool linear, int rounds)
+{
+    double start = now_ns();
+    long found = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < names.size(); ++i)
+            found += linear ? lookup_header_linear(names[i].text) : lookup_header(names[i].text, names[i].len);
+    }
+    g_sink = found;
+    return (now_ns() - start) / ((double)rounds * names.size());
+}
+
+
+// 经过http_conn在同一个长连接上完整处理语料中的每个请求，返回每个请求的平均耗时(ns)
+// 没有Connection: keep-alive的请求(curl)响应后连接会被关闭，不参与
+static double bench_conn(const std::string &root, int rounds)
+{
+    std::vector<const char *> requests;
+    for (int i = 0; i < CORPUS_SIZE; ++i)
+    {
+        if (strstr(CORPUS[i], "Connection: keep-alive"))
+            requests.push_back(CORPUS[i]);
+    }
+
+    conn_harness harness(root);
+    double start = now_ns();
+    long bytes = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < requests.size(); ++i)
+            bytes += harness.request(requests[i]).size();
+    }
+    g_sink = bytes;
+    if (harness.closed())
+    {
+        fprintf(stderr, "connection closed unexpectedly\n");
+        exit(1);
+    }
+    return (now_ns() - start) / ((double)rounds * requests.size());
+}
+
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 200000;
+
+    int total = 0;
+    for (int i = 0; i < CORPUS_SIZE; ++i)
+        total += strlen(CORPUS[i]);
+    printf("corpus: %d requests, %d bytes on average\n\n", CORPUS_SIZE, total / CORPUS_SIZE);
+
+    printf("line scanning (scan_line_end)\n");
+    for (int impl = 0; impl < SCAN_IMPL_NUM; ++impl)
+    {
+        if (!scan_impl_supported((SCAN_IMPL)impl))
+        {
+            printf("  %-8s not supported\n", IMPL_NAMES[impl]);
+            continue;
+        }
+        bench_scan((SCAN_IMPL)impl, rounds / 10);
+        double ns = bench_scan((SCAN_IMPL)impl, rounds);
+        printf("  %-8s %8.1f ns/request %8.0f MB/s\n", IMPL_NAMES[impl], ns, total / CORPUS_SIZE / ns * 1000);
+    }
+
+    std::vector<header_name> names;
+    collect_names(names);
+    printf("\nheader name lookup (%zu names)\n", names.size());
+    bench_lookup(names, true, rounds / 10);
+    printf("  %-8s %8.1f ns/header\n", "linear", bench_lookup(names, true, rounds));
+    bench_lookup(names, false, rounds / 10);
+    printf("  %-8s %8.1f ns/header\n", "switch", bench_lookup(names, false, rounds));
+
+    // 完整处理需要的页面，内容很短，只是为了让每个请求都能得到响应
+    std::vector<std::string> files;
+    const char *const pages[] = {"/judge.html", "/frame.jpg", "/xxx.mp4", "/log.html", "/welcome.html", "/logError.html"};
+    for (size_t i = 0; i < sizeof(pages) / sizeof(pages[0]); ++i)
+    {
+        files.push_back(pages[i]);
+        files.push_back("<html></html>");
+    }
+    std::string root = harness_setup(files);
+    int conn_rounds = rounds / 20 > 0 ? rounds / 20 : 1;
+    bench_conn(root, conn_rounds / 10 > 0 ? conn_rounds / 10 : 1);
+    printf("\nfull request through http_conn (includes syscalls)\n");
+    printf("  %8.1f ns/request\n", bench_conn(root, conn_rounds));
+    harness_cleanup(root, files);
+    return 0;
+}
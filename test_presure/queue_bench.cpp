@@ -0,0 +1,150 @@
+/*************************************************************
+*线程池任务队列的竞争测试
+*对比原来的任务队列(std::list + 互斥锁 + 信号量)与mpmc_queue(有界无锁环形队列 + event_count)
+*P个生产者线程(对应事件循环)入队、C个消费者线程(对应工作线程)出队，任务本身不做任何处理，
+*测量的是队列在不同线程数下的吞吐量(百万次/秒)
+*
+*用法(在构建目录下): ./test_presure/queue_bench [每轮任务数]
+**************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <list>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include "../lock/locker.h"
+#include "../threadpool/mpmc_queue.h"
+
+
+struct task
+{
+    int x;
+};
+
+
+// 原来的任务队列：与原threadpool::append/run的加锁与等待方式相同
+class list_queue
+{
+public:
+    explicit list_queue(size_t capacity) : m_capacity(capacity) {}
+
+    bool push(task *t)
+    {
+        m_lock.lock();
+        if (m_queue.size() >= m_capacity)
+        {
+            m_lock.unlock();
+            return false;
+        }
+        m_queue.push_back(t);
+        m_lock.unlock();
+        m_stat.post();
+        return true;
+    }
+
+    task *pop()
+    {
+        while (true)
+        {
+            m_stat.wait();
+            m_lock.lock();
+            if (m_queue.empty())
+            {
+                m_lock.unlock();
+                continue;
+            }
+            task *t = m_queue.front();
+            m_queue.pop_front();
+            m_lock.unlock();
+            return t;
+        }
+    }
+
+private:
+    std::list<task *> m_queue;
+    locker m_lock;
+    sem m_stat;
+    size_t m_capacity;
+};
+
+
+/*
+ * @func: producers个线程各入队per_producer个任务，consumers个线程出队，返回吞吐量(百万次/秒)
+ * @note: 队列满时生产者让出CPU后重试；全部入队后每个消费者收到一个NULL后退出
+ */
+template <typename Q>
+static double run(int producers, int consumers, long per_producer)
+{
+    // 与服务器默认的max_requests相同
+    Q queue(10000);
+    task dummy;
+    std::atomic<long> done(0);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < consumers; ++i)
+    {
+        workers.emplace_back([&] {
+            while (queue.pop())
+                done++;
+        });
+    }
+    std::vector<std::thread> loops;
+    for (int i = 0; i < producers; ++i)
+    {
+        loops.emplace_back([&] {
+            for (long k = 0; k < per_producer; ++k)
+                while (!queue.push(&dummy))
+                    std::this_thread::yield();
+        });
+    }
+    for (size_t i = 0; i < loops.size(); ++i)
+        loops[i].join();
+    for (int i = 0; i < consumers; ++i)
+        while (!queue.push(NULL))
+            std::this_thread::yield();
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (done != producers * per_producer)
+    {
+        fprintf(stderr, "lost tasks: %ld of %ld\n", producers * per_producer - done.load(), producers * per_producer);
+        exit(1);
+    }
+    return producers * per_producer / seconds / 1e6;
+}
+
+
+int main(int argc, char *argv[])
+{
+    long total = argc > 1 ? atol(argv[1]) : 4000000;
+    const int rounds = 3;
+
+    printf("threads  P/C     list+mutex+sem  mpmc   (Mops/s, average of %d)\n", rounds);
+    const int thread_counts[] = {8, 16, 32, 64};
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i)
+    {
+        int n = thread_counts[i];
+        // 生产者与消费者各一半(多个从Reactor)，以及4个生产者(少量事件循环、大量工作线程)
+        const int producer_counts[] = {n / 2, 4};
+        for (int j = 0; j < 2; ++j)
+        {
+            int producers = producer_counts[j];
+            // 8个线程时两种分配相同
+            if (j == 1 && producers == producer_counts[0])
+                continue;
+            int consumers = n - producers;
+            double list_ops = 0, mpmc_ops = 0;
+            for (int r = 0; r < rounds; ++r)
+            {
+                list_ops += run<list_queue>(producers, consumers, total / producers);
+                mpmc_ops += run<mpmc_queue<task> >(producers, consumers, total / producers);
+            }
+            printf("%3d     %2d/%-2d   %8.2f      %8.2f\n", n, producers, consumers, list_ops / rounds,
+                   mpmc_ops / rounds);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#!/bin/bash
+# 对比单监听套接字与SO_REUSEPORT监听套接字分片两种模式下的建连速率
+# webbench的每个请求都会新建一条连接(服务器默认Connection:close)，因此Requests/Speed即为建连速率
+#
+# 用法(在项目目录TinyWebServerBymyself下运行，需先编译服务器与webbench):
+#   ./test_presure/reuseport_bench.sh [从Reactor数量] [客户端数] [测试时间]
+# 例如:
+#   ./test_presure/reuseport_bench.sh 4 10500 10
+
+REACTOR_NUM=${1:-4}
+CLIENTS=${2:-10500}
+SECONDS_PER_RUN=${3:-10}
+PORT=${PORT:-9016}
+SERVER=${SERVER:-./TinyWebServerBymyself}
+WEBBENCH=${WEBBENCH:-./test_presure/webbench-1.5/webbench}
+BACKLOG=${BACKLOG:-1024}
+
+run()
+{
+    local name=$1
+    shift
+    # 关闭日志，避免日志写入成为瓶颈
+    $SERVER -p $PORT -c 1 "$@" > /dev/null 2>&1 &
+    local pid=$!
+    sleep 1
+    echo "==== $name: $SERVER -p $PORT -c 1 $*"
+    $WEBBENCH -2 -c $CLIENTS -t $SECONDS_PER_RUN http://127.0.0.1:$PORT/ 2>&1 | grep -E "Speed|Requests"
+    kill $pid
+    wait $pid 2> /dev/null
+    sleep 1
+}
+
+# 单监听套接字：主Reactor accept后分发给从Reactor
+run "single listener" -r $REACTOR_NUM -b $BACKLOG
+# SO_REUSEPORT分片：每个从Reactor持有自己的监听套接字并自己accept
+run "SO_REUSEPORT" -r $REACTOR_NUM -b $BACKLOG -u 1
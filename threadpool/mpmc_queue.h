@@ -0,0 +1,166 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "../lock/locker.h"
+
+
+// 自旋等待时降低CPU占用，并让出超线程的执行资源
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+
+/*
+ * 有界无锁多生产者多消费者队列(Dmitry Vyukov的环形队列)
+ * 容量固定(向上取整到2的幂)，入队/出队不分配内存、不加锁
+ * 每个槽位带一个序号：等于入队位置时可以写入，等于入队位置+1时可以读出，
+ * 生产者与消费者各自只在入队/出队位置上CAS竞争，彼此不竞争同一个变量
+ * 队列为空时消费者先自旋片刻，仍为空时通过事件计数(futex)休眠，入队时只有存在休眠的消费者才进入内核唤醒
+ */
+template <typename T>
+class mpmc_queue
+{
+public:
+    explicit mpmc_queue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        m_buffer = new cell[size];
+        m_mask = size - 1;
+        for (size_t i = 0; i < size; ++i)
+            m_buffer[i].seq.store(i, std::memory_order_relaxed);
+        m_enqueue_pos.store(0, std::memory_order_relaxed);
+        m_dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    ~mpmc_queue()
+    {
+        delete[] m_buffer;
+    }
+
+    mpmc_queue(const mpmc_queue &) = delete;
+    mpmc_queue &operator=(const mpmc_queue &) = delete;
+
+    // 入队并唤醒一个阻塞在pop中的消费者，队列已满时返回false
+    bool push(T *item)
+    {
+        if (!try_push(item))
+            return false;
+        m_event.notify_one();
+        return true;
+    }
+
+    // 入队，不唤醒消费者，队列已满时返回false
+    bool try_push(T *item)
+    {
+        cell *c;
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            c = &m_buffer[pos & m_mask];
+            size_t seq = c->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0)
+            {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            // 槽位中还是上一圈尚未取出的任务，队列已满
+            else if (dif < 0)
+                return false;
+            else
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+        c->data = item;
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队列中的任务数量，其他线程同时入队/出队时只是近似值
+    size_t size() const
+    {
+        size_t dequeue = m_dequeue_pos.load(std::memory_order_relaxed);
+        size_t enqueue = m_enqueue_pos.load(std::memory_order_relaxed);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+    // 出队，队列为空时返回false
+    bool try_pop(T *&item)
+    {
+        cell *c;
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            c = &m_buffer[pos & m_mask];
+            size_t seq = c->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0)
+            {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            // 槽位尚未写入，队列为空
+            else if (dif < 0)
+                return false;
+            else
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        }
+        item = c->data;
+        // 槽位留给下一圈的入队位置
+        c->seq.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 出队，队列为空时阻塞；timeout_ms不小于0时最多休眠这么久，期间没有任务到达时返回NULL
+    T *pop(int timeout_ms = -1)
+    {
+        T *item;
+        while (true)
+        {
+            // 任务密集时新任务很快到达，先自旋，避免休眠/唤醒的系统调用
+            for (int i = 0; i < SPIN_COUNT; ++i)
+            {
+                if (try_pop(item))
+                    return item;
+                cpu_relax();
+            }
+            // 登记为等待者后再检查一次，之后入队的任务一定会唤醒本线程
+            int epoch = m_event.prepare_wait();
+            if (try_pop(item))
+            {
+                m_event.cancel_wait();
+                return item;
+            }
+            if (timeout_ms < 0)
+                m_event.wait(epoch);
+            // 超时后最后检查一次：超时与入队同时发生时，入队的任务不会因为本线程返回而无人处理
+            else if (!m_event.wait(epoch, timeout_ms))
+                return try_pop(item) ? item : NULL;
+        }
+    }
+
+private:
+    // 队列为空时休眠前自旋的次数
+    static const int SPIN_COUNT = 64;
+
+    struct cell
+    {
+        std::atomic<size_t> seq;
+        T *data;
+    };
+
+    // 入队位置与出队位置分别由生产者与消费者竞争，放在不同的缓存行中，避免伪共享
+    cell *m_buffer;
+    size_t m_mask;
+    char m_pad0[64];
+    std::atomic<size_t> m_enqueue_pos;
+    char m_pad1[64];
+    std::atomic<size_t> m_dequeue_pos;
+    char m_pad2[64];
+    event_count m_event;
+};
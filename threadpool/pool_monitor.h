@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+
+
+// 线程池的运行状态
+struct pool_status
+{
+    // 当前工作线程数与上下限
+    int threads;
+    int min_threads;
+    int max_threads;
+    // 任务队列中等待的任务数
+    size_t queued;
+    // 已取出的任务总数
+    unsigned long tasks;
+    // 任务在任务队列中的平均/最长等待时间(微秒)
+    unsigned long wait_avg_us;
+    unsigned long wait_max_us;
+};
+
+
+/*
+ * 线程池状态的查询接口
+ * 线程池(模板类)实现该接口，创建时登记为进程内的当前线程池，/api/status等不需要知道任务类型即可读取
+ */
+class pool_monitor
+{
+public:
+    virtual ~pool_monitor() {}
+    // 读取运行状态，各项计数分别读取，不是同一时刻的快照
+    virtual void get_status(pool_status &status) const = 0;
+
+    // 当前线程池，尚未创建时为NULL
+    static pool_monitor *get_instance()
+    {
+        return current();
+    }
+
+protected:
+    static void set_instance(pool_monitor *monitor)
+    {
+        current() = monitor;
+    }
+
+private:
+    // 局部静态变量保存当前线程池
+    static pool_monitor *&current()
+    {
+        static pool_monitor *instance = NULL;
+        return instance;
+    }
+};
@@ -1,10 +1,13 @@
 #pragma once
 
-#include <list>
 #include <cstdio>
 #include <exception>
 #include <pthread.h>
 #include "../lock/locker.h"
+#include <time.h>
+#include "mpmc_queue.h"
+#include "pool_monitor.h"
+#include "../affinity/cpu_affinity.h"
 #include "../CGImysql/sql_connection_pool.h"
 #include <iostream>
 
@@ -15,31 +18,97 @@
  *      需要将模板类，以及模板成员函数均放到一个头文件中
  */
 template <typename  T>
-class threadpool
+class threadpool : public pool_monitor
 {
 public:
-    // thread_number是线程池中线程的数量
+    // thread_number是线程池中常驻线程的数量(线程数下限)
     // max_requests是请求队列中最多允许的、等待处理的请求的数量(任务队列容量)
     // connPool是数据库连接池指针
-    threadpool(int actor_model, connection_pool *connPool, int thread_number = 8, int max_request = 10000);
+    // schedule是任务调度方式：0所有工作线程共享一个任务队列，1工作窃取+轮询分派，2工作窃取+按连接分派，
+    // 3按连接固定分派，只在积压时窃取
+    // cpu_base不小于0时，第i个工作线程绑定到CPU列表(cpu_affinity)中的第cpu_base + i个CPU
+    // max_thread_number大于thread_number时，任务积压时增加线程直到该上限，增加的线程空闲一段时间后退出
+    threadpool(int actor_model, connection_pool *connPool, int thread_number = 8, int max_request = 10000,
+               int schedule = 0, int cpu_base = -1, int max_thread_number = 0);
     ~threadpool();
     // 向任务队列中插入任务
     bool append(T *request, int state);
     bool append_p(T *request);
+    // 读取线程数、任务队列长度与排队时间
+    void get_status(pool_status &status) const;
 
 private:
+    // 每个工作线程的位置：任务队列、休眠用的事件计数与统计计数
+    struct worker_slot;
+
     // 线程池工作线程的任务函数，从任务队列中取出任务并且执行
     // static 修饰 该函数是类级别的，可以在没有创建类实例的情况使用
     static void *worker(void *arg);
-    void run();
+    void run(int id);
+    // 在位置id上创建工作线程
+    bool start_thread(int id);
+    // 将任务放入任务队列
+    bool dispatch(T *request);
+    // 工作线程id取出下一个任务，没有任务时阻塞；弹性线程空闲超时返回NULL
+    T *take(int id);
+    // 工作线程id从其他工作线程的任务队列中窃取任务
+    bool steal(int id, T *&request);
+    // 任务放入工作线程id的任务队列后，唤醒该线程，或者在它正忙时唤醒一个空闲线程来窃取
+    void wake(int id);
+    // 记录任务的排队时间，排队过久时增加线程
+    void record_wait(worker_slot *self, T *request);
+    // 任务积压：增加一个弹性线程
+    void grow();
+    // 弹性线程空闲超时，退出前归还位置
+    void retire(int id);
+    // 单调时钟的当前时间(微秒)
+    static unsigned long now_us();
+
+private:
+    // 工作窃取模式下，工作线程的任务队列都为空时休眠前自旋的次数
+    static const int SPIN_COUNT = 64;
+    // 按连接固定分派时，工作线程的队列中至少积压这么多任务才允许其他线程窃取
+    static const size_t STEAL_BACKLOG = 2;
+    // 任务入队后队列中的任务数达到该值，或任务的排队时间超过GROW_WAIT_US时增加线程
+    static const size_t GROW_DEPTH = 8;
+    static const unsigned long GROW_WAIT_US = 5000;
+    // 两次增加线程之间至少间隔的时间，避免一次突发创建过多线程
+    static const unsigned long GROW_INTERVAL_US = 5000;
+    // 弹性线程空闲(没有取到任务)超过该时间后退出
+    static const int IDLE_TIMEOUT_MS = 10000;
+
+    struct worker_slot
+    {
+        worker_slot(threadpool *p, int i, size_t capacity)
+            : pool(p), id(i), active(false), queue(capacity), tasks(0), wait_us(0), wait_max_us(0) {}
+        threadpool *pool;
+        int id;
+        // 该位置上有工作线程在运行，弹性线程退出后位置可以复用，由m_grow_lock保护
+        bool active;
+        // 工作窃取模式下分派给该线程的任务，其他空闲线程也可以从中窃取，只有常驻线程的位置会被分派任务
+        mpmc_queue<T> queue;
+        // 工作线程在此休眠
+        event_count event;
+        // 本线程取出的任务数、任务排队时间之和与最大值(微秒)，只由本线程写入
+        std::atomic<unsigned long> tasks;
+        std::atomic<unsigned long> wait_us;
+        std::atomic<unsigned long> wait_max_us;
+    };
 
 private:
-    int m_thread_number;          // 线程池中的线程数
+    int m_thread_number;          // 线程池中的常驻线程数(线程数下限)，工作窃取模式下任务只分派给常驻线程
+    int m_max_threads;            // 线程数上限，等于m_thread_number时线程数固定
+    std::atomic<int> m_thread_count; // 当前工作线程数
     int m_max_requests;           // 请求队列中允许的最大请求数(任务队列的容量)
-    pthread_t *m_threads;         // 描述线程池的数组，其大小为m_thread_number (用于存储线程池工作线程的线程ID)
-    std::list<T *> m_workqueue;   // 请求队列（任务队列）-- list 双向链表
-    locker m_queuelocker;         // 保护请求队列的互斥锁
-    sem m_queuestat;              // 信号量类对象，是否有任务需要处理
+    pthread_t *m_threads;         // 描述线程池的数组，其大小为m_max_threads (用于存储线程池工作线程的线程ID)
+    mpmc_queue<T> m_workqueue;    // 请求队列（任务队列）-- 有界无锁队列，入队/出队不加锁，空闲时工作线程通过futex休眠
+    int m_schedule;               // 任务调度方式，0为共享任务队列(m_workqueue)，1/2/3为每个工作线程一个队列(m_workers)
+    size_t m_steal_backlog;       // 队列中至少有这么多任务时才允许窃取，固定分派时为STEAL_BACKLOG，否则为1
+    worker_slot **m_workers;      // 各工作线程的位置，其大小为m_max_threads，前m_thread_number个为常驻线程
+    std::atomic<unsigned> m_next_worker; // 轮询分派时下一个任务分派给的工作线程
+    int m_cpu_base;               // 工作线程在CPU列表中的起始位置，-1表示不绑定CPU
+    std::atomic<unsigned long> m_last_grow_us; // 上一次增加线程的时间
+    locker m_grow_lock;           // 保护弹性线程的创建与退出
     connection_pool *m_connPool;  // 数据库
     int m_actor_model;            // 模型切换（这个切换是指Reactor/Proactor）
 };
@@ -50,43 +119,53 @@ private:
  * @note: 使用成员列表初始化，对成员变量进行初始化
  * @param: actor_model 事件处理模式 1表示Reactor模式  0表示Proactor模式
  * @param: connection_pool 数据库连接池对象地址
- * @param: thread_number 线程池中工作线程数量
+ * @param: thread_number 线程池中常驻工作线程数量
  * @param: max_requests 请求队列大小
+ * @param: schedule 任务调度方式 0共享任务队列 1工作窃取+轮询分派 2工作窃取+按连接分派 3按连接固定分派
+ *         工作窃取模式下每个工作线程有自己的任务队列，容量之和为max_requests
+ * @param: cpu_base 工作线程在CPU列表中的起始位置，-1表示不绑定CPU
+ * @param: max_thread_number 工作线程数上限，不大于thread_number时线程数固定
  */
 template <typename T>
 threadpool<T>::threadpool( int actor_model, connection_pool *connPool,
-                           int thread_number, int max_requests) :
+                           int thread_number, int max_requests, int schedule, int cpu_base,
+                           int max_thread_number) :
                            m_actor_model(actor_model),m_thread_number(thread_number),
-                           m_max_requests(max_requests), m_threads(NULL),m_connPool(connPool)
+                           m_max_threads(max_thread_number > thread_number ? max_thread_number : thread_number),
+                           m_thread_count(0), m_max_requests(max_requests), m_threads(NULL),
+                           m_workqueue(0 == schedule && max_requests > 0 ? max_requests : 1),
+                           m_schedule(schedule), m_steal_backlog(3 == schedule ? STEAL_BACKLOG : 1), m_workers(NULL),
+                           m_next_worker(0), m_cpu_base(cpu_base), m_last_grow_us(0), m_connPool(connPool)
 {
     if (thread_number <= 0 || max_requests <= 0)
         // 参数不正确，抛异常
         throw std::exception();
 
+    // 工作线程启动之前创建好所有位置，工作窃取模式下常驻线程的位置带有各自的任务队列
+    m_workers = new worker_slot *[m_max_threads];
+    for (int i = 0; i < m_max_threads; ++i)
+    {
+        size_t capacity = (0 != m_schedule && i < m_thread_number) ?
+                          (max_requests + m_thread_number - 1) / m_thread_number : 1;
+        m_workers[i] = new worker_slot(this, i, capacity);
+    }
+
     // 为工作线程数组分配内存
-    m_threads = new pthread_t[m_thread_number];     //pthread_t是长整型
+    m_threads = new pthread_t[m_max_threads];     //pthread_t是长整型
     if (!m_threads)
         throw std::exception();
 
     for (int i = 0; i < thread_number; ++i)
     {
-        // 函数原型中的第三个参数，为函数指针，指向处理线程函数的地址。
-        // 若线程函数为类成员函数，
-        // 则this指针会作为默认的参数被传进函数中，从而和线程函数参数(void*)不能匹配，不能通过编译
-        // 静态成员函数就没有这个问题，因为里面没有this指针
-        // this表示的为线程池对象
-        if (pthread_create(m_threads + i, NULL, worker, this) != 0)
-        {
-            delete[] m_threads;
-            throw std::exception();
-        }
-        // 对创建的工作线程进行线程分离，之后不需要主动对工作线程进行线程资源回收
-        if (pthread_detach(m_threads[i]))
+        m_workers[i]->active = true;
+        m_thread_count++;
+        if (!start_thread(i))
         {
             delete[] m_threads;
             throw std::exception();
         }
     }
+    set_instance(this);
 }
 
 
@@ -96,7 +175,270 @@ threadpool<T>::threadpool( int actor_model, connection_pool *connPool,
 template <typename T>
 threadpool<T> ::~threadpool()
 {
+    if (get_instance() == this)
+        set_instance(NULL);
     delete[] m_threads;
+    for (int i = 0; i < m_max_threads && m_workers; ++i)
+        delete m_workers[i];
+    delete[] m_workers;
+}
+
+
+/*
+ * @func: 在位置id上创建工作线程
+ * @note: 配置了CPU列表时，通过线程属性将工作线程绑定到各自的CPU
+ */
+template <typename T>
+bool threadpool<T>::start_thread(int id)
+{
+    // 函数原型中的第三个参数，为函数指针，指向处理线程函数的地址。
+    // 若线程函数为类成员函数，
+    // 则this指针会作为默认的参数被传进函数中，从而和线程函数参数(void*)不能匹配，不能通过编译
+    // 静态成员函数就没有这个问题，因为里面没有this指针
+    // 传入的是工作线程的位置，其中保存了线程池对象与线程的编号
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (m_cpu_base >= 0)
+        cpu_affinity::set_attr(&attr, cpu_affinity::get_instance()->get_cpu(m_cpu_base + id));
+    int ret = pthread_create(m_threads + id, &attr, worker, m_workers[id]);
+    pthread_attr_destroy(&attr);
+    if (ret != 0)
+        return false;
+    // 对创建的工作线程进行线程分离，之后不需要主动对工作线程进行线程资源回收
+    return pthread_detach(m_threads[id]) == 0;
+}
+
+
+template <typename T>
+unsigned long threadpool<T>::now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*
+ * @func: 将任务放入任务队列
+ * @note: 工作窃取模式下先选定工作线程：轮询分派使负载均匀；按连接分派(文件描述符取模)使同一连接总是
+ *        交给同一工作线程，连接的http_conn与读写缓冲区留在该线程所在核的缓存中
+ *        固定分派与按连接分派选定的线程相同，区别在于其他线程只在该线程积压时才窃取(见steal)
+ *        选定线程的任务队列满时依次放入后面的工作线程
+ *        入队后队列中积压的任务达到GROW_DEPTH时增加线程
+ */
+template <typename T>
+bool threadpool<T>::dispatch(T *request)
+{
+    request->m_queued_us = now_us();
+    if (0 == m_schedule)
+    {
+        if (!m_workqueue.push(request))
+            return false;
+        if (m_max_threads > m_thread_number && m_workqueue.size() >= GROW_DEPTH)
+            grow();
+        return true;
+    }
+
+    int target;
+    if (m_schedule >= 2)
+        target = request->get_sockfd() % m_thread_number;
+    else
+        target = m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_thread_number;
+    for (int i = 0; i < m_thread_number; ++i)
+    {
+        int id = (target + i) % m_thread_number;
+        if (m_workers[id]->queue.try_push(request))
+        {
+            wake(id);
+            if (m_max_threads > m_thread_number && m_workers[id]->queue.size() >= GROW_DEPTH)
+                grow();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/*
+ * @func: 任务放入工作线程id的任务队列后唤醒工作线程
+ * @note: 选定的线程在休眠时唤醒它本身；它正忙且队列中的任务允许窃取时，唤醒一个休眠的线程(包括弹性线程)来窃取，
+ *        避免任务排在它当前的任务之后
+ *        与休眠线程的prepare_wait构成Dekker式同步：要么这里看到休眠的线程，要么休眠前的检查看到任务
+ */
+template <typename T>
+void threadpool<T>::wake(int id)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_workers[id]->event.has_waiters())
+    {
+        m_workers[id]->event.notify_one();
+        return;
+    }
+    if (m_workers[id]->queue.size() < m_steal_backlog)
+        return;
+    for (int i = 1; i < m_max_threads; ++i)
+    {
+        worker_slot *w = m_workers[(id + i) % m_max_threads];
+        if (w->event.has_waiters())
+        {
+            w->event.notify_one();
+            return;
+        }
+    }
+}
+
+
+/*
+ * @func: 从其他工作线程的任务队列中窃取任务
+ * @note: 从下一个工作线程开始依次尝试，使窃取分散到不同的队列上；只有常驻线程的队列中有任务
+ *        固定分派时只窃取积压的队列：线程处理完当前任务很快就会取走队列中的下一个任务，
+ *        只有队列中还排着更多任务时才由其他线程分担，连接平时总在同一工作线程上处理
+ */
+template <typename T>
+bool threadpool<T>::steal(int id, T *&request)
+{
+    for (int i = 1; i <= m_thread_number; ++i)
+    {
+        int victim = (id + i) % m_thread_number;
+        if (victim == id)
+            continue;
+        worker_slot *w = m_workers[victim];
+        if (w->queue.size() >= m_steal_backlog && w->queue.try_pop(request))
+            return true;
+    }
+    return false;
+}
+
+
+/*
+ * @func: 工作线程取出下一个任务，没有任务时阻塞
+ * @note: 工作窃取模式下优先处理自己队列中的任务，自己的队列为空时窃取其他线程的任务，
+ *        都为空时先自旋片刻，再休眠到有任务分派给自己或其他线程需要帮助
+ *        弹性线程最多休眠IDLE_TIMEOUT_MS，期间没有取到任务时返回NULL
+ */
+template <typename T>
+T *threadpool<T>::take(int id)
+{
+    bool elastic = id >= m_thread_number;
+    if (0 == m_schedule)
+        return m_workqueue.pop(elastic ? IDLE_TIMEOUT_MS : -1);
+
+    worker_slot *self = m_workers[id];
+    T *request;
+    while (true)
+    {
+        for (int i = 0; i < SPIN_COUNT; ++i)
+        {
+            if (self->queue.try_pop(request) || steal(id, request))
+                return request;
+            cpu_relax();
+        }
+        // 登记为等待者后再检查一次，之后分派的任务一定能看到本线程在休眠
+        int epoch = self->event.prepare_wait();
+        if (self->queue.try_pop(request) || steal(id, request))
+        {
+            self->event.cancel_wait();
+            return request;
+        }
+        if (!elastic)
+            self->event.wait(epoch);
+        // 超时后最后检查一次，超时与唤醒同时发生时不会漏掉任务
+        else if (!self->event.wait(epoch, IDLE_TIMEOUT_MS))
+            return (self->queue.try_pop(request) || steal(id, request)) ? request : NULL;
+    }
+}
+
+
+/*
+ * @func: 记录任务的排队时间
+ * @note: 计数只由本线程写入，读取时汇总所有位置，不在多个线程之间竞争同一缓存行
+ *        排队时间超过GROW_WAIT_US说明工作线程都忙(例如阻塞在数据库操作上)，增加线程
+ */
+template <typename T>
+void threadpool<T>::record_wait(worker_slot *self, T *request)
+{
+    unsigned long now = now_us();
+    unsigned long wait = now > request->m_queued_us ? now - request->m_queued_us : 0;
+    self->tasks.store(self->tasks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    self->wait_us.store(self->wait_us.load(std::memory_order_relaxed) + wait, std::memory_order_relaxed);
+    if (wait > self->wait_max_us.load(std::memory_order_relaxed))
+        self->wait_max_us.store(wait, std::memory_order_relaxed);
+    if (wait >= GROW_WAIT_US && m_max_threads > m_thread_number)
+        grow();
+}
+
+
+/*
+ * @func: 增加一个弹性线程
+ * @note: 入队的事件循环线程或排队过久的工作线程调用；两次增加之间至少间隔GROW_INTERVAL_US，
+ *        积压持续时线程数逐步增加到上限
+ */
+template <typename T>
+void threadpool<T>::grow()
+{
+    if (m_thread_count.load(std::memory_order_relaxed) >= m_max_threads)
+        return;
+    unsigned long now = now_us();
+    unsigned long last = m_last_grow_us.load(std::memory_order_relaxed);
+    if (now - last < GROW_INTERVAL_US || !m_last_grow_us.compare_exchange_strong(last, now))
+        return;
+
+    m_grow_lock.lock();
+    for (int id = m_thread_number; id < m_max_threads; ++id)
+    {
+        if (m_workers[id]->active)
+            continue;
+        m_workers[id]->active = true;
+        m_thread_count++;
+        if (!start_thread(id))
+        {
+            m_workers[id]->active = false;
+            m_thread_count--;
+        }
+        break;
+    }
+    m_grow_lock.unlock();
+}
+
+
+/*
+ * @func: 弹性线程空闲超时，归还位置后退出
+ * @note: 弹性线程的位置不会被分派任务，退出时不会遗留任务
+ */
+template <typename T>
+void threadpool<T>::retire(int id)
+{
+    m_grow_lock.lock();
+    m_workers[id]->active = false;
+    m_thread_count--;
+    m_grow_lock.unlock();
+}
+
+
+/*
+ * @func: 读取线程数、任务队列长度与排队时间
+ */
+template <typename T>
+void threadpool<T>::get_status(pool_status &status) const
+{
+    status.threads = m_thread_count.load();
+    status.min_threads = m_thread_number;
+    status.max_threads = m_max_threads;
+    status.queued = m_workqueue.size();
+    unsigned long wait = 0;
+    status.tasks = 0;
+    status.wait_max_us = 0;
+    for (int i = 0; i < m_max_threads; ++i)
+    {
+        worker_slot *w = m_workers[i];
+        status.queued += w->queue.size();
+        status.tasks += w->tasks.load(std::memory_order_relaxed);
+        wait += w->wait_us.load(std::memory_order_relaxed);
+        unsigned long max = w->wait_max_us.load(std::memory_order_relaxed);
+        if (max > status.wait_max_us)
+            status.wait_max_us = max;
+    }
+    status.wait_avg_us = status.tasks ? wait / status.tasks : 0;
 }
 
 
@@ -108,22 +450,11 @@ threadpool<T> ::~threadpool()
 template <typename T>
 bool threadpool<T>::append(T *request, int state)
 {
-    // 操作请求（任务）队列时，需要加锁，因为这是线程池的共享资源
-    m_queuelocker.lock();
-    if (m_workqueue.size() >= m_max_requests)
-    {
-        m_queuelocker.unlock();
-        // 任务队列满，无法继续添加任务
-        return false;
-    }
-    //读写事件
+    //读写事件，入队之前设置，入队之后任务可能已经被工作线程取走
     request->m_state = state;
-    // 任务队列，队尾插入任务
-    m_workqueue.push_back(request);
-    m_queuelocker.unlock();
-    // 信号量+1，唤醒一个阻塞在请求队列的工作线程
-    m_queuestat.post();
-    return true;
+    // 任务队列，队尾插入任务，队列满时返回false
+    // 有工作线程阻塞在任务队列上时唤醒其中一个
+    return append_p(request);
 }
 
 
@@ -135,63 +466,51 @@ bool threadpool<T>::append(T *request, int state)
 template <typename T>
 bool threadpool<T>::append_p(T *request)
 {
-    m_queuelocker.lock();
-    if (m_workqueue.size() >= m_max_requests)
-    {
-        m_queuelocker.unlock();
-        // 任务队列满
-        return false;
-    }
-    // 任务队列，队尾插入任务
-    m_workqueue.push_back(request);
-    m_queuelocker.unlock();
-    // 信号量+1，唤醒一个阻塞在请求队列的工作线程
-    m_queuestat.post();
-    return true;
+    // 入队之前由工作线程持有，处理完后交回(unhold)，期间事件循环关闭连接不会回收连接对象
+    // 与关闭连接都在连接所属的事件循环中调用，不会持有已经关闭的连接
+    request->hold();
+    // 任务队列，队尾插入任务，队列满时返回false
+    if (dispatch(request))
+        return true;
+    request->unhold();
+    return false;
 }
 
 
 /*
  * @func: 工作线程，任务处理函数，在函数体中，运行私有成员函数run方法
- * @param: arg 线程池实例对象的地址
+ * @param: arg 工作线程的位置，其中保存了线程池实例对象的地址与线程编号
  */
 template <typename T>
 void *threadpool<T>::worker(void *arg)
 {
-    // 调用时 *arg是this！
-    // 所以该操作其实是获取threadpool对象地址
-    threadpool *pool = (threadpool *)arg;
+    worker_slot *slot = (worker_slot *)arg;
+    threadpool *pool = slot->pool;
     // 线程池中每一个线程创建时都会调用run()
     // 在阻塞队列中取出http对象并且处理任务
-    pool->run();
+    pool->run(slot->id);
     return pool;
 }
 
 
 /*
  * @func: 工作线程从任务队列中取出任务，并且执行
+ * @param: id 本线程的编号，对应m_workers中的位置
  */
 template <typename T>
-void threadpool<T>::run()
+void threadpool<T>::run(int id)
 {
+    worker_slot *self = m_workers[id];
     while(true)
     {
-        // 申请信号量，若信号量值为0，则阻塞
-        m_queuestat.wait();
-        // 任务队列为线程池共享资源，需要加锁，实现线程同步
-        m_queuelocker.lock();
-        if(m_workqueue.empty())
-        {
-            m_queuelocker.unlock();
-            continue;
-        }
-        // 从任务队列中，取任务
-        T *request = m_workqueue.front();
-        m_workqueue.pop_front();
-        m_queuelocker.unlock();
+        // 从任务队列中取任务，任务队列为空时阻塞
+        T *request = take(id);
         if(!request){
-            continue;
+            // 弹性线程空闲超时，退出
+            retire(id);
+            return;
         }
+        record_wait(self, request);
 
         // Reactor 模式
         // 主线程仅负责，文件描述符的监控。IO数据读写以及业务处理均为工作子线程负责
@@ -200,42 +519,43 @@ void threadpool<T>::run()
         {
             // IO事件类型：0为读事件
             // request为一个http连接请求对象
+            // 需要关闭连接时，通过完成队列通知连接所属的事件循环，事件循环不必等待工作线程处理完成
             if(0 == request->m_state)
             {
                 // 执行IO数据的读取，从http连接的通信套接字的读缓冲区
                 // 将数据读取至m_read_buf中
                 if(request->read_once())
                 {
-                    // 将improv标志位设置为1，表示数据正在处理
-                    request->improv = 1;
                     // 使用RAII机制管理，该http请求的数据库连接请求
-                    connectionRAII mysqlcon(&request->mysql,m_connPool);
+                    // 路由处理函数访问数据库时才从连接池取出，静态文件请求不占用数据库连接
+                    lazy_connection mysqlcon(m_connPool);
+                    request->mysql = &mysqlcon;
                     // http连接请求对象调用process函数，对m_read_buf中的数据进行解析
+                    // process把连接交回事件循环之前清空request->mysql，返回后只能调用unhold
                     request->process();
                 }
                 else
                 {
-                    // IO数据读取失败
-                    request->improv = 1;
-                    // 将关闭连接的标志位设置为1
-                    request->timer_flag = 1;
+                    // IO数据读取失败，通知事件循环关闭连接
+                    request->m_completion->post(request->get_sockfd(), request->get_generation());
                 }
             }
             else
             {
-                std::cout << "thread_write..." <<std::endl;
                 // IO事件类型：写事件
                 // 将响应报文写入，通信套接字的写缓冲区，发送给客户端
-                if(request->write())
+                // 写失败或短连接发送完毕，通知事件循环关闭连接
+                if(!request->write())
                 {
-                    request->improv = 1;
+                    request->m_completion->post(request->get_sockfd(), request->get_generation());
                 }
-                else
+                // 读缓冲区中还有流水线中的后续请求，直接在本线程继续处理
+                else if(request->take_pipelined())
                 {
-                    request->improv = 1;
-                    request->timer_flag = 1;
+                    lazy_connection mysqlcon(m_connPool);
+                    request->mysql = &mysqlcon;
+                    request->process();
                 }
-
             }
         }
 
@@ -243,7 +563,8 @@ void threadpool<T>::run()
         // 之前主线程的操作已经将数据读取到http的m_read_buf和通信套接字的写缓冲区了
         else
         {
-            connectionRAII mysqlcon(&request->mysql, m_connPool);
+            lazy_connection mysqlcon(m_connPool);
+            request->mysql = &mysqlcon;
             // 事件处理模式默认为Proactor
             // 使用同步I/O模拟Proactor
             // 主线程负责epoll实例中的文件描述符监听，以及IO的读写操作(数据读取)
@@ -251,5 +572,7 @@ void threadpool<T>::run()
             // 而工作线程仅仅负责业务处理逻辑(对准备好的数据进行业务逻辑处理)
             request->process();
         }
+        // 交回连接：已经重新注册事件或投递完成队列，事件循环在处理期间关闭了连接时由这里回收
+        request->unhold();
     }
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <sys/epoll.h>
 #include <errno.h>
 #include "../http/http_conn.h"
+#include "../http/conn_table.h"
 
 
 /*
@@ -378,15 +379,16 @@ int Utils::u_epollfd = 0;
 class Utils;
 void cb_func(client_data *user_data)
 {
-    // 从epoll实例维护的事件表，删除非活动连接在socket上的注册事件
-    epoll_ctl(Utils::u_epollfd, EPOLL_CTL_DEL, user_data->sockfd, 0);
     // assert断言函数，确保user_data指针是有效的
     assert(user_data);
-    // 关闭文件描述符
-    close(user_data->sockfd);
-    // 减少连接数
-    http_conn::m_user_count--;
-    // ？？？？ 为什么没有将http对象的m_sockfd设置为-1
+    // user_data属于连接表中的连接对象，放回空闲链表后可能立刻被新连接使用，先取出文件描述符
+    int sockfd = user_data->sockfd;
+    // 从连接所属epoll实例维护的事件表，删除非活动连接在socket上的注册事件
+    // 工作线程持有该连接时，之后重新注册事件会失败，连接上不会再有事件触发
+    epoll_ctl(user_data->epollfd, EPOLL_CTL_DEL, sockfd, 0);
+    // 将连接移出连接表：没有工作线程持有时立即关闭文件描述符、释放连接资源、减少连接数，
+    // 否则由工作线程交回连接时完成
+    conn_table::get_instance()->release(sockfd);
 }
 
 
@@ -7,9 +7,10 @@
 #include <arpa/inet.h>
 
 
-// 连接资源结构体成员需要用到定时器类
+// 连接资源结构体成员需要用到定时器类与定时器容器类
 // 因此定时器类,需要前向声明
 class util_timer;
+class sort_timer_lst;
 
 
 // 连接资源
@@ -21,6 +22,10 @@ struct client_data
     int sockfd;
     // 定时器对象指针
     util_timer *timer;
+    // 该连接所属事件循环的epoll实例(主Reactor或某个从Reactor)
+    int epollfd;
+    // 该连接所属事件循环的定时器容器
+    sort_timer_lst *timer_lst;
 };
 
 
@@ -6,8 +6,8 @@
  */
 WebServer::WebServer()
 {
-    // http_conn连接对象数组，MAX_FD为最大的连接数量
-    users = new http_conn[MAX_FD];
+    // 连接表按文件描述符索引存活的连接，连接对象在需要时成批分配，MAX_FD为最大的连接数量
+    conn_table::get_instance()->init(MAX_FD);
 
     // root资源文件根目录
     char server_path[200];
@@ -19,8 +19,15 @@ WebServer::WebServer()
     strcat(m_root, root);
     // 此时m_root指向资源文件根目录
 
-    // 定时器连接资源数组
-    users_timer = new client_data[MAX_FD];
+    m_pool = NULL;
+    m_reactor_num = 0;
+    m_reactors = NULL;
+    m_next_reactor = 0;
+    m_io_engine = 0;
+    m_ring = NULL;
+    m_schedule = 0;
+    m_thread_max = 0;
+    m_upload_max_mb = 0;
 }
 
 
@@ -29,17 +36,22 @@ WebServer::WebServer()
  */
 WebServer::~WebServer()
 {
+    // 先停止从Reactor线程，之后才能释放它们访问的连接资源
+    for (int i = 0; i < m_reactor_num && m_reactors; ++i)
+    {
+        delete m_reactors[i];
+    }
+    delete[] m_reactors;
+    // 释放主线程事件循环的io_uring实例
+    delete m_ring;
     // 关闭epoll实例
     close(m_epollfd);
-    // 关闭用于监听的套接字
-    close(m_listenfd);
+    // 关闭用于监听的套接字(SO_REUSEPORT分片模式下监听套接字由从Reactor持有)
+    if (m_listenfd != -1)
+        close(m_listenfd);
     // 关闭管道套接字
     close(m_pipefd[0]);
     close(m_pipefd[1]);
-    // 释放http连接对象数组资源
-    delete[] users;
-    // 释放定时器连接资源数组
-    delete[] users_timer;
     // 释放线程池对象
     delete m_pool;
 }
@@ -59,10 +71,24 @@ WebServer::~WebServer()
  * @param: close_log 是否关闭日志
  * @param: actor_mode 事件处理模式
  * @param: db_port 数据库服务器端口，默认为3306
+ * @param: reactor_num 从Reactor数量，默认为0(单Reactor)
+ * @param: backlog 监听套接字的全连接队列长度，默认为5
+ * @param: reuseport 是否为每个从Reactor创建一个SO_REUSEPORT监听套接字，默认不开启
+ * @param: io_engine I/O引擎，0为recv/writev，1为io_uring，默认为0
+ * @param: file_cache_mb 静态文件缓存的内存预算(MB)，0表示不缓存，默认为64
+ * @param: buffer_max_kb 单个连接读/写缓冲区的大小上限(KB)，默认为64
+ * @param: schedule 线程池任务调度方式，0共享任务队列，1工作窃取+轮询分派，2工作窃取+按连接分派，
+ *         3按连接固定分派(只在积压时窃取)，默认为0
+ * @param: cpu_list 线程绑定的CPU列表，例如"0-3,8-11"，默认为空(不绑定)
+ * @param: thread_max 线程池工作线程数量上限，默认为0(线程数固定为thread_num)
+ * @param: upload_max_mb 上传文件的大小上限(MB)，默认为0(不开启上传接口)
  */
 void WebServer::init(int port, std::string user, std::string passWord,
                      std::string databaseName,int log_write,int opt_linger, int trigmode,
-                     int sql_num, int thread_num, int close_log, int actor_model,int db_port)
+                     int sql_num, int thread_num, int close_log, int actor_model,int db_port,
+                     int reactor_num, int backlog, int reuseport, int io_engine,
+                     int file_cache_mb, int buffer_max_kb, int schedule, std::string cpu_list,
+                     int thread_max, int upload_max_mb)
 {
     m_port = port;
     m_user = user;
@@ -76,6 +102,18 @@ void WebServer::init(int port, std::string user, std::string passWord,
     m_close_log = close_log;
     m_actormodel = actor_model;
     m_db_port = db_port;
+    m_reactor_num = reactor_num;
+    m_backlog = backlog;
+    // SO_REUSEPORT分片需要有从Reactor来持有监听套接字，单Reactor模式下不生效
+    m_reuseport = (1 == reuseport && reactor_num > 0) ? 1 : 0;
+    // io_uring引擎替代的是事件循环中的读写，只在Proactor模式下生效
+    m_io_engine = (1 == io_engine && 0 == actor_model) ? 1 : 0;
+    m_file_cache_mb = file_cache_mb;
+    m_buffer_max_kb = buffer_max_kb;
+    m_schedule = schedule;
+    m_cpu_list = cpu_list;
+    m_thread_max = thread_max;
+    m_upload_max_mb = upload_max_mb;
 }
 
 
@@ -124,7 +162,9 @@ void WebServer::log_write()
         // 日志类型：异步日志
         if(1 == m_log_write)
         {
-            Log::get_instance()->init("./ServerLog", m_close_log, 200, 800000, 800);
+            // 异步日志线程绑定到CPU列表中排在主线程、从Reactor与工作线程之后的CPU
+            Log::get_instance()->init("./ServerLog", m_close_log, 200, 800000, 800,
+                                      cpu_affinity::get_instance()->get_cpu(1 + m_reactor_num + m_thread_num));
         }
         // 日志类型：同步日志
         else
@@ -132,6 +172,12 @@ void WebServer::log_write()
             Log::get_instance()->init("./ServerLog", m_close_log, 2000, 800000, 0);
         }
     }
+
+    // CPU列表在日志系统之前解析(异步日志线程也要绑定)，格式错误在日志系统初始化之后报告
+    if (!m_cpu_list.empty() && !cpu_affinity::get_instance()->enabled())
+    {
+        LOG_ERROR("invalid cpu list: %s, threads are not pinned", m_cpu_list.c_str());
+    }
 }
 
 
@@ -145,8 +191,48 @@ void WebServer::sql_pool()
     // 初始化数据库连接池，数据库服务器默认端口为3306
     m_connPool->init("localhost", m_user, m_passWord, m_databaseName, m_db_port, m_sql_num, m_close_log);
     // 初始化数据库，读取user表，用于cgi注册登陆验证
-    users->initmysql_result(m_connPool);
+    http_conn::initmysql_result(m_connPool, m_close_log);
+    // 注册等异步的数据库操作由执行器处理，线程数与数据库连接数相同
+    sql_executor::get_instance()->init(m_connPool, m_sql_num);
+
+}
+
+
+/*
+ * @func: 初始化静态文件缓存
+ */
+void WebServer::cache_init()
+{
+    file_cache::get_instance()->init((size_t)m_file_cache_mb * 1024 * 1024, m_close_log);
+}
 
+
+/*
+ * @func: 初始化连接读写缓冲区的缓冲区池
+ */
+void WebServer::buffer_init()
+{
+    buffer_pool::get_instance()->init(m_buffer_max_kb * 1024);
+}
+
+
+/*
+ * @func: 解析线程绑定的CPU列表
+ * @note: 列表中的CPU依次分配给主线程事件循环、从Reactor、工作线程、异步日志线程，列表不够时循环使用
+ *        在日志系统初始化之前调用，格式错误时不绑定，由log_write记录错误日志
+ */
+void WebServer::affinity_init()
+{
+    cpu_affinity::get_instance()->init(m_cpu_list);
+}
+
+
+/*
+ * @func: 登记页面跳转、登录/注册校验等路由，配置了上传大小上限时登记上传接口
+ */
+void WebServer::route_init()
+{
+    http_conn::init_routes(m_upload_max_mb);
 }
 
 
@@ -156,20 +242,51 @@ void WebServer::sql_pool()
 void WebServer::thread_pool()
 {
     //线程池
-    m_pool = new threadpool<http_conn>(m_actormodel, m_connPool, m_thread_num);
+    // 工作线程绑定到CPU列表中排在主线程与从Reactor之后的CPU
+    int cpu_base = cpu_affinity::get_instance()->enabled() ? 1 + m_reactor_num : -1;
+    // 线程数在m_thread_num与m_thread_max之间随任务积压程度伸缩
+    m_pool = new threadpool<http_conn>(m_actormodel, m_connPool, m_thread_num, 10000, m_schedule, cpu_base,
+                                       m_thread_max);
 }
 
 
 /*
- * @func: 网络编程，服务器用于监听的套接字ip等属性的设置
- *        IO复用系统epoll实例的创建与设置，将用于监听的套接字挂到epoll实例上，进行监测
- *        定时器系统用于统一事件源的管道套接字创建设置
+ * @func: 创建从Reactor(主Reactor + N个从Reactor模式)
+ *        主线程的事件循环只负责accept与信号，连接的读写事件由从Reactor线程处理
+ *        SO_REUSEPORT分片模式下主线程不再accept，由各个从Reactor在自己的事件循环中accept
  */
-void WebServer::eventListen()
+void WebServer::reactor_pool()
+{
+    if (m_reactor_num <= 0)
+        return;
+
+    m_reactors = new sub_reactor *[m_reactor_num];
+    for (int i = 0; i < m_reactor_num; ++i)
+    {
+        m_reactors[i] = new sub_reactor(this, i, m_close_log);
+        // SO_REUSEPORT分片模式：每个从Reactor持有自己的监听套接字，内核负责在它们之间分配新连接
+        int listenfd = m_reuseport ? create_listenfd(true) : -1;
+        // 从Reactor绑定到CPU列表中紧跟主线程的CPU
+        int cpu = cpu_affinity::get_instance()->get_cpu(1 + i);
+        if (!m_reactors[i]->start(listenfd, m_LISTENTrigmode, cpu))
+        {
+            LOG_ERROR("start sub reactor %d failure", i);
+            throw std::exception();
+        }
+    }
+}
+
+
+/*
+ * @func: 创建用于监听的套接字，设置优雅下线、端口复用等属性，并绑定端口开始监听
+ * @param: reuseport 是否开启SO_REUSEPORT，用于每个从Reactor各自持有一个监听套接字
+ * @return: 监听套接字文件描述符
+ */
+int WebServer::create_listenfd(bool reuseport)
 {
     // SOCK_STREAM 表示使用面向字节流的TCP协议
-    m_listenfd = socket(PF_INET, SOCK_STREAM, 0);
-    assert(m_listenfd >= 0);
+    int listenfd = socket(PF_INET, SOCK_STREAM, 0);
+    assert(listenfd >= 0);
 
     // 是否优雅下线
     // 控制套接字关闭时的行为
@@ -181,14 +298,14 @@ void WebServer::eventListen()
         // tmp.l_onoff 关闭，表示当这个套接字被关闭时
         // 它不会等待未发送的数据发送完毕，而是立即关闭套接字
         struct linger tmp = {0, 1};
-        setsockopt(m_listenfd, SOL_SOCKET, SO_LINGER, &tmp, sizeof(tmp));
+        setsockopt(listenfd, SOL_SOCKET, SO_LINGER, &tmp, sizeof(tmp));
     }
     else if(1 == m_OPT_LINGER)
     {
         // tmp.l_onoff 打开，表示当这个套接字被关闭时
         // 会等待1s再关闭套接字
         struct linger tmp = {1, 1};
-        setsockopt(m_listenfd, SOL_SOCKET, SO_LINGER, &tmp, sizeof(tmp));
+        setsockopt(listenfd, SOL_SOCKET, SO_LINGER, &tmp, sizeof(tmp));
     }
 
     // 设置服务器主机ip相关信息
@@ -202,15 +319,58 @@ void WebServer::eventListen()
 
     // 设置套接字快速复用
     int flag = 1;
-    setsockopt(m_listenfd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof flag);
+    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof flag);
+    // SO_REUSEPORT 允许多个套接字绑定同一端口，由内核在这些监听套接字之间负载均衡新连接
+    if (reuseport)
+    {
+        ret = setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT, &flag, sizeof flag);
+        assert(ret >= 0);
+    }
     // 套接字绑定本地IP与端口
-    ret = bind(m_listenfd, (struct sockaddr *)&address, sizeof address);
+    ret = bind(listenfd, (struct sockaddr *)&address, sizeof address);
     assert(ret >= 0);
 
-    // 监听客户端连接请求
-    ret = listen(m_listenfd, 5);
+    // 监听客户端连接请求，m_backlog为全连接队列长度
+    ret = listen(listenfd, m_backlog);
     assert(ret >= 0);
 
+    return listenfd;
+}
+
+
+/*
+ * @func: 为一个事件循环创建io_uring实例
+ * @return: io_uring实例，未开启io_uring引擎或内核不支持时返回NULL，事件循环退回recv/writev
+ */
+io_uring_engine *WebServer::create_ring()
+{
+    if (1 != m_io_engine)
+        return NULL;
+
+    io_uring_engine *ring = new io_uring_engine;
+    if (!ring->init(URING_ENTRIES))
+    {
+        LOG_ERROR("io_uring setup failure, errno is:%d, fall back to recv/writev", errno);
+        delete ring;
+        return NULL;
+    }
+    return ring;
+}
+
+
+/*
+ * @func: 网络编程，服务器用于监听的套接字ip等属性的设置
+ *        IO复用系统epoll实例的创建与设置，将用于监听的套接字挂到epoll实例上，进行监测
+ *        定时器系统用于统一事件源的管道套接字创建设置
+ */
+void WebServer::eventListen()
+{
+    // SO_REUSEPORT分片模式下，监听套接字由各个从Reactor在reactor_pool中创建，主线程不再accept
+    if (m_reuseport)
+        m_listenfd = -1;
+    else
+        m_listenfd = create_listenfd(false);
+
     // 初始化定时器最小定时时间间隔
     utils.init(TIMESLOT);
 
@@ -220,12 +380,12 @@ void WebServer::eventListen()
     assert(m_epollfd != -1);
 
     // 将用于监听的套接字在内核事件表上注册读事件（挂到epoll实例上）
-    utils.addfd(m_epollfd, m_listenfd, false, m_LISTENTrigmode);
-    http_conn::m_epollfd = m_epollfd;
+    if (m_listenfd != -1)
+        utils.addfd(m_epollfd, m_listenfd, false, m_LISTENTrigmode);
 
     // socketpair()函数用于创建一对匿名的、相互连接的管道套接字，用于进程间通信
     // socketpait创建的管道套接字是双向通信的
-    ret = socketpair(PF_UNIX, SOCK_STREAM, 0, m_pipefd);
+    int ret = socketpair(PF_UNIX, SOCK_STREAM, 0, m_pipefd);
     assert(ret != -1);
 
     // 设置管道写端为非阻塞
@@ -235,8 +395,16 @@ void WebServer::eventListen()
     // 将读端的套接字文件描述符添加到m_epoll实例中，监听读事件
     // 而且是ET，边沿工作模式下，非阻塞，没有阻塞EPOLLONESHOT事件
     utils.addfd(m_epollfd, m_pipefd[0], false, 0);
+    // Reactor模式下工作线程回报结果的完成队列，同样挂到epoll实例上
+    utils.addfd(m_epollfd, m_completion.get_fd(), false, 0);
+    // 静态文件缓存的inotify文件描述符，资源文件被修改时通知主线程事件循环
+    if (file_cache::get_instance()->get_inotify_fd() != -1)
+        utils.addfd(m_epollfd, file_cache::get_instance()->get_inotify_fd(), false, 0);
     // 如此完成了定时器设计中提到的统一事件源
 
+    // 主线程事件循环的io_uring实例
+    m_ring = create_ring();
+
     // 定时器alarm函数传递给主循环的信号值，这里只关注SIGALRM和SIGTERM
     // SIGALRM/SIGTERM 设置信号处理函数
     // SIGPIPE 信号忽视
@@ -256,29 +424,74 @@ void WebServer::eventListen()
 
 
 /*
- * @func: 创建一个定时器节点，将http连接信息挂载
+ * @func: 创建一个定时器节点，将http连接信息挂载到主线程的事件循环上
  */
 void WebServer::timer(int connfd, struct sockaddr_in client_address)
 {
+    timer(connfd, client_address, NULL);
+}
+
+
+/*
+ * @func: 创建一个定时器节点，将http连接信息挂载到指定的事件循环上
+ * @param: reactor 连接所属的从Reactor，为NULL表示主线程的事件循环
+ * @note: 多Reactor模式下由从Reactor线程调用，连接此后固定在该事件循环上
+ *        连接使用所属事件循环的epoll实例、定时器容器与完成队列
+ */
+void WebServer::timer(int connfd, struct sockaddr_in client_address, sub_reactor *reactor)
+{
+    int epollfd = reactor ? reactor->get_epollfd() : m_epollfd;
+    sort_timer_lst *timer_lst = reactor ? reactor->get_timer_lst() : &utils.m_timer_lst;
+
+    // 从连接表中为新连接分配连接对象
+    conn_slot *slot = conn_table::get_instance()->acquire(connfd);
+    if (!slot)
+    {
+        LOG_ERROR("%s", "conn_table acquire failure");
+        close(connfd);
+        return;
+    }
+
     // 初始化http连接对象
-    users[connfd].init(connfd, client_address, m_root, m_CONNTrigmode, m_close_log,
-                       m_user, m_passWord, m_databaseName);
+    slot->conn.init(connfd, client_address, epollfd, m_root, m_CONNTrigmode, m_close_log);
+    slot->conn.m_completion = reactor ? reactor->get_completion() : &m_completion;
 
     // 初始化定时器资源 client_data数据
     // 创建定时器，设置回调函数和超时事件，绑定用户数据，将定时器添加至定时器容器链表中
-    users_timer[connfd].address = client_address;
-    users_timer[connfd].sockfd = connfd;
+    client_data *user_data = &slot->timer_data;
+    user_data->address = client_address;
+    user_data->sockfd = connfd;
+    user_data->epollfd = epollfd;
+    user_data->timer_lst = timer_lst;
     // 为该http连接创建一个定时器
     util_timer *timer = new util_timer;
-    timer->user_data = &users_timer[connfd];
+    timer->user_data = user_data;
 
     timer->cb_func = cb_func;
     // 设置该定时器的超时时间
     time_t cur = time(NULL);
     timer->expire = cur + 3*TIMESLOT;
-    users_timer[connfd].timer = timer;
-    // 将定时器添加至定时器容器链表中
-    utils.m_timer_lst.add_timer(timer);
+    user_data->timer = timer;
+    // 将定时器添加至所属事件循环的定时器容器链表中
+    timer_lst->add_timer(timer);
+}
+
+
+/*
+ * @func: 将新接受的连接交给事件循环
+ *        单Reactor模式下挂到主线程的事件循环上，多Reactor模式下轮询交给某个从Reactor
+ */
+void WebServer::dispatch(int connfd, struct sockaddr_in client_address)
+{
+    if (m_reactor_num > 0)
+    {
+        m_reactors[m_next_reactor]->dispatch(connfd, client_address);
+        m_next_reactor = (m_next_reactor + 1) % m_reactor_num;
+    }
+    else
+    {
+        timer(connfd, client_address);
+    }
 }
 
 
@@ -290,7 +503,7 @@ void WebServer::adjust_timer(util_timer *timer)
 {
     time_t cur = time(NULL);
     timer->expire = cur + 3*TIMESLOT;
-    utils.m_timer_lst.adjust_timer(timer);
+    timer->user_data->timer_lst->adjust_timer(timer);
 
     LOG_INFO("%s", "adjust timer once");
 }
@@ -301,16 +514,36 @@ void WebServer::adjust_timer(util_timer *timer)
  */
 void WebServer::deal_timer(util_timer *timer, int sockfd)
 {
+    conn_slot *slot = conn_table::get_instance()->get(sockfd);
+    if (!slot)
+        return;
+    // 关闭文件描述符之前先取出所属定时器容器
+    // 回调函数可能将连接对象放回连接表的空闲链表，多Reactor模式下fd一旦关闭，
+    // 主Reactor可能立刻accept到相同的fd，连接对象随之被其他连接重新使用
+    sort_timer_lst *timer_lst = slot->timer_data.timer_lst;
+
     // 执行定时器回调函数
     //  从内核事件表删除事件，关闭文件描述符，释放连接资源
-    timer->cb_func(&users_timer[sockfd]);
+    timer->cb_func(&slot->timer_data);
     if(timer)
     {
-        // 从定时器容器中删除定时器，并且释放定时器对象
-        utils.m_timer_lst.del_timer(timer);
+        // 从所属定时器容器中删除定时器，并且释放定时器对象
+        timer_lst->del_timer(timer);
     }
 
-    LOG_INFO("close fd %d", users_timer[sockfd].sockfd);
+    LOG_INFO("close fd %d", sockfd);
+}
+
+
+/*
+ * @func: 关闭文件描述符对应的连接，删除其定时器节点
+ *        连接已经关闭(连接表中没有该文件描述符)时不做任何处理
+ */
+void WebServer::close_conn(int sockfd)
+{
+    conn_slot *slot = conn_table::get_instance()->get(sockfd);
+    if (slot)
+        deal_timer(slot->timer_data.timer, sockfd);
 }
 
 
@@ -319,6 +552,18 @@ void WebServer::deal_timer(util_timer *timer, int sockfd)
  *        根据监听套接字事件触发方式，接收客户端的连接
  */
 bool WebServer::dealclientdata()
+{
+    return dealclientdata(m_listenfd, NULL);
+}
+
+
+/*
+ * @func: 从指定的监听套接字接收客户端的连接
+ * @param: listenfd 监听套接字
+ * @param: reactor 监听套接字所属的从Reactor，为NULL表示主线程的监听套接字
+ *         SO_REUSEPORT分片模式下，从Reactor接收的连接直接挂到该从Reactor上，不再经过主线程分发
+ */
+bool WebServer::dealclientdata(int listenfd, sub_reactor *reactor)
 {
     struct sockaddr_in client_address;
     socklen_t client_addrlength = sizeof client_address;
@@ -326,7 +571,7 @@ bool WebServer::dealclientdata()
     if (0 == m_LISTENTrigmode)
     {
         // 接受客户端连接
-        int connfd = accept(m_listenfd, (struct sockaddr *)&client_address, &client_addrlength);
+        int connfd = accept(listenfd, (struct sockaddr *)&client_address, &client_addrlength);
         if (connfd < 0)
         {
             LOG_ERROR("%s:errno is:%d", "accept error", errno);
@@ -338,8 +583,11 @@ bool WebServer::dealclientdata()
             LOG_ERROR("%s", "Internal server busy");
             return false;
         }
-        // 创建一个定时器节点，将http连接信息挂载
-        timer(connfd, client_address);
+        // 将连接交给事件循环，创建一个定时器节点，将http连接信息挂载
+        if (reactor)
+            timer(connfd, client_address, reactor);
+        else
+            dispatch(connfd, client_address);
     }
 
     // ET 边沿工作模式
@@ -348,7 +596,7 @@ bool WebServer::dealclientdata()
         // 边沿触发需要一直accept直到为空
         while (1)
         {
-            int connfd = accept(m_listenfd, (struct sockaddr *)&client_address, &client_addrlength);
+            int connfd = accept(listenfd, (struct sockaddr *)&client_address, &client_addrlength);
             if (connfd < 0)
             {
                 LOG_ERROR("%s:errno is:%d", "accept error", errno);
@@ -360,7 +608,10 @@ bool WebServer::dealclientdata()
                 LOG_ERROR("%s", "Internal server busy");
                 break;
             }
-            timer(connfd, client_address);
+            if (reactor)
+                timer(connfd, client_address, reactor);
+            else
+                dispatch(connfd, client_address);
         }
         return false;
     }
@@ -421,8 +672,23 @@ bool WebServer::dealwithsignal(bool &timeout, bool &stop_server)
  */
 void WebServer::dealwithread(int sockfd)
 {
+    dealwithread(sockfd, NULL);
+}
+
+
+/*
+ * @func: 处理客户连接上接收到的数据(通信套接字读操作)
+ * @param: ring 事件循环的io_uring实例，不为NULL时Proactor模式下的recv交给io_uring，
+ *         在本轮事件处理完后由dealwithuring批量提交
+ */
+void WebServer::dealwithread(int sockfd, io_uring_engine *ring)
+{
+    conn_slot *slot = conn_table::get_instance()->get(sockfd);
+    if (!slot)
+        return;
+    http_conn *conn = &slot->conn;
     // 创建定时器临时变量，将该连接对应的定时器取出来
-    util_timer *timer = users_timer[sockfd].timer;
+    util_timer *timer = slot->timer_data.timer;
 
     // Reactor事件处理模式
     // Reactor模式，仅负责文件描述符的事件监听
@@ -435,47 +701,54 @@ void WebServer::dealwithread(int sockfd)
         }
 
         // 若监测到读事件，将该事件放入请求队列
-        m_pool->append(users + sockfd, 0);
-        while(true)
-        {
-            // 是否正在处理中
-            if (1 == users[sockfd].improv)
-            {
-                // 事件类型关闭连接
-                if (1 == users[sockfd].timer_flag)
-                {
-                    // 删除定时器节点，关闭连接
-                    deal_timer(timer, sockfd);
-                    users[sockfd].timer_flag = 0;
-                }
-                users[sockfd].improv = 0;
-                break;
-            }
-        }
+        // 不等待工作线程处理完成，需要关闭连接时工作线程会通过完成队列通知事件循环
+        m_pool->append(conn, 0);
     }
 
     // Proactor事件处理模式
     // Proactor模式，负责文件描述符的事件监听以及IO数据读写
     else
     {
-        // 先读取数据，再放进请求队列
-        if (users[sockfd].read_once())
+        // io_uring引擎：准备recv操作，提交队列已满时退回同步读取
+        // user_data低位为0表示读操作
+        if (ring && conn->read_buf_space() > 0 &&
+            ring->prep_recv(sockfd, conn->read_buf_tail(), conn->read_buf_space(),
+                            (uint64_t)sockfd << 1))
         {
-            LOG_INFO("deal with the client(%s)", inet_ntoa(users[sockfd].get_address()->sin_addr));
-            // 将该事件放入请求队列
-            m_pool->append_p(users + sockfd);
-            if (timer)
-            {
-                // 将该http连接对应的定时器超时时间延长3个单位
-                adjust_timer(timer);
-            }
+            return;
         }
-        else
+        // 先读取数据，再放进请求队列
+        dealwithread_done(sockfd, conn->read_once());
+    }
+}
+
+
+/*
+ * @func: Proactor模式下，读取数据完成后的处理
+ * @param: ok 读取是否成功
+ */
+void WebServer::dealwithread_done(int sockfd, bool ok)
+{
+    conn_slot *slot = conn_table::get_instance()->get(sockfd);
+    if (!slot)
+        return;
+    util_timer *timer = slot->timer_data.timer;
+    if (ok)
+    {
+        LOG_INFO("deal with the client(%s)", inet_ntoa(slot->conn.get_address()->sin_addr));
+        // 将该事件放入请求队列
+        m_pool->append_p(&slot->conn);
+        if (timer)
         {
-            // 删除定时器节点，关闭连接
-            deal_timer(timer, sockfd);
+            // 将该http连接对应的定时器超时时间延长3个单位
+            adjust_timer(timer);
         }
     }
+    else
+    {
+        // 删除定时器节点，关闭连接
+        deal_timer(timer, sockfd);
+    }
 }
 
 
@@ -484,8 +757,23 @@ void WebServer::dealwithread(int sockfd)
  */
 void WebServer::dealwithwrite(int sockfd)
 {
+    dealwithwrite(sockfd, NULL);
+}
+
+
+/*
+ * @func: 写操作
+ * @param: ring 事件循环的io_uring实例，不为NULL时Proactor模式下的writev交给io_uring，
+ *         在本轮事件处理完后由dealwithuring批量提交
+ */
+void WebServer::dealwithwrite(int sockfd, io_uring_engine *ring)
+{
+    conn_slot *slot = conn_table::get_instance()->get(sockfd);
+    if (!slot)
+        return;
+    http_conn *conn = &slot->conn;
     // 创建定时器临时变量，将该连接对应的定时器取出来
-    util_timer *timer = users_timer[sockfd].timer;
+    util_timer *timer = slot->timer_data.timer;
     // Reactor事件处理模式
     // Reactor模式，仅负责文件描述符的事件监听
     if (1 == m_actormodel)
@@ -497,44 +785,127 @@ void WebServer::dealwithwrite(int sockfd)
 
         // 将写事件放入线程池请求队列
         // state = 1
-        m_pool->append(users + sockfd, 1);
-
-        while (true)
-        {
-            if (1 == users[sockfd].improv)
-            {
-                // 是否关闭连接
-                if (1 == users[sockfd].timer_flag)
-                {
-                    deal_timer(timer, sockfd);
-                    users[sockfd].timer_flag = 0;
-                }
-                users[sockfd].improv = 0;
-                break;
-            }
-        }
+        m_pool->append(conn, 1);
     }
 
     // Proactor事件处理模式
     // Proactor模式，负责文件描述符的事件监听以及IO数据读写
     else
     {
+        // io_uring引擎：准备writev操作，提交队列已满时退回同步发送
+        // user_data低位为1表示写操作
+        struct iovec *iov = NULL;
+        int iov_count = conn->get_iov(iov);
+        if (ring && iov_count > 0 &&
+            ring->prep_writev(sockfd, iov, iov_count, ((uint64_t)sockfd << 1) | 1))
+        {
+            return;
+        }
         // 将响应报文写入到通信套接字的写缓冲区，发送给浏览器(客户)端
-        if (users[sockfd].write())
+        dealwithwrite_done(sockfd, conn->write());
+    }
+}
+
+
+/*
+ * @func: Proactor模式下，发送数据完成后的处理
+ * @param: ok 发送是否成功
+ */
+void WebServer::dealwithwrite_done(int sockfd, bool ok)
+{
+    conn_slot *slot = conn_table::get_instance()->get(sockfd);
+    if (!slot)
+        return;
+    util_timer *timer = slot->timer_data.timer;
+    if (ok)
+    {
+        LOG_INFO("send data to the client(%s)", inet_ntoa(slot->conn.get_address()->sin_addr));
+        // 读缓冲区中还有流水线中的后续请求，放入请求队列继续处理
+        if (slot->conn.take_pipelined())
         {
-            LOG_INFO("send data to the client(%s)", inet_ntoa(users[sockfd].get_address()->sin_addr));
+            m_pool->append_p(&slot->conn);
+        }
 
-            if (timer)
-            {
-                // 将该http连接对应的定时器超时时间延长3个单位
-                adjust_timer(timer);
-            }
+        if (timer)
+        {
+            // 将该http连接对应的定时器超时时间延长3个单位
+            adjust_timer(timer);
         }
+    }
+    else
+    {
+        // 删除定时器节点，关闭连接
+        deal_timer(timer, sockfd);
+    }
+}
+
+
+/*
+ * @func: io_uring引擎模式下，批量提交本轮事件准备的recv/writev操作，并处理它们的结果
+ * @param: ring 事件循环的io_uring实例
+ * @note: 一轮epoll_wait返回的所有读写只需要一次io_uring_enter系统调用
+ */
+void WebServer::dealwithuring(io_uring_engine *ring)
+{
+    if (!ring || ring->pending() == 0)
+        return;
+
+    if (!ring->submit_and_wait())
+    {
+        LOG_ERROR("io_uring submit failure, errno is:%d", errno);
+    }
+
+    uint64_t user_data;
+    int res;
+    while (ring->pop_cqe(user_data, res))
+    {
+        int sockfd = (int)(user_data >> 1);
+        conn_slot *slot = conn_table::get_instance()->get(sockfd);
+        if (!slot)
+            continue;
+        // 读操作
+        if (0 == (user_data & 1))
+            dealwithread_done(sockfd, slot->conn.read_complete(res));
+        // 写操作
         else
+            dealwithwrite_done(sockfd, slot->conn.write_complete(res));
+    }
+}
+
+
+/*
+ * @func: 处理通过完成队列投递的结果：Reactor模式下工作线程投递的需要关闭的连接，
+ *        以及已完成的异步路由处理
+ * @param: queue 事件循环的完成队列
+ */
+void WebServer::dealwithcompletion(completion_queue *queue)
+{
+    std::list<completion_close> closes;
+    std::list<http_async *> asyncs;
+    queue->take(closes, asyncs);
+    for (std::list<completion_close>::iterator it = closes.begin(); it != closes.end(); ++it)
+    {
+        // 投递之后连接可能已经被定时器关闭，文件描述符被新连接复用，代数不同时不能关闭新连接
+        conn_slot *slot = conn_table::get_instance()->get(it->sockfd);
+        if (!slot || slot->conn.get_generation() != it->generation)
+            continue;
+        // 删除定时器节点，关闭连接
+        close_conn(it->sockfd);
+    }
+    for (std::list<http_async *>::iterator it = asyncs.begin(); it != asyncs.end(); ++it)
+    {
+        http_async *async = *it;
+        int sockfd = async->get_sockfd();
+        // 连接在异步处理期间已经关闭时，文件描述符可能已被新连接复用，通过代数识别
+        conn_slot *slot = conn_table::get_instance()->get(sockfd);
+        if (slot && slot->conn.get_generation() == async->get_generation())
         {
-            // 删除定时器节点，关闭连接
-            deal_timer(timer, sockfd);
+            if (slot->conn.resume(async))
+                adjust_timer(slot->timer_data.timer);
+            else
+                close_conn(sockfd);
         }
+        delete async;
     }
 }
 
@@ -547,6 +918,9 @@ void WebServer::eventLoop()
     bool timeout = false;
     bool stop_server = false;
 
+    // 主线程事件循环绑定到CPU列表中的第一个CPU，其他线程都已创建，不会继承主线程的绑定
+    cpu_affinity::bind(cpu_affinity::get_instance()->get_cpu(0));
+
     while (!stop_server)
     {
         // 等待所监控文件描述符上有事件的产生
@@ -575,12 +949,21 @@ void WebServer::eventLoop()
                 if (false == flag)
                     continue;
             }
+            // Reactor模式下，工作线程通知需要关闭的连接
+            else if (sockfd == m_completion.get_fd())
+            {
+                dealwithcompletion(&m_completion);
+            }
+            // 资源文件被修改，将其移出静态文件缓存
+            else if (sockfd == file_cache::get_instance()->get_inotify_fd())
+            {
+                file_cache::get_instance()->dealwithinotify();
+            }
             // 处理异常事件
             else if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
             {
                 // 服务器端关闭该http连接，移除对应的定时器
-                util_timer *timer = users_timer[sockfd].timer;
-                deal_timer(timer, sockfd);
+                close_conn(sockfd);
             }
             // 处理定时器信号(就绪的套接字是发送定时器信号的管道套接字读端)
             else if ((sockfd == m_pipefd[0]) && (events[i].events & EPOLLIN))
@@ -593,22 +976,34 @@ void WebServer::eventLoop()
             // 处理客户连接上接收到的数据(通信套接字接收到的数据)
             else if (events[i].events & EPOLLIN)
             {
-                dealwithread(sockfd);
+                dealwithread(sockfd, m_ring);
             }
             else if (events[i].events & EPOLLOUT)
             {
                 std::cout << "write event..." << std::endl;
-                dealwithwrite(sockfd);
+                dealwithwrite(sockfd, m_ring);
             }
         }
 
+        // io_uring引擎：一次系统调用提交本轮的全部读写操作
+        dealwithuring(m_ring);
+
         // 处理定时器为非必须事件，收到信号并不是立马处理
         // 完成读写事件后，再进行处理
         if (timeout)
         {
             // 定时处理任务，重新定时以不断触发SIGALRM信号
             utils.timer_handler();
+            // 通知各个从Reactor处理各自的定时器容器
+            for (int i = 0; i < m_reactor_num; ++i)
+            {
+                m_reactors[i]->tick();
+            }
             LOG_INFO("%s", "timer tick");
+            // 完整响应报文缓存的命中/未命中次数
+            long hits = 0, misses = 0;
+            file_cache::get_instance()->get_response_stat(hits, misses);
+            LOG_INFO("response cache hit %ld miss %ld", hits, misses);
             timeout = false;
         }
     }
@@ -12,6 +12,10 @@
 
 #include "./threadpool/threadpool.h"
 #include "./http/http_conn.h"
+#include "./http/conn_table.h"
+#include "./reactor/sub_reactor.h"
+#include "./reactor/io_uring_engine.h"
+#include "./affinity/cpu_affinity.h"
 
 // 最大文件描述符
 const int MAX_FD = 65536;
@@ -19,6 +23,8 @@ const int MAX_FD = 65536;
 const int MAX_EVENT_NUMBER = 10000;
 // 最小超时单位
 const int TIMESLOT = 5;
+// 每个事件循环的io_uring提交队列长度
+const int URING_ENTRIES = 4096;
 
 
 class WebServer
@@ -29,21 +35,41 @@ public:
 
     void init(int port, std::string user, std::string passWord, std::string databaseName,
               int log_write, int opt_linger, int trigmode, int sql_num,
-              int thread_num, int close_log, int actor_model,int db_port = 3306);
+              int thread_num, int close_log, int actor_model,int db_port = 3306,
+              int reactor_num = 0, int backlog = 5, int reuseport = 0, int io_engine = 0,
+              int file_cache_mb = 64, int buffer_max_kb = 64, int schedule = 0,
+              std::string cpu_list = "", int thread_max = 0, int upload_max_mb = 0);
 
     void thread_pool();
+    void reactor_pool();
     void sql_pool();
+    void cache_init();
+    void buffer_init();
+    void affinity_init();
+    void route_init();
     void log_write();
     void trig_mode();
+    int create_listenfd(bool reuseport);
+    io_uring_engine *create_ring();
     void eventListen();
     void eventLoop();
     void timer(int connfd, struct sockaddr_in client_address);
+    void timer(int connfd, struct sockaddr_in client_address, sub_reactor *reactor);
+    void dispatch(int connfd, struct sockaddr_in client_address);
     void adjust_timer(util_timer *timer);
     void deal_timer(util_timer *timer, int sockfd);
+    void close_conn(int sockfd);
     bool dealclientdata();
+    bool dealclientdata(int listenfd, sub_reactor *reactor);
     bool dealwithsignal(bool& timeout, bool& stop_server);
     void dealwithread(int sockfd);
+    void dealwithread(int sockfd, io_uring_engine *ring);
+    void dealwithread_done(int sockfd, bool ok);
     void dealwithwrite(int sockfd);
+    void dealwithwrite(int sockfd, io_uring_engine *ring);
+    void dealwithwrite_done(int sockfd, bool ok);
+    void dealwithuring(io_uring_engine *ring);
+    void dealwithcompletion(completion_queue *queue);
 
 public:
     /********************基础信息******************/
@@ -64,8 +90,8 @@ public:
     int m_pipefd[2];
     // epoll对象
     int m_epollfd;
-    // http连接对象指针，指向http连接对象数组
-    http_conn *users;
+    // Reactor模式下，工作线程向主线程事件循环回报需要关闭的连接
+    completion_queue m_completion;
     /********************网络信息******************/
 
     /********************数据库相关******************/
@@ -86,13 +112,54 @@ public:
     threadpool<http_conn> *m_pool;
     // 线程池工作线程数量
     int m_thread_num;
+    // 线程池工作线程数量上限，大于m_thread_num时线程池随负载伸缩
+    int m_thread_max;
+    // 线程池任务调度方式：0共享任务队列，1工作窃取+轮询分派，2工作窃取+按连接分派，3按连接固定分派
+    int m_schedule;
     /********************线程池相关******************/
 
+    /********************CPU绑定相关******************/
+    // 线程绑定的CPU列表，依次为主线程、从Reactor、工作线程、异步日志线程，空字符串表示不绑定
+    std::string m_cpu_list;
+    /********************CPU绑定相关******************/
+
+    /********************静态文件缓存相关******************/
+    // 静态文件缓存的内存预算(MB)，0表示不缓存
+    int m_file_cache_mb;
+    // 单个连接读/写缓冲区的大小上限(KB)
+    int m_buffer_max_kb;
+    /********************静态文件缓存相关******************/
+
+    /********************路由相关******************/
+    // 上传文件的大小上限(MB)，0表示不开启上传接口(PUT /upload/)
+    int m_upload_max_mb;
+    /********************路由相关******************/
+
+    /********************io_uring相关******************/
+    // I/O引擎：0 epoll就绪后直接recv/writev，1 epoll就绪后通过io_uring批量提交recv/writev
+    int m_io_engine;
+    // 主线程事件循环的io_uring实例，为NULL表示使用recv/writev
+    io_uring_engine *m_ring;
+    /********************io_uring相关******************/
+
+    /********************从Reactor相关******************/
+    // 从Reactor数量，0表示所有事件都由主线程的单个事件循环处理
+    int m_reactor_num;
+    // 从Reactor对象指针数组
+    sub_reactor **m_reactors;
+    // 轮询分发新连接时，下一个接收连接的从Reactor编号
+    int m_next_reactor;
+    /********************从Reactor相关******************/
+
     /********************epoll_event相关******************/
     // IO复用系统，用于存储就绪的文件描述符信息
     epoll_event events[MAX_EVENT_NUMBER];
-    // 用于监听客户端连接请求的套接字
+    // 用于监听客户端连接请求的套接字(SO_REUSEPORT分片模式下为-1)
     int m_listenfd;
+    // 监听套接字的全连接队列长度(listen的backlog参数)
+    int m_backlog;
+    // 是否为每个从Reactor创建一个SO_REUSEPORT监听套接字
+    int m_reuseport;
     // 是否优雅下线
     int m_OPT_LINGER;
     // epoll的（事件触发模式）工作模式  电平ET/边沿LT
@@ -104,8 +171,6 @@ public:
     /********************epoll_event相关******************/
 
     /********************定时器相关******************/
-    // 定时器连接资源指针，指向定时器连接资源数组
-    client_data *users_timer;
     // 定时器中的工具类
     Utils utils;
     /********************定时器相关******************/